@@ -227,7 +227,6 @@ EVENTFUNC(event_falling)
   struct mud_event_data *pMudEvent = NULL;
   struct char_data *ch = NULL;
   int height_fallen = 0;
-  char buf[50] = {'\0'};
 
   /* This is just a dummy check, but we'll do it anyway */
   if (event_obj == NULL)
@@ -246,8 +245,8 @@ EVENTFUNC(event_falling)
   if (!IS_NPC(ch) && !IS_PLAYING(ch->desc))
     return 0;
 
-  /* retrieve svariables and convert it */
-  height_fallen += atoi((char *)pMudEvent->sVariables);
+  /* retrieve the height fallen so far */
+  height_fallen += mud_event_num(pMudEvent, 0);
   send_to_char(ch, "AIYEE!!!  You have fallen %d feet!\r\n", height_fallen);
 
   /* already checked if there is a down exit, lets move the char down */
@@ -330,11 +329,7 @@ EVENTFUNC(event_falling)
     act("$n drops from sight.", FALSE, ch, 0, 0, TO_ROOM);
 
     /* are we falling more?  then we gotta increase the heigh fallen */
-    sprintf(buf, "%d", height_fallen);
-    /* Need to free the memory, if we are going to change it. */
-    if (pMudEvent->sVariables)
-      free(pMudEvent->sVariables);
-    pMudEvent->sVariables = strdup(buf);
+    mud_event_set_num(pMudEvent, height_fallen);
     return (1 * PASSES_PER_SEC);
   }
   else
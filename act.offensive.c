@@ -339,24 +339,12 @@ void perform_rescue(struct char_data *ch, struct char_data *vict) {
   act("$n heroically rescues $N!", FALSE, ch, 0, vict, TO_NOTVICT);
 
   if (FIGHTING(vict) == tmp_ch) {
-    /* don't forget to remove the fight event! */
-    if (char_has_mud_event(vict, eCOMBAT_ROUND)) {
-      event_cancel_specific(vict, eCOMBAT_ROUND);
-    }
     stop_fighting(vict);
   }
   if (FIGHTING(tmp_ch)) {
-    /* don't forget to remove the fight event! */
-    if (char_has_mud_event(tmp_ch, eCOMBAT_ROUND)) {
-      event_cancel_specific(tmp_ch, eCOMBAT_ROUND);
-    }
     stop_fighting(tmp_ch);
   }
   if (FIGHTING(ch)) {
-    /* don't forget to remove the fight event! */
-    if (char_has_mud_event(ch, eCOMBAT_ROUND)) {
-      event_cancel_specific(ch, eCOMBAT_ROUND);
-    }
     stop_fighting(ch);
   }
 
@@ -1850,7 +1838,7 @@ ACMD(do_hit) {
     check_killer(ch, vict);
 
   /* not yet engaged */
-  if (!FIGHTING(ch) && !char_has_mud_event(ch, eCOMBAT_ROUND)) {
+  if (!FIGHTING(ch) && !IN_COMBAT_ROUND(ch)) {
 
     /* INITIATIVE */
     if (!IS_NPC(ch) && HAS_FEAT(ch, FEAT_IMPROVED_INITIATIVE))
@@ -1904,11 +1892,6 @@ ACMD(do_hit) {
       return;
     }
 
-    /* don't forget to remove the fight event! */
-    if (char_has_mud_event(ch, eCOMBAT_ROUND)) {
-      event_cancel_specific(ch, eCOMBAT_ROUND);
-    }
-
     send_to_char(ch, "You switch opponents!\r\n");
     act("$n switches opponents!", FALSE, ch, 0, vict, TO_ROOM);
 
@@ -2154,11 +2137,6 @@ ACMD(do_disengage) {
       return;
     }
 
-    /* don't forget to remove the fight event! */
-    if (char_has_mud_event(ch, eCOMBAT_ROUND)) {
-      event_cancel_specific(ch, eCOMBAT_ROUND);
-    }
-
     USE_MOVE_ACTION(ch);
     stop_fighting(ch);
     send_to_char(ch, "You disengage from the fight.\r\n");
@@ -4100,11 +4078,6 @@ ACMD(do_fire) {
 
     if (ch && vict && IN_ROOM(ch) != IN_ROOM(vict)) {
       hit(ch, vict, TYPE_UNDEFINED, DAM_RESERVED_DBC, 0, 2); // 2 in last arg indicates ranged
-      /* don't forget to remove the fight event! */
-      if (char_has_mud_event(ch, eCOMBAT_ROUND)) {
-        event_cancel_specific(ch, eCOMBAT_ROUND);
-      }
-
       stop_fighting(ch);
       USE_STANDARD_ACTION(ch);
     } else {
@@ -3162,9 +3162,6 @@ ACMD(do_vanish) {
   attach_mud_event(new_mud_event(eVANISH, ch, NULL), 12 * PASSES_PER_SEC);
 
   /* stop vanishers combat */
-  if (char_has_mud_event(ch, eCOMBAT_ROUND)) {
-    event_cancel_specific(ch, eCOMBAT_ROUND);
-  }
   stop_fighting(ch);
 
   /* stop all those who are fighting vanisher */
@@ -3172,9 +3169,6 @@ ACMD(do_vanish) {
     next_v = vict->next_in_room;
 
     if (FIGHTING(vict) == ch) {
-      if (char_has_mud_event(vict, eCOMBAT_ROUND)) {
-        event_cancel_specific(vict, eCOMBAT_ROUND);
-      }
       stop_fighting(vict);
     }
 
@@ -3231,14 +3225,7 @@ ACMD(do_hide) {
     if (HAS_FEAT(ch, FEAT_HIDE_IN_PLAIN_SIGHT)) {
       USE_STANDARD_ACTION(ch);
       if ((skill_roll(FIGHTING(ch), ABILITY_PERCEPTION)) < (skill_roll(ch, ABILITY_STEALTH) - 8)) {
-        /* don't forget to remove the fight event! */
-        if (char_has_mud_event(FIGHTING(ch), eCOMBAT_ROUND)) {
-          event_cancel_specific(FIGHTING(ch), eCOMBAT_ROUND);
-        }
         stop_fighting(FIGHTING(ch));
-        if (char_has_mud_event(ch, eCOMBAT_ROUND)) {
-          event_cancel_specific(ch, eCOMBAT_ROUND);
-        }
         stop_fighting(ch);
       } else {
         send_to_char(ch, "You failed to hide in plain sight!\r\n");
@@ -153,10 +153,13 @@ void create_command_list(void)
   }
 	complete_cmd_info[k] = cmd_info[i];
   log("Command info rebuilt, %d total commands.", k);
+
+  build_command_index();
 }
 
 void free_command_list(void)
 {
+  free_command_index();
   free(complete_cmd_info);
   complete_cmd_info = NULL;
 }
@@ -50,6 +50,7 @@
 #include "crafts.h" /* NewCraft */
 #include "account.h"
 #include "alchemy.h"
+#include "config.h"
 #include "mud_event.h"
 
 /* local utility functions with file scope */
@@ -691,7 +692,7 @@ static void do_stat_scriptvar(struct char_data *ch, struct char_data *k) {
 
   if (!(IS_NPC(k))) {
     /* this is a PC, display their global variables */
-    if (k->script && k->script->global_vars) {
+    if (k->script && k->script->global_vars.list) {
       struct trig_var_data *tv;
       char uname[MAX_INPUT_LENGTH];
 
@@ -699,7 +700,7 @@ static void do_stat_scriptvar(struct char_data *ch, struct char_data *k) {
 
       /* currently, variable context for players is always 0, so it is not
        * displayed here. in the future, this might change */
-      for (tv = k->script->global_vars; tv; tv = tv->next) {
+      for (tv = k->script->global_vars.list; tv; tv = tv->next) {
         if (*(tv->value) == UID_CHAR) {
           find_uid_name(tv->value, uname, sizeof (uname));
           send_to_char(ch, "    %10s:  \tC[UID]:\tn %s\r\n", tv->name, uname);
@@ -1346,6 +1347,7 @@ ACMD(do_switch) {
 
     victim->desc = ch->desc;
     ch->desc = NULL;
+    zone_occupant_changed(victim);
   }
 }
 
@@ -1394,6 +1396,7 @@ ACMD(do_return) {
     /* And our body's pointer to descriptor now points to our descriptor. */
     ch->desc->character->desc = ch->desc;
     ch->desc = NULL;
+    zone_occupant_changed(ch);
   }
 }
 
@@ -2683,6 +2686,8 @@ ACMD(do_show) {
   char colour[16] = {'\0'};
   int q_total = 0, q_approved = 0;
   struct quest_entry *quest = NULL;
+  struct lookup_table_stats lookup_stats;
+  compress_stats_t mccp_out, mccp_in;
 
   struct show_struct {
     const char *cmd;
@@ -2708,6 +2713,8 @@ ACMD(do_show) {
     { "guard", LVL_IMMORT},
     { "crafts", LVL_IMMORT},
     { "todo", LVL_IMMORT},
+    { "dormancy", LVL_IMMORT}, /* 20 */
+    { "compression", LVL_IMMORT},
     { "\n", 0}
   };
 
@@ -2857,20 +2864,32 @@ ACMD(do_show) {
               "  %5d objects          %5d prototypes\r\n"
               "  %5d rooms            %5d zones\r\n"
               "  %5d triggers         %5d shops\r\n"
-              "  %5d large bufs       %5d autoquests\r\n"
+              "  %5d out blocks       %5d autoquests\r\n"
               "  %5d hlquests app     %5d total hl quests\r\n"
-              "  %5d buf switches     %5d overflows\r\n"
-              "  %5d lists\r\n",
+              "  %5d out throttles    %5d overflows\r\n"
+              "  %5d lists            %5dk peak output\r\n"
+              "  %5d random mobs      %5d random objects\r\n"
+              "  %5d random rooms\r\n",
               i, con,
               top_of_p_table + 1,
               j, top_of_mobt + 1,
               k, top_of_objt + 1,
               top_of_world + 1, top_of_zone_table + 1,
               top_of_trigt + 1, top_shop + 1,
-              buf_largecount, total_quests,
+              out_blocks, total_quests,
               q_approved, q_total,
-              buf_switches, buf_overflows, global_lists->iSize
+              out_throttles, out_overflows,
+              global_lists->iSize, out_peak / 1024,
+              num_random_scripts[MOB_TRIGGER], num_random_scripts[OBJ_TRIGGER],
+              num_random_scripts[WLD_TRIGGER]
               );
+      get_lookup_table_stats(&lookup_stats);
+      send_to_char(ch,
+              "  %5d uids             %5d uid slots (%d%% full)\r\n"
+              "  %5.2f avg uid probe   %5d max uid probe\r\n",
+              lookup_stats.entries, lookup_stats.slots,
+              lookup_stats.slots ? lookup_stats.entries * 100 / lookup_stats.slots : 0,
+              lookup_stats.avg_probe, lookup_stats.max_probe);
       break;
 
       /* show errors */
@@ -3060,6 +3079,66 @@ ACMD(do_show) {
 
       break;
 
+      /* show dormancy */
+    case 20:
+      for (i = 0, j = 0, k = 0; i <= top_of_zone_table; i++) {
+        if (zone_table[i].dormant)
+          j++;
+        k += zone_table[i].num_players;
+      }
+      len = snprintf(buf, sizeof (buf), "Zones go dormant after %d seconds without players (0 = never).\r\n"
+              "  %d of %d zones dormant, %d players in zones\r\n\r\n"
+              "%-22s %10s %10s %14s %14s\r\n",
+              zone_dormancy_delay, j, top_of_zone_table + 1, k,
+              "Pulse", "Processed", "Skipped", "Total proc.", "Total skipped");
+      for (i = 0; i < NUM_DORMANCY_PULSES && len < sizeof (buf); i++)
+        len += snprintf(buf + len, sizeof (buf) - len, "%-22s %10ld %10ld %14lld %14lld\r\n",
+                dormancy_stats[i].name, dormancy_stats[i].processed, dormancy_stats[i].skipped,
+                dormancy_stats[i].total_processed, dormancy_stats[i].total_skipped);
+
+      /* Awake zones first, then the dormant ones. */
+      for (l = 0; l < 2 && len < sizeof (buf); l++) {
+        len += snprintf(buf + len, sizeof (buf) - len, "\r\n%s zones:\r\n", l ? "Dormant" : "Awake");
+        for (i = 0; i <= top_of_zone_table && len < sizeof (buf); i++) {
+          if (zone_table[i].dormant != (l == 1))
+            continue;
+          if (zone_table[i].num_players > 0)
+            snprintf(arg, sizeof (arg), "%d player%s", zone_table[i].num_players,
+                    zone_table[i].num_players == 1 ? "" : "s");
+          else
+            snprintf(arg, sizeof (arg), "empty %lus", (pulse - zone_table[i].empty_since) / PASSES_PER_SEC);
+          len += snprintf(buf + len, sizeof (buf) - len, "[%5d] %-*s %s%s\r\n", zone_table[i].number,
+                  count_color_chars(zone_table[i].name) + 30, zone_table[i].name, KNRM, arg);
+        }
+      }
+      page_string(ch->desc, buf, TRUE);
+      break;
+
+      /* show compression */
+    case 21:
+      send_to_char(ch, "MCCP compression level %d.\r\n\r\n"
+              "%-16s %-28s %-28s\r\n%-16s %10s %10s %6s %10s %10s %6s\r\n",
+              mccp_compression_level, "", "Output (v2)", "Input (v3)",
+              "Connection", "Sent", "Ratio", "CPU ms", "Received", "Ratio", "CPU ms");
+      for (i = 0, d = descriptor_list; d; d = d->next) {
+        if (!CompressStats(d, &mccp_out, &mccp_in))
+          continue;
+        if (d->character && !CAN_SEE(ch, d->character))
+          continue;
+        i++;
+        send_to_char(ch, "%-16.16s %10lu %9.1f%% %6.0f %10lu %9.1f%% %6.0f%s\r\n",
+                d->character ? GET_NAME(d->character) : d->host,
+                mccp_out.BytesOut,
+                mccp_out.BytesIn ? 100.0 * mccp_out.BytesOut / mccp_out.BytesIn : 0.0,
+                mccp_out.CpuSeconds * 1000.0, mccp_in.BytesIn,
+                mccp_in.BytesOut ? 100.0 * mccp_in.BytesIn / mccp_in.BytesOut : 0.0,
+                mccp_in.CpuSeconds * 1000.0,
+                CompressActive(d) ? "" : " (off)");
+      }
+      if (!i)
+        send_to_char(ch, "No connections are using MCCP.\r\n");
+      break;
+
       /* show what? */
     default:
       send_to_char(ch, "Sorry, I don't understand that.\r\n");
@@ -4688,6 +4767,9 @@ void perform_do_copyover() {
     return;
   }
 
+  /* From here on we write to the sockets ourselves. */
+  stop_net_thread();
+
   /* write boot_time as first line in file */
   fprintf(fp, "%ld\n", (long) boot_time);
 
@@ -4699,10 +4781,10 @@ void perform_do_copyover() {
 
     /* drop those logging on */
     if (!d->character || d->connected > CON_PLAYING) {
-      write_to_descriptor(d->descriptor, "\n\rSorry, we are rebooting. Come back in a few minutes.\n\r");
+      write_to_client(d, "\n\rSorry, we are rebooting. Come back in a few minutes.\n\r");
       close_socket(d); /* throw'em out */
     } else {
-      write_to_descriptor(d->descriptor, "\n\r *** Time stops for a moment as space and time folds upon itself! ***\n\r"
+      write_to_client(d, "\n\r *** Time stops for a moment as space and time folds upon itself! ***\n\r"
               "[The game will pause for about 30 seconds while new code is being imported, "
               "you will need to reform if you were grouped.  If you get disconnected, "
               "you should be able to reconnect immediately or within a few minutes.]\r\n");
@@ -4741,6 +4823,9 @@ void perform_do_copyover() {
       /* end special handling */
 
       fprintf(fp, "%d %ld %s %s %s\n", d->descriptor, GET_PREF(och), GET_NAME(och), d->host, CopyoverGet(d));
+      /* CopyoverGet() ended any MCCP stream; the end of it has to go out
+       * before the exec. */
+      write_to_client(d, "");
       /* save och */
       GET_LOADROOM(och) = GET_ROOM_VNUM(IN_ROOM(och));
       Crash_rentsave(och, 0);
@@ -4937,10 +5022,6 @@ ACMD(do_peace) {
     next_v = vict->next_in_room;
 
     if (FIGHTING(vict)) {
-      if (char_has_mud_event(vict, eCOMBAT_ROUND)) {
-        event_cancel_specific(vict, eCOMBAT_ROUND);
-      }
-
       stop_fighting(vict);
       resetCastingData(vict);
     }
@@ -102,7 +102,7 @@ EVENTFUNC(event_action_cooldown) {
 
   /* Lets show duration for immortals */
   if (GET_LEVEL(ch) >= LVL_IMMORT)
-    sprintf(buf, " (%.2f sec)", (float) (atoi(pMudEvent->sVariables)) / 10);
+    sprintf(buf, " (%.2f sec)", (float) mud_event_num(pMudEvent, 0) / 10);
   else
     *buf = '\0';
 
@@ -194,20 +194,16 @@ void start_skill_cooldown(struct char_data *ch, int skill, int weapon) {
 #endif
 
 void start_action_cooldown(struct char_data * ch, action_type act_type, int duration) {
-  char svar[50];
-
-  /* Format the sVariables - Always duration first. */
-  sprintf(svar, "%d", duration);
-
+  /* The event carries its duration, for the message when it ends. */
   if (act_type == atMOVE) {
-    attach_mud_event(new_mud_event(eMOVEACTION, ch, svar), duration);
+    attach_mud_event(new_mud_event_num(eMOVEACTION, ch, duration), duration);
     if (AFF_FLAGGED(ch, AFF_STAGGERED))
-      attach_mud_event(new_mud_event(eSTANDARDACTION, ch, svar), duration);
+      attach_mud_event(new_mud_event_num(eSTANDARDACTION, ch, duration), duration);
   } else if (act_type == atSTANDARD) {
-    attach_mud_event(new_mud_event(eSTANDARDACTION, ch, svar), duration);
+    attach_mud_event(new_mud_event_num(eSTANDARDACTION, ch, duration), duration);
     if (AFF_FLAGGED(ch, AFF_STAGGERED))
-      attach_mud_event(new_mud_event(eMOVEACTION, ch, svar), duration);
+      attach_mud_event(new_mud_event_num(eMOVEACTION, ch, duration), duration);
   } else if (act_type == atSWIFT) {
-    attach_mud_event(new_mud_event(eSWIFTACTION, ch, svar), duration);
+    attach_mud_event(new_mud_event_num(eSWIFTACTION, ch, duration), duration);
   }
 };
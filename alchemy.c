@@ -2599,6 +2599,7 @@ ACMD(do_psychokinetic) {
       for (af = ch->affected; af; af = af->next) {
         if (af->spell == ALC_DISC_AFFECT_PSYCHOKINETIC) {
           af->modifier -= 1;
+          affects_changed(ch);
           if (af->modifier <= 0) {
             affect_from_char(ch, ALC_DISC_AFFECT_PSYCHOKINETIC);
             send_to_char(ch, "You have launched the last of your psychokinetic spirits.\r\n");
@@ -94,19 +94,30 @@
 #include "assign_wpn_armor.h"
 #include "wilderness.h"
 #include "spell_prep.h"
+#include "config.h"
 
 #ifndef INVALID_SOCKET
 #define INVALID_SOCKET (-1)
 #endif
 
+#if defined(CIRCLE_WINDOWS) || !defined(HAVE_SYS_UIO_H)
+struct iovec {
+  void *iov_base;
+  size_t iov_len;
+};
+#endif
+
+#define OUT_IOV_MAX 64 /* pieces of output handed to one writev() */
+
 extern time_t motdmod;
 extern time_t newsmod;
 
 /* locally defined globals, used externally */
 struct descriptor_data *descriptor_list = NULL; /* master desc list */
-int buf_largecount = 0; /* # of large buffers which exist */
-int buf_overflows = 0; /* # of overflows of output */
-int buf_switches = 0; /* # of switches from small to large buf */
+int out_blocks = 0; /* # of output blocks which exist */
+int out_overflows = 0; /* # of times output was cut off at the hard cap */
+int out_throttles = 0; /* # of times commands were held for output */
+int out_peak = 0; /* most output ever waiting for one descriptor */
 int circle_shutdown = 0; /* clean shutdown */
 int circle_reboot = 0; /* reboot the game after a shutdown */
 int no_specials = 0; /* Suppress ass. of special routines */
@@ -120,7 +131,8 @@ int next_tick = SECS_PER_MUD_HOUR; /* Tick countdown */
 long last_webster_teller = -1L;
 
 /* static local global variable declarations (current file scope only) */
-static struct txt_block *bufpool = NULL; /* pool of large output buffers */
+static struct out_block *block_pool = NULL; /* free output blocks */
+static struct out_span *span_pool = NULL; /* free output spans */
 static int max_players = 0; /* max descriptors available */
 static int tics_passed = 0; /* for extern checkpointing */
 static struct timeval null_time; /* zero-valued time structure */
@@ -131,8 +143,18 @@ static byte emergency_unban;
  */
 static int dg_act_check; /* toggle for act_trigger */
 static bool fCopyOver; /* Are we booting in copyover mode? */
-static char *last_act_message = NULL;
+static char last_act_message[MAX_STRING_LENGTH]; /* what the last act() said */
 static byte webster_file_ready = FALSE; /* signal: SIGUSR2 */
+#ifdef CIRCLE_EPOLL
+static int epoll_fd = -1; /* what game_loop() waits on */
+#endif
+#ifdef CIRCLE_IO_THREAD
+static bool net_running = FALSE; /* is the network thread serving sockets? */
+/* Whether d's socket is being read from and written to by the thread. */
+#define NET_OWNED(d) ((d)->conn && net_running)
+#else
+#define NET_OWNED(d) (FALSE)
+#endif
 
 /* static local function prototypes (current file scope only) */
 static RETSIGTYPE reread_wizlists(int sig);
@@ -152,6 +174,7 @@ static socket_t init_socket(ush_int port);
 static int new_descriptor(socket_t s);
 static int get_max_players(void);
 static int process_output(struct descriptor_data *t);
+static int writev_to_client(struct descriptor_data *d, struct iovec *iov, int iovcnt);
 static int process_input(struct descriptor_data *t);
 static void timediff(struct timeval *diff, struct timeval *a, struct timeval *b);
 static void timeadd(struct timeval *sum, struct timeval *a, struct timeval *b);
@@ -162,6 +185,22 @@ static void record_usage(void);
 static char *make_prompt(struct descriptor_data *point);
 static void check_idle_passwords(void);
 static void init_descriptor(struct descriptor_data *newd, int desc);
+static void init_poll(socket_t mother);
+static int poll_sockets(socket_t mother, bool wait);
+#ifdef CIRCLE_EPOLL
+static void watch_socket(socket_t s, struct descriptor_data *d);
+static void watch_output(struct descriptor_data *d, bool want);
+#endif
+static void free_span(struct out_span *span);
+static void start_net_thread(void);
+static bool net_attach(struct descriptor_data *d);
+static void net_detach(struct descriptor_data *d);
+static bool net_pending(struct descriptor_data *d);
+static ssize_t net_read(struct descriptor_data *d, char *buf, size_t len);
+static void net_reclaim(struct descriptor_data *d);
+static void net_wake(void);
+static int hand_output(struct descriptor_data *t);
+static void hand_text(struct descriptor_data *t, const char *txt, int len);
 
 static struct in_addr *get_bind_addr(void);
 static int parse_ip(const char *addr, struct in_addr *inaddr);
@@ -212,6 +251,11 @@ void gettimeofday(struct timeval *t, struct timezone *dummy) {
 
 #endif	/* CIRCLE_WINDOWS || CIRCLE_MACINTOSH */
 
+#ifdef CIRCLE_NO_MAIN
+/* Linked into a driver that brings its own main(), like util/combatbench.c. */
+#define main circle_main
+#endif
+
 int main(int argc, char **argv) {
   int pos = 1;
   const char *dir = NULL;
@@ -389,9 +433,6 @@ int main(int argc, char **argv) {
     free_list(global_lists);
   }
 
-  if (last_act_message)
-    free(last_act_message);
-
   /* probably should free the entire config here.. */
   free(CONFIG_CONFFILE);
 
@@ -521,6 +562,7 @@ static void init_game(ush_int local_port) {
     log("Opening mother connection.");
     mother_desc = init_socket(local_port);
   }
+  init_poll(mother_desc);
 
   event_init();
 
@@ -540,10 +582,14 @@ static void init_game(ush_int local_port) {
   if (fCopyOver) /* reload players */
     copyover_recover();
 
+  start_net_thread();
+
   log("Entering game loop.");
 
   game_loop(mother_desc);
 
+  stop_net_thread();
+
   Crash_save_all();
 
   log("Closing all sockets.");
@@ -731,25 +777,146 @@ static int get_max_players(void) {
 #endif /* CIRCLE_UNIX */
 }
 
+/* Socket readiness.  Once a pulse game_loop() asks which sockets have
+ * anything for it and each descriptor's io_flags get what came back, so the
+ * rest of the loop only reads from and writes to the ones that are ready.
+ *
+ * With epoll every socket is registered once, edge-triggered: DIO_INPUT
+ * stays set until process_input() finds nothing more to read, and write
+ * interest is only asked for while a descriptor has output the kernel would
+ * not take (DIO_BLOCKED).  Without it (or with CIRCLE_USE_SELECT) select()
+ * is handed every descriptor each pulse as it always was. */
+#ifdef CIRCLE_EPOLL
+
+#define MAX_POLL_EVENTS 128 /* readiness events taken per epoll_wait() */
+
+static void init_poll(socket_t mother) {
+  if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    perror("SYSERR: epoll_create1");
+    exit(1);
+  }
+  /* The mother socket stays level-triggered; we accept one a pulse. */
+  watch_socket(mother, NULL);
+}
+
+/* Registers a socket; d is NULL for the mother socket. */
+static void watch_socket(socket_t s, struct descriptor_data *d) {
+  struct epoll_event ev;
+
+  if (epoll_fd < 0)
+    return;
+
+  ev.events = d ? (EPOLLIN | EPOLLPRI | EPOLLRDHUP | EPOLLET) : EPOLLIN;
+  ev.data.ptr = d;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s, &ev) < 0)
+    perror("SYSERR: epoll_ctl add");
+}
+
+/* Asks to be told when d's send buffer has room again, or stops asking. */
+static void watch_output(struct descriptor_data *d, bool want) {
+  struct epoll_event ev;
+
+  if (want)
+    d->io_flags |= DIO_BLOCKED;
+  else
+    d->io_flags &= ~DIO_BLOCKED;
+
+  ev.events = EPOLLIN | EPOLLPRI | EPOLLRDHUP | EPOLLET | (want ? EPOLLOUT : 0);
+  ev.data.ptr = d;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, d->descriptor, &ev) < 0)
+    perror("SYSERR: epoll_ctl mod");
+}
+
+/* Marks up the descriptors epoll has news about.  Returns 1 if a new
+ * connection is waiting, 0 if not and -1 on error.  Only flags are set here,
+ * so nothing can be freed out from under the events still to be looked at. */
+static int poll_sockets(socket_t mother, bool wait) {
+  static struct epoll_event events[MAX_POLL_EVENTS];
+  struct descriptor_data *d;
+  int i, n, new_connection = 0;
+
+  do {
+    if ((n = epoll_wait(epoll_fd, events, MAX_POLL_EVENTS, wait ? -1 : 0)) < 0)
+      return (-1);
+
+    for (i = 0; i < n; i++) {
+      if (!(d = events[i].data.ptr)) {
+        new_connection = 1;
+        continue;
+      }
+      if (events[i].events & (EPOLLERR | EPOLLPRI))
+        d->io_flags |= DIO_ERROR;
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP))
+        d->io_flags |= DIO_INPUT;
+      if ((events[i].events & EPOLLOUT) && (d->io_flags & DIO_BLOCKED))
+        watch_output(d, FALSE);
+    }
+    /* A full batch may mean more are waiting; go back for them without
+     * blocking. */
+    wait = FALSE;
+  } while (n == MAX_POLL_EVENTS);
+
+  return (new_connection);
+}
+
+#else /* !CIRCLE_EPOLL */
+
+static void init_poll(socket_t mother) {
+}
+
+static int poll_sockets(socket_t mother, bool wait) {
+  fd_set input_set, output_set, exc_set;
+  struct descriptor_data *d;
+  int maxdesc;
+
+  /* Set up the input, output, and exception sets for select(). */
+  FD_ZERO(&input_set);
+  FD_ZERO(&output_set);
+  FD_ZERO(&exc_set);
+  FD_SET(mother, &input_set);
+
+  maxdesc = mother;
+  for (d = descriptor_list; d; d = d->next) {
+#ifndef CIRCLE_WINDOWS
+    if (d->descriptor > maxdesc)
+      maxdesc = d->descriptor;
+#endif
+    FD_SET(d->descriptor, &input_set);
+    FD_SET(d->descriptor, &output_set);
+    FD_SET(d->descriptor, &exc_set);
+  }
+
+  if (select(maxdesc + 1, &input_set, &output_set, &exc_set, wait ? NULL : &null_time) < 0)
+    return (-1);
+
+  for (d = descriptor_list; d; d = d->next)
+    d->io_flags = (d->io_flags & DIO_THROTTLED) |
+          (FD_ISSET(d->descriptor, &input_set) ? DIO_INPUT : 0) |
+          (FD_ISSET(d->descriptor, &output_set) ? 0 : DIO_BLOCKED) |
+          (FD_ISSET(d->descriptor, &exc_set) ? DIO_ERROR : 0);
+
+  return (FD_ISSET(mother, &input_set) ? 1 : 0);
+}
+
+#endif /* CIRCLE_EPOLL */
+
 /* game_loop contains the main loop which drives the entire MUD.  It
  * cycles once every 0.10 seconds and is responsible for accepting new
  * new connections, polling existing connections for input, dequeueing
  * output and sending it out to players, and calling "heartbeat" functions
  * such as mobile_activity(). */
 void game_loop(socket_t local_mother_desc) {
-  fd_set input_set, output_set, exc_set, null_set;
   struct timeval last_time, opt_time, process_time, temp_time;
   struct timeval before_sleep, now, timeout;
   char comm[MAX_INPUT_LENGTH] = {'\0'};
   struct descriptor_data *d = NULL, *next_d = NULL;
-  int missed_pulses = 0, maxdesc = 0, aliased = 0;
+  int missed_pulses = 0, aliased = 0, new_connection = 0;
 
   /* initialize various time values */
   null_time.tv_sec = 0;
   null_time.tv_usec = 0;
   opt_time.tv_usec = OPT_USEC;
   opt_time.tv_sec = 0;
-  FD_ZERO(&null_set);
 
   gettimeofday(&last_time, (struct timezone *) 0);
 
@@ -759,9 +926,7 @@ void game_loop(socket_t local_mother_desc) {
     /* Sleep if we don't have any connections */
     if (descriptor_list == NULL) {
       log("No connections.  Going to sleep.");
-      FD_ZERO(&input_set);
-      FD_SET(local_mother_desc, &input_set);
-      if (select(local_mother_desc + 1, &input_set, (fd_set *) 0, (fd_set *) 0, NULL) < 0) {
+      if (poll_sockets(local_mother_desc, TRUE) < 0) {
         if (errno == EINTR)
           log("Waking up to process signal.");
         else
@@ -770,22 +935,6 @@ void game_loop(socket_t local_mother_desc) {
         log("New connection.  Waking up.");
       gettimeofday(&last_time, (struct timezone *) 0);
     }
-    /* Set up the input, output, and exception sets for select(). */
-    FD_ZERO(&input_set);
-    FD_ZERO(&output_set);
-    FD_ZERO(&exc_set);
-    FD_SET(local_mother_desc, &input_set);
-
-    maxdesc = local_mother_desc;
-    for (d = descriptor_list; d; d = d->next) {
-#ifndef CIRCLE_WINDOWS
-      if (d->descriptor > maxdesc)
-        maxdesc = d->descriptor;
-#endif
-      FD_SET(d->descriptor, &input_set);
-      FD_SET(d->descriptor, &output_set);
-      FD_SET(d->descriptor, &exc_set);
-    }
 
     /* At this point, we have completed all input, output and heartbeat
      * activity from the previous iteration, so we have to put ourselves
@@ -822,28 +971,25 @@ void game_loop(socket_t local_mother_desc) {
     } while (timeout.tv_usec || timeout.tv_sec);
 
     /* Poll (without blocking) for new input, output, and exceptions */
-    if (select(maxdesc + 1, &input_set, &output_set, &exc_set, &null_time) < 0) {
+    if ((new_connection = poll_sockets(local_mother_desc, FALSE)) < 0) {
       perror("SYSERR: Select poll");
       return;
     }
     /* If there are new connections waiting, accept them. */
-    if (FD_ISSET(local_mother_desc, &input_set))
+    if (new_connection)
       new_descriptor(local_mother_desc);
 
     /* Kick out the freaky folks in the exception set and marked for close */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
-      if (FD_ISSET(d->descriptor, &exc_set)) {
-        FD_CLR(d->descriptor, &input_set);
-        FD_CLR(d->descriptor, &output_set);
+      if (d->io_flags & DIO_ERROR)
         close_socket(d);
-      }
     }
 
     /* Process descriptors with input pending */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
-      if (FD_ISSET(d->descriptor, &input_set)) {
+      if ((d->io_flags & DIO_INPUT) || net_pending(d)) {
         if (d->pProtocol != NULL) /* KaVir's plugin */
           d->pProtocol->WriteOOB = 0; /* KaVir's plugin */
         if (process_input(d) < 0)
@@ -866,6 +1012,17 @@ void game_loop(socket_t local_mother_desc) {
           continue;
       }
 
+      /* Hold the commands of anyone with more output waiting than their
+       * client is reading, until it has caught up with half of it. */
+      if (d->bufptr > output_high_water ||
+              ((d->io_flags & DIO_THROTTLED) && d->bufptr > output_high_water / 2)) {
+        if (!(d->io_flags & DIO_THROTTLED))
+          out_throttles++;
+        d->io_flags |= DIO_THROTTLED;
+        continue;
+      }
+      d->io_flags &= ~DIO_THROTTLED;
+
       if (get_from_q(&d->input, comm, &aliased)) {
         if (d->character) {
           /* Reset the idle timer & pull char back from void if necessary */
@@ -905,13 +1062,30 @@ void game_loop(socket_t local_mother_desc) {
     /* Send queued output out to the operating system (ultimately to user). */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
-      if (*(d->output) && FD_ISSET(d->descriptor, &output_set)) {
+      if (d->io_flags & DIO_BLOCKED)
+        continue;
+      if (NET_OWNED(d)) /* let go of what the network thread has sent */
+        net_reclaim(d);
+      if (d->out_head) {
         /* Output for this player is ready */
-        if (process_output(d) < 0)
+        if (process_output(d) < 0) {
           close_socket(d);
-        else
-          d->has_prompt = 1;
+          continue;
+        }
+        d->has_prompt = 1;
+      } else if (NET_OWNED(d)) {
+        continue;
+      } else if (CompressPending(d, NULL) && write_to_client(d, "") < 0) {
+        /* Only compressed output the socket would not take last time. */
+        close_socket(d);
+        continue;
       }
+#ifdef CIRCLE_EPOLL
+      /* Whatever is left did not fit in the send buffer; hold it until
+       * epoll says the buffer has drained. */
+      if (!NET_OWNED(d) && (d->bufptr || CompressPending(d, NULL)))
+        watch_output(d, TRUE);
+#endif
     }
 
     /* Print prompts for other descriptors who had no other output */
@@ -919,11 +1093,14 @@ void game_loop(socket_t local_mother_desc) {
       /* Ornir's attempt to remove blank lines */
       if (!d->has_prompt && !d->pProtocol->WriteOOB) {
         //if (!d->has_prompt) {
-        write_to_descriptor(d->descriptor, make_prompt(d));
+        write_to_client(d, make_prompt(d));
         d->has_prompt = TRUE;
       }
     }
 
+    /* Tell the network thread there is output for it. */
+    net_wake();
+
     /* Kick out folks in the CON_CLOSE or CON_DISCONNECT state */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
@@ -978,16 +1155,42 @@ void game_loop(socket_t local_mother_desc) {
   }
 }
 
+#ifdef CIRCLE_NO_MAIN
+/* Hands every descriptor's queued output (and prompt) to its socket the way
+ * game_loop() does each pass, for drivers that run heartbeat() themselves. */
+void process_all_output(void) {
+  struct descriptor_data *d, *next_d;
+
+  for (d = descriptor_list; d; d = next_d) {
+    next_d = d->next;
+    if (d->out_head) {
+      if (process_output(d) < 0)
+        close_socket(d);
+      else
+        d->has_prompt = 1;
+    }
+  }
+}
+#endif
+
 /*  This was ported to accomodate the HL objects that were imported */
 void proc_update() {
   struct obj_data *obj = NULL;
 
+  dormancy_pulse_start(DORMANCY_OBJPROC);
+
   for (obj = object_list; obj; obj = obj->next) {
 
     //start_fall_object_event(obj);
     if (!OBJ_FLAGGED(obj, ITEM_AUTOPROC) || (GET_OBJ_TYPE(obj) == ITEM_WEAPON && GET_OBJ_VAL(obj, 0) == 0))
       continue;
 
+    if (ROOM_DORMANT(obj_room(obj))) {
+      DORMANCY_SKIPPED(DORMANCY_OBJPROC);
+      continue;
+    }
+    DORMANCY_PROCESSED(DORMANCY_OBJPROC);
+
     if (obj_index[GET_OBJ_RNUM(obj)].func != NULL)
       if (!(obj_index[GET_OBJ_RNUM(obj)].func)(obj->worn_by, obj, 0, ""))
         (obj_index[GET_OBJ_RNUM(obj)].func)(obj->carried_by, obj, 0, "");
@@ -999,6 +1202,7 @@ void heartbeat(int heart_pulse) {
   static int mins_since_crashsave = 0;
 
   event_process();
+  combat_round_update();
 
   if (!(heart_pulse % PULSE_DG_SCRIPT))
     script_trigger_check();
@@ -1650,10 +1854,6 @@ static int get_from_q(struct txt_q *queue, char *dest, int *aliased) {
 
 /* Empty the queues before closing connection */
 static void flush_queues(struct descriptor_data *d) {
-  if (d->large_outbuf) {
-    d->large_outbuf->next = bufpool;
-    bufpool = d->large_outbuf;
-  }
   while (d->input.head) {
     struct txt_block *tmp = d->input.head;
     d->input.head = d->input.head->next;
@@ -1674,84 +1874,183 @@ size_t write_to_output(struct descriptor_data *t, const char *txt, ...) {
   return left;
 }
 
+/* How much output may wait for a descriptor: output_hard_cap, but never less
+ * than the single buffer there used to be. */
+static int output_cap(void) {
+  return (MAX(output_hard_cap, LARGE_BUFSIZE - 1));
+}
+
+/* Output blocks.  A descriptor's queued output is a list of spans over
+ * pooled blocks: new text is copied onto the end of its last block while
+ * there is room and nobody else points into it, or into a fresh one, and
+ * process_output() hands the spans to writev() as they are. */
+static struct out_block *new_out_block(void) {
+  struct out_block *b;
+
+  if (block_pool) {
+    b = block_pool;
+    block_pool = b->next;
+  } else {
+    CREATE(b, struct out_block, 1);
+    out_blocks++;
+  }
+  b->refs = 0;
+  b->next = NULL;
+
+  return (b);
+}
+
+/* A span over text[start..end) of b, not queued for anyone yet. */
+static struct out_span *new_span(struct out_block *b, int start, int end) {
+  struct out_span *span;
+
+  if (span_pool) {
+    span = span_pool;
+    span_pool = span->next;
+  } else
+    CREATE(span, struct out_span, 1);
+
+  span->block = b;
+  span->start = start;
+  span->end = end;
+  span->next = NULL;
+  b->refs++;
+
+  return (span);
+}
+
+/* Queues text[start..end) of b for t. */
+static struct out_span *queue_span(struct descriptor_data *t, struct out_block *b, int start, int end) {
+  struct out_span *span = new_span(b, start, end);
+
+  if (t->out_tail)
+    t->out_tail->next = span;
+  else
+    t->out_head = span;
+  t->out_tail = span;
+  t->bufptr += end - start;
+
+  return (span);
+}
+
+/* Copies len bytes of txt onto the end of t's output. */
+static void append_output(struct descriptor_data *t, const char *txt, int len) {
+  struct out_span *span = t->out_tail;
+  int n;
+
+  while (len > 0) {
+    if (!span || span->block->refs > 1 || span->end == OUT_BLOCK_SIZE)
+      span = queue_span(t, new_out_block(), 0, 0);
+    n = MIN(len, OUT_BLOCK_SIZE - span->end);
+    memcpy(span->block->text + span->end, txt, n);
+    span->end += n;
+    t->bufptr += n;
+    txt += n;
+    len -= n;
+  }
+}
+
+/* Queues the first len bytes of from's output for to as well, pointing at
+ * the same blocks rather than copying them. */
+static void share_output(struct descriptor_data *to, struct descriptor_data *from, int len) {
+  struct out_span *span;
+  int n;
+
+  len = MIN(len, output_cap() - to->bufptr);
+
+  for (span = from->out_head; span && len > 0; span = span->next) {
+    n = MIN(len, span->end - span->start);
+    queue_span(to, span->block, span->start, span->start + n);
+    len -= n;
+  }
+}
+
+/* Drops the first len bytes of t's output, which have been sent. */
+static void discard_output(struct descriptor_data *t, int len) {
+  struct out_span *span;
+  int n;
+
+  while ((span = t->out_head) && len > 0) {
+    n = MIN(len, span->end - span->start);
+    span->start += n;
+    t->bufptr -= n;
+    len -= n;
+    if (span->start < span->end)
+      break;
+
+    if (!(t->out_head = span->next))
+      t->out_tail = NULL;
+    free_span(span);
+  }
+}
+
+/* Returns a span that is no longer queued to the pool, and its block with
+ * it if nothing else points into it. */
+static void free_span(struct out_span *span) {
+  if (--span->block->refs == 0) {
+    span->block->next = block_pool;
+    block_pool = span->block;
+  }
+  span->next = span_pool;
+  span_pool = span;
+}
+
+/* Drops everything queued for t without sending it. */
+void clear_output(struct descriptor_data *t) {
+  discard_output(t, t->bufptr);
+}
+
 /* Add a new string to a player's output queue. */
 size_t vwrite_to_output(struct descriptor_data *t, const char *format,
         va_list args) {
   const char *text_overflow = "\r\nOVERFLOW\r\n";
   static char txt[MAX_STRING_LENGTH] = {'\0'};
-  size_t wantsize = 0;
+  const char *out;
   int size = 0;
 
   /* if we're in the overflow state already, ignore this new output */
-  if (t->bufspace == 0)
+  if (t->bufptr >= output_cap())
     return (0);
 
-  wantsize = size = vsnprintf(txt, sizeof (txt), format, args);
-
-  /* this block is Kavir's protocol */
-  strcpy(txt, ProtocolOutput(t, txt, (int*) &wantsize));
-  size = wantsize;
-  if (t->pProtocol->WriteOOB > 0)
-    --t->pProtocol->WriteOOB;
+  size = vsnprintf(txt, sizeof (txt), format, args);
 
   /* If exceeding the size of the buffer, truncate it for the overflow message */
-  if (size < 0 || wantsize >= sizeof (txt)) {
+  if (size < 0 || size >= sizeof (txt)) {
     size = sizeof (txt) - 1;
     strcpy(txt + size - strlen(text_overflow), text_overflow); /* strcpy: OK */
   }
 
-  /* If the text is too big to fit into even a large buffer, truncate
-   * the new text to make it fit.  (This will switch to the overflow
-   * state automatically because t->bufspace will end up 0.) */
-  if (size + t->bufptr + 1 > LARGE_BUFSIZE) {
-    size = LARGE_BUFSIZE - t->bufptr - 1;
-    txt[size] = '\0';
-    buf_overflows++;
-  }
-
-  /* If we have enough space, just write to buffer and that's it! If the
-   * text just barely fits, then it's switched to a large buffer instead. */
-  if (t->bufspace > size) {
-    strcpy(t->output + t->bufptr, txt); /* strcpy: OK (size checked above) */
-    t->bufspace -= size;
-    t->bufptr += size;
-    return (t->bufspace);
-  }
-
-  buf_switches++;
+  /* this block is Kavir's protocol; what it hands back goes straight onto the
+   * output blocks */
+  out = ProtocolOutput(t, txt, &size);
+  if (t->pProtocol->WriteOOB > 0)
+    --t->pProtocol->WriteOOB;
 
-  /* if the pool has a buffer in it, grab it */
-  if (bufpool != NULL) {
-    t->large_outbuf = bufpool;
-    bufpool = bufpool->next;
-  } else { /* else create a new one */
-    CREATE(t->large_outbuf, struct txt_block, 1);
-    CREATE(t->large_outbuf->text, char, LARGE_BUFSIZE);
-    buf_largecount++;
+  /* If the text is too big to fit, truncate the new text to make it fit.
+   * (This will switch to the overflow state automatically because
+   * t->bufptr will end up at the limit.) */
+  if (size + t->bufptr > output_cap()) {
+    size = output_cap() - t->bufptr;
+    out_overflows++;
   }
 
-  strcpy(t->large_outbuf->text, t->output); /* strcpy: OK (size checked previously) */
-  t->output = t->large_outbuf->text; /* make big buffer primary */
-  strcat(t->output, txt); /* strcat: OK (size checked) */
-
-  /* set the pointer for the next write */
-  t->bufptr = strlen(t->output);
+  append_output(t, out, size);
+  out_peak = MAX(out_peak, t->bufptr);
 
-  /* calculate how much space is left in the buffer */
-  t->bufspace = LARGE_BUFSIZE - 1 - t->bufptr;
-
-  return (t->bufspace);
+  return (output_cap() - t->bufptr);
 }
 
 static void free_bufpool(void) {
-  struct txt_block *tmp = NULL;
+  struct out_block *b;
+  struct out_span *span;
 
-  while (bufpool) {
-    tmp = bufpool->next;
-    if (bufpool->text)
-      free(bufpool->text);
-    free(bufpool);
-    bufpool = tmp;
+  while ((b = block_pool)) {
+    block_pool = b->next;
+    free(b);
+  }
+  while ((span = span_pool)) {
+    span_pool = span->next;
+    free(span);
   }
 }
 
@@ -1841,11 +2140,7 @@ static void init_descriptor(struct descriptor_data *newd, int desc) {
 
   newd->descriptor = desc;
   newd->idle_tics = 0;
-  newd->output = newd->small_outbuf;
-  newd->bufspace = SMALL_BUFSIZE - 1;
   newd->login_time = time(0);
-  *newd->output = '\0';
-  newd->bufptr = 0;
   newd->has_prompt = 1; /* prompt is part of greetings */
   STATE(newd) = CONFIG_PROTOCOL_NEGOTIATION ? CON_GET_PROTOCOL : CON_ACCOUNT_NAME; //CON_GET_NAME;
   CREATE(newd->history, char *, HISTORY_SIZE);
@@ -1854,7 +2149,12 @@ static void init_descriptor(struct descriptor_data *newd, int desc) {
   newd->desc_num = last_desc;
   newd->pProtocol = ProtocolCreate(); /* KaVir's plugin*/
   newd->events = create_list();
-
+  /* the network thread takes it if it is running, else the game loop */
+  if (!net_attach(newd)) {
+#ifdef CIRCLE_EPOLL
+    watch_socket(desc, newd);
+#endif
+  }
 }
 
 static int new_descriptor(socket_t s) {
@@ -1939,53 +2239,63 @@ static int new_descriptor(socket_t s) {
 }
 
 /* Send all of the output that we've accumulated for a player out to the
- * player's descriptor. 32 byte GARBAGE_SPACE in MAX_SOCK_BUF used for:
- *	 2 bytes: prepended \r\n
- *	14 bytes: overflow message
- *	 2 bytes: extra \r\n for non-comapct
- *      14 bytes: unused */
+ * player's descriptor.  The queued blocks go out as they are in one writev(),
+ * between a leading \r\n if this is an 'interruption' and whatever goes
+ * after them: the overflow message, the extra \r\n for non-compact players
+ * and the prompt. */
 static int process_output(struct descriptor_data *t) {
-  char i[MAX_SOCK_BUF], *osb = i + 2;
-  int result;
+  struct iovec iov[OUT_IOV_MAX];
+  struct out_span *span;
+  char trailer[GARBAGE_SPACE + MAX_PROMPT_LENGTH], *prompt;
+  int count = 0, queued = 0, lead = 0, result;
 
-  /* we may need this \r\n for later -- see below */
-  strcpy(i, "\r\n"); /* strcpy: OK (for 'MAX_SOCK_BUF >= 3') */
+  /* The network thread does the writing for its sockets. */
+  if (NET_OWNED(t))
+    return (hand_output(t));
 
-  /* now, append the 'real' output */
-  strcpy(osb, t->output); /* strcpy: OK (t->output:LARGE_BUFSIZE < osb:MAX_SOCK_BUF-2) */
+  *trailer = '\0';
 
-  // color code fix attempt -zusuk
-  //parse_at(osb);
-
-  /* if we're in the overflow state, notify the user */
-  /* Ornir attempt to remove blank lines */
-  /*if (t->bufspace == 0 && !t->pProtocol->WriteOOB){
-    strcat(osb, "**OVERFLOW**\r\n"); // strcpy: OK (osb:MAX_SOCK_BUF-2 reserves space)
-  }
-  else*/
-  if (t->bufspace == 0) {
-    strcat(osb, "**OVERFLOW**");
+  /* if this is an 'interruption', start with a CRLF */
+  if (t->has_prompt && !t->pProtocol->WriteOOB) {
+    iov[count].iov_base = "\r\n";
+    iov[count++].iov_len = lead = 2;
   }
 
-  /* add the extra CRLF if the person isn't in compact mode */
-  if (STATE(t) == CON_PLAYING && t->character && !IS_NPC(t->character) &&
-          !PRF_FLAGGED(t->character, PRF_COMPACT)) {
-    if (!t->pProtocol->WriteOOB)
-      strcat(osb, "\r\n"); /* strcpy: OK (osb:MAX_SOCK_BUF-2 reserves space) */
+  /* now, the 'real' output, as much of it as there is room for this time */
+  for (span = t->out_head; span && count < OUT_IOV_MAX - 1; span = span->next) {
+    iov[count].iov_base = span->block->text + span->start;
+    iov[count++].iov_len = span->end - span->start;
+    queued += span->end - span->start;
   }
 
-  if (!t->pProtocol->WriteOOB) /* add a prompt */
-    strcat(i, make_prompt(t)); /* strcpy: OK (i:MAX_SOCK_BUF reserves space) */
+  /* The rest only goes out after the last of the output. */
+  if (!span) {
+    /* if we're in the overflow state, notify the user */
+    if (t->bufptr >= output_cap())
+      strcat(trailer, "**OVERFLOW**"); /* strcpy: OK (trailer reserves GARBAGE_SPACE) */
+
+    /* add the extra CRLF if the person isn't in compact mode */
+    if (STATE(t) == CON_PLAYING && t->character && !IS_NPC(t->character) &&
+            !PRF_FLAGGED(t->character, PRF_COMPACT)) {
+      if (!t->pProtocol->WriteOOB)
+        strcat(trailer, "\r\n"); /* strcpy: OK (trailer reserves GARBAGE_SPACE) */
+    }
+
+    if (!t->pProtocol->WriteOOB) { /* add a prompt */
+      prompt = make_prompt(t);
+      strncat(trailer, prompt, MAX_PROMPT_LENGTH - 1);
+    }
 
-  /* now, send the output.  If this is an 'interruption', use the prepended
-   * CRLF, otherwise send the straight output sans CRLF. */
-  if (t->has_prompt && !t->pProtocol->WriteOOB) {
+    if (*trailer) {
+      iov[count].iov_base = trailer;
+      iov[count++].iov_len = strlen(trailer);
+    }
+  }
+
+  if (lead)
     t->has_prompt = FALSE;
-    result = write_to_descriptor(t->descriptor, i);
-    if (result >= 2)
-      result -= 2;
-  } else
-    result = write_to_descriptor(t->descriptor, osb);
+
+  result = writev_to_client(t, iov, count);
 
   if (result < 0) { /* Oops, fatal error. Bye! */
     close_socket(t);
@@ -1993,42 +2303,23 @@ static int process_output(struct descriptor_data *t) {
   } else if (result == 0) /* Socket buffer full. Try later. */
     return (0);
 
-  /* Handle snooping: prepend "% " and send to snooper. */
-  if (t->snoop_by)
-    write_to_output(t->snoop_by, "%% %*s%%%%", result, t->output);
-
-  /* The common case: all saved output was handed off to the kernel buffer. */
-  if (result >= t->bufptr) {
-    /* If we were using a large buffer, put the large buffer on the buffer pool
-     * and switch back to the small one. */
-    if (t->large_outbuf) {
-      t->large_outbuf->next = bufpool;
-      bufpool = t->large_outbuf;
-      t->large_outbuf = NULL;
-      t->output = t->small_outbuf;
-    }
-    /* reset total bufspace back to that of a small buffer */
-    t->bufspace = SMALL_BUFSIZE - 1;
-    t->bufptr = 0;
-    *(t->output) = '\0';
-
-    /* If the overflow message or prompt were partially written, try to save
-     * them. There will be enough space for them if this is true.  'result'
-     * is effectively unsigned here anyway. */
-    if ((unsigned int) result < strlen(osb)) {
-      size_t savetextlen = strlen(osb + result);
-
-      strcat(t->output, osb + result);
-      t->bufptr -= savetextlen;
-      t->bufspace += savetextlen;
-    }
+  if ((result -= lead) <= 0)
+    return (0);
 
-  } else {
-    /* Not all data in buffer sent.  result < output buffersize. */
-    strcpy(t->output, t->output + result); /* strcpy: OK (overlap) */
-    t->bufptr -= result;
-    t->bufspace += result;
+  /* Handle snooping: prepend "% " and send to snooper. */
+  if (t->snoop_by) {
+    write_to_output(t->snoop_by, "%% ");
+    share_output(t->snoop_by, t, MIN(result, queued));
+    write_to_output(t->snoop_by, "%%%%");
   }
+
+  discard_output(t, MIN(result, queued));
+
+  /* If the overflow message or prompt were partially written, try to save
+   * them. There will be enough space for them if this is true. */
+  if (result > queued && result - queued < strlen(trailer))
+    append_output(t, trailer + result - queued, strlen(trailer) - (result - queued));
+
   return (result);
 }
 
@@ -2089,8 +2380,9 @@ static ssize_t perform_socket_write(socket_t desc, const char *txt, size_t lengt
   }
 
   if (result == 0) {
-    /* This should never happen! */
-    log("SYSERR: Huh??  write() returned 0???  Please report this!");
+    /* This should never happen!  The network thread may be the writer and
+     * can't log(), so leave it to the caller's perror(). */
+    errno = EIO;
     return (-1);
   }
 
@@ -2117,6 +2409,64 @@ static ssize_t perform_socket_write(socket_t desc, const char *txt, size_t lengt
 }
 #endif /* CIRCLE_WINDOWS */
 
+/* perform_socket_writev: perform_socket_write for several pieces of text at
+ * once, in one system call where the platform has writev().  Returns the
+ * same as perform_socket_write. */
+#if defined(CIRCLE_WINDOWS) || !defined(HAVE_SYS_UIO_H)
+
+static ssize_t perform_socket_writev(socket_t desc, const struct iovec *iov, int iovcnt) {
+  ssize_t result, total = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++) {
+    if (iov[i].iov_len == 0)
+      continue;
+    result = perform_socket_write(desc, iov[i].iov_base, iov[i].iov_len);
+    if (result <= 0)
+      return (total ? total : result);
+    total += result;
+    if (result < iov[i].iov_len)
+      break;
+  }
+
+  return (total);
+}
+
+#else
+
+static ssize_t perform_socket_writev(socket_t desc, const struct iovec *iov, int iovcnt) {
+  ssize_t result;
+
+  result = writev(desc, iov, iovcnt);
+
+  if (result > 0)
+    return (result);
+
+  if (result == 0) {
+    /* This should never happen!  Reported as for perform_socket_write(). */
+    errno = EIO;
+    return (-1);
+  }
+
+#ifdef EAGAIN		/* POSIX */
+  if (errno == EAGAIN)
+    return (0);
+#endif
+
+#ifdef EWOULDBLOCK	/* BSD */
+  if (errno == EWOULDBLOCK)
+    return (0);
+#endif
+
+#ifdef EDEADLK		/* Macintosh */
+  if (errno == EDEADLK)
+    return (0);
+#endif
+
+  return (-1);
+}
+#endif /* CIRCLE_WINDOWS || !HAVE_SYS_UIO_H */
+
 /* write_to_descriptor takes a descriptor, and text to write to the descriptor.
  * It keeps calling the system-level write() until all the text has been
  * delivered to the OS, or until an error is encountered. Returns:
@@ -2146,6 +2496,658 @@ int write_to_descriptor(socket_t desc, const char *txt) {
   return (write_total);
 }
 
+/* Sends whatever d's MCCP compressor has waiting for the socket.  Returns
+ * -1 on a fatal error, otherwise 0, with anything the socket would not take
+ * still waiting. */
+static int flush_compressed(struct descriptor_data *d) {
+  const char *txt;
+  ssize_t bytes_written;
+  int length;
+
+  while ((txt = CompressPending(d, &length))) {
+    if ((bytes_written = perform_socket_write(d->descriptor, txt, length)) < 0) {
+      perror("SYSERR: Write to socket");
+      return (-1);
+    } else if (bytes_written == 0)
+      break;
+    CompressSent(d, bytes_written);
+  }
+
+  return (0);
+}
+
+/* writev_to_client is write_to_descriptor for a connected descriptor and
+ * several pieces of text: they go to the socket together, through its MCCP
+ * compressor if it has one.  All of the text is taken once it has been
+ * compressed; what the socket will not take waits and goes out ahead of the
+ * next write, and until it has nothing new is taken (0 is returned).  The
+ * iovecs are used up. */
+static int writev_to_client(struct descriptor_data *d, struct iovec *iov, int iovcnt) {
+  ssize_t bytes_written;
+  int total = 0, write_total = 0, i;
+
+  for (i = 0; i < iovcnt; i++)
+    total += iov[i].iov_len;
+
+  if (!CompressUpdate(d))
+    return (-1);
+  if (CompressPending(d, NULL) || CompressActive(d)) {
+    if (flush_compressed(d) < 0)
+      return (-1);
+    if (CompressPending(d, NULL))
+      return (0);
+    if (CompressActive(d)) {
+      if (total == 0)
+        return (0);
+      for (i = 0; i < iovcnt; i++)
+        if (!CompressOutput(d, iov[i].iov_base, iov[i].iov_len, i == iovcnt - 1))
+          return (-1);
+      if (flush_compressed(d) < 0)
+        return (-1);
+      return (total);
+    }
+  }
+
+  while (write_total < total) {
+    for (; iov->iov_len == 0; iov++, iovcnt--);
+
+    bytes_written = perform_socket_writev(d->descriptor, iov, iovcnt);
+
+    if (bytes_written < 0) {
+      /* Fatal error.  Disconnect the player. */
+      perror("SYSERR: Write to socket");
+      return (-1);
+    } else if (bytes_written == 0) {
+      /* Temporary failure -- socket buffer full. */
+      return (write_total);
+    }
+
+    write_total += bytes_written;
+    for (; iovcnt > 0 && bytes_written >= iov->iov_len; iov++, iovcnt--)
+      bytes_written -= iov->iov_len;
+    if (bytes_written > 0) {
+      iov->iov_base = (char *) iov->iov_base + bytes_written;
+      iov->iov_len -= bytes_written;
+    }
+  }
+
+  return (write_total);
+}
+
+/* write_to_client is writev_to_client for a single piece of text. */
+int write_to_client(struct descriptor_data *d, const char *txt) {
+  struct iovec iov;
+
+  /* The network thread's sockets take it in turn behind what is queued. */
+  if (NET_OWNED(d)) {
+    hand_text(d, txt, strlen(txt));
+    return (strlen(txt));
+  }
+
+  iov.iov_base = (char *) txt;
+  iov.iov_len = strlen(txt);
+
+  return (writev_to_client(d, &iov, 1));
+}
+
+/* The network thread.  With it, the game loop no longer reads from or writes
+ * to players' sockets itself: each descriptor gets a net_conn, and the
+ * thread reads whatever arrives into the connection's input ring and writes
+ * (compressing it on the way, for MCCP) whatever output spans the game puts
+ * on its output ring.  Each ring has one writer and one reader, so neither
+ * side ever waits for the other; the game takes the bytes read in
+ * process_input() and the spans sent back in net_reclaim(), and wakes the
+ * thread through a pipe once a pass when it has handed over output.
+ *
+ * Telnet negotiation and colour codes are still handled by the game, which
+ * owns everything they touch.  Output blocks are only ever allocated and
+ * freed by the game; the thread just reads the text of spans it has been
+ * handed until it says it has sent them.  With io_thread off, or where there
+ * are no threads, the game loop serves the sockets as it always did. */
+#ifdef CIRCLE_IO_THREAD
+
+#define NET_IN_SIZE 4096   /* bytes of input that can wait for the game */
+#define NET_OUT_SLOTS 256  /* output spans that can wait for the thread */
+#define NET_NEW_SLOTS 64   /* connections that can wait for the thread */
+
+#define NET_EOF 1          /* the player hung up */
+#define NET_FAILED 2       /* the socket failed, and it has been reported */
+
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/* While the thread runs, each field is written by one side only: the
+ * thread or the game. */
+struct net_conn {
+  struct descriptor_data *d;
+  socket_t fd;
+
+  char in[NET_IN_SIZE];
+  unsigned int in_head;    /* thread: bytes read from the socket */
+  unsigned int in_tail;    /* game: bytes taken by process_input() */
+
+  struct out_span *out[NET_OUT_SLOTS];
+  unsigned int out_head;   /* game: spans handed over */
+  unsigned int out_sent;   /* thread: spans written to the socket */
+  unsigned int out_done;   /* game: spans let go of again */
+  int out_offset;          /* thread: bytes written of out[out_sent] */
+
+  int lost;                /* thread: NET_EOF or NET_FAILED */
+  int closing;             /* game: asks the thread to let go of it */
+  int released;            /* thread: it has */
+
+  /* The thread's own. */
+  bool readable;
+  bool write_blocked;
+  struct net_conn *next;
+};
+
+static pthread_t net_thread;
+static int net_stop = 0; /* game: asks the thread to finish */
+static int net_epoll = -1; /* what the thread waits on */
+static int net_pipe[2] = {-1, -1}; /* game wakes the thread through this */
+static struct net_conn *net_new[NET_NEW_SLOTS]; /* connections to take on */
+static unsigned int net_new_head = 0; /* game */
+static unsigned int net_new_tail = 0; /* thread */
+static bool net_handed = FALSE; /* game: output handed over this pass */
+
+/* Reads what c's socket has for the game, as long as there is room for it.
+ * Mirrors perform_socket_read(), except that nothing here may log(). */
+static void net_fill(struct net_conn *c) {
+  unsigned int head = c->in_head, room, at;
+  ssize_t ret;
+
+  while ((room = NET_IN_SIZE - (head - LOAD_ACQUIRE(&c->in_tail))) > 0) {
+    at = head % NET_IN_SIZE;
+    ret = read(c->fd, c->in + at, MIN(room, NET_IN_SIZE - at));
+
+    if (ret > 0) {
+      head += ret;
+      STORE_RELEASE(&c->in_head, head);
+      continue;
+    }
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      c->readable = FALSE;
+      return;
+    }
+    if (ret < 0 && errno != ECONNRESET)
+      perror("SYSERR: network thread: about to lose connection");
+    STORE_RELEASE(&c->lost, ret == 0 ? NET_EOF : NET_FAILED);
+    return;
+  }
+  /* The ring is full: c stays readable until the game makes room. */
+}
+
+/* Writes what the game has handed over for c until the socket will take no
+ * more, through writev_to_client() so that MCCP works as it does without
+ * the thread. */
+static void net_flush(struct net_conn *c) {
+  struct iovec iov[OUT_IOV_MAX];
+  struct out_span *span;
+  unsigned int sent = c->out_sent, head = LOAD_ACQUIRE(&c->out_head), i;
+  int count, result, n, skip;
+
+  while (sent != head || CompressPending(c->d, NULL)) {
+    for (count = 0, i = sent; i != head && count < OUT_IOV_MAX; i++, count++) {
+      span = c->out[i % NET_OUT_SLOTS];
+      skip = (i == sent ? c->out_offset : 0);
+      iov[count].iov_base = span->block->text + span->start + skip;
+      iov[count].iov_len = span->end - span->start - skip;
+    }
+
+    if ((result = writev_to_client(c->d, iov, count)) < 0) {
+      STORE_RELEASE(&c->lost, NET_FAILED);
+      return;
+    }
+
+    for (; count > 0; count--) {
+      span = c->out[sent % NET_OUT_SLOTS];
+      n = span->end - span->start - c->out_offset;
+      if (result < n) {
+        c->out_offset += result;
+        break;
+      }
+      result -= n;
+      c->out_offset = 0;
+      sent++;
+    }
+    STORE_RELEASE(&c->out_sent, sent);
+
+    /* Wait for epoll to say there is room again. */
+    if (count > 0 || CompressPending(c->d, NULL)) {
+      c->write_blocked = TRUE;
+      return;
+    }
+  }
+}
+
+static void *net_loop(void *unused) {
+  struct epoll_event events[MAX_POLL_EVENTS], ev;
+  struct net_conn *conns = NULL, *c, **prev;
+  unsigned int tail;
+  bool stalled = FALSE;
+  char drain[64];
+  int i, n;
+
+  while (!LOAD_ACQUIRE(&net_stop)) {
+    /* A connection with a full input ring has to be looked at again once
+     * the game has had a chance to empty it. */
+    if ((n = epoll_wait(net_epoll, events, MAX_POLL_EVENTS, stalled ? 100 : -1)) < 0) {
+      if (errno != EINTR) {
+        perror("SYSERR: network thread: epoll_wait");
+        sleep(1);
+      }
+      n = 0;
+    }
+
+    for (i = 0; i < n; i++) {
+      if (!(c = events[i].data.ptr)) {
+        while (read(net_pipe[0], drain, sizeof (drain)) > 0);
+        continue;
+      }
+      if (events[i].events & (EPOLLIN | EPOLLPRI | EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+        c->readable = TRUE;
+      if (events[i].events & EPOLLOUT)
+        c->write_blocked = FALSE;
+    }
+
+    /* Take on the connections the game has made since last time. */
+    for (tail = net_new_tail; tail != LOAD_ACQUIRE(&net_new_head); tail++) {
+      c = net_new[tail % NET_NEW_SLOTS];
+      c->readable = TRUE;
+      c->write_blocked = FALSE;
+      c->next = conns;
+      conns = c;
+
+      ev.events = EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP | EPOLLET;
+      ev.data.ptr = c;
+      if (epoll_ctl(net_epoll, EPOLL_CTL_ADD, c->fd, &ev) < 0) {
+        perror("SYSERR: network thread: epoll_ctl add");
+        STORE_RELEASE(&c->lost, NET_FAILED);
+      }
+    }
+    STORE_RELEASE(&net_new_tail, tail);
+
+    stalled = FALSE;
+    for (prev = &conns; (c = *prev);) {
+      if (LOAD_ACQUIRE(&c->closing)) {
+        epoll_ctl(net_epoll, EPOLL_CTL_DEL, c->fd, NULL);
+        *prev = c->next;
+        STORE_RELEASE(&c->released, 1); /* the game may free it now */
+        continue;
+      }
+      if (!LOAD_ACQUIRE(&c->lost) && c->readable)
+        net_fill(c);
+      if (!LOAD_ACQUIRE(&c->lost) && !c->write_blocked)
+        net_flush(c);
+      if (!LOAD_ACQUIRE(&c->lost) && c->readable)
+        stalled = TRUE;
+      prev = &c->next;
+    }
+  }
+
+  return (NULL);
+}
+
+/* Wakes the thread up out of epoll_wait(). */
+static void net_poke(void) {
+  char c = 0;
+
+  if (write(net_pipe[1], &c, 1) < 0 && errno != EAGAIN)
+    perror("SYSERR: network thread: wake");
+}
+
+/* Called once a pass, after all the output has been handed over. */
+static void net_wake(void) {
+  if (net_handed) {
+    net_handed = FALSE;
+    net_poke();
+  }
+}
+
+/* Starts the network thread, if it is wanted, and hands it every socket
+ * there already is (after a copyover). */
+static void start_net_thread(void) {
+  struct descriptor_data *d;
+  struct epoll_event ev;
+  sigset_t all, old;
+  int err;
+
+  if (!io_thread || net_running)
+    return;
+
+  if (pipe(net_pipe) < 0) {
+    perror("SYSERR: network thread: pipe");
+    return;
+  }
+  nonblock(net_pipe[0]);
+  nonblock(net_pipe[1]);
+
+  if ((net_epoll = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    perror("SYSERR: network thread: epoll_create1");
+    close(net_pipe[0]);
+    close(net_pipe[1]);
+    return;
+  }
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  epoll_ctl(net_epoll, EPOLL_CTL_ADD, net_pipe[0], &ev);
+
+  net_stop = 0;
+  net_new_head = net_new_tail = 0;
+
+  /* Signals are for the game loop, so the thread starts with them blocked. */
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &old);
+  err = pthread_create(&net_thread, NULL, net_loop, NULL);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  if (err) {
+    log("SYSERR: Unable to start the network thread (%s); sockets will be served from the game loop.", strerror(err));
+    close(net_epoll);
+    close(net_pipe[0]);
+    close(net_pipe[1]);
+    net_epoll = -1;
+    return;
+  }
+
+  net_running = TRUE;
+  log("Network thread started.");
+
+  for (d = descriptor_list; d; d = d->next)
+    if (net_attach(d))
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, d->descriptor, NULL);
+  net_wake();
+}
+
+/* Stops the network thread and gives its sockets back to the game loop,
+ * with whatever output it had not sent yet back at the front of their
+ * queues.  Anything it had read and the game had not is taken from the
+ * input ring before the socket is read again. */
+void stop_net_thread(void) {
+  struct descriptor_data *d;
+  struct net_conn *c;
+  struct out_span *span;
+
+  if (!net_running)
+    return;
+
+  STORE_RELEASE(&net_stop, 1);
+  net_poke();
+  pthread_join(net_thread, NULL);
+  net_running = FALSE;
+
+  close(net_epoll);
+  close(net_pipe[0]);
+  close(net_pipe[1]);
+  net_epoll = -1;
+
+  for (d = descriptor_list; d; d = d->next) {
+    if (!(c = d->conn))
+      continue;
+
+    net_reclaim(d);
+    while (c->out_head != c->out_done) {
+      span = c->out[--c->out_head % NET_OUT_SLOTS];
+      if (!(span->next = d->out_head))
+        d->out_tail = span;
+      d->out_head = span;
+    }
+    if (d->out_head) {
+      d->out_head->start += c->out_offset;
+      d->bufptr -= c->out_offset;
+    }
+    c->out_sent = c->out_done = c->out_head;
+    c->out_offset = 0;
+
+    d->io_flags |= DIO_INPUT;
+    watch_socket(d->descriptor, d);
+  }
+
+  log("Network thread stopped.");
+}
+
+/* Hands d's socket to the network thread.  Returns FALSE if the thread is
+ * not running or has too many new connections waiting already, and the game
+ * loop should watch it instead.  A connection kept from before the thread
+ * was last stopped is handed back as it is. */
+static bool net_attach(struct descriptor_data *d) {
+  struct net_conn *c;
+
+  if (!net_running || net_new_head - LOAD_ACQUIRE(&net_new_tail) >= NET_NEW_SLOTS)
+    return (FALSE);
+
+  if (!(c = d->conn)) {
+    CREATE(c, struct net_conn, 1);
+    c->d = d;
+    c->fd = d->descriptor;
+    d->conn = c;
+  }
+  d->io_flags &= ~(DIO_INPUT | DIO_BLOCKED);
+
+  net_new[net_new_head % NET_NEW_SLOTS] = c;
+  STORE_RELEASE(&net_new_head, net_new_head + 1);
+  net_handed = TRUE;
+
+  return (TRUE);
+}
+
+/* Takes d's socket back from the network thread, before it is closed, and
+ * drops whatever output was still waiting for it. */
+static void net_detach(struct descriptor_data *d) {
+  struct net_conn *c = d->conn;
+  struct out_span *span;
+
+  if (!c)
+    return;
+
+  if (net_running) {
+    STORE_RELEASE(&c->closing, 1);
+    net_poke();
+    while (!LOAD_ACQUIRE(&c->released))
+      sched_yield();
+  }
+
+  net_reclaim(d);
+  for (; c->out_done != c->out_head; c->out_done++) {
+    span = c->out[c->out_done % NET_OUT_SLOTS];
+    d->bufptr -= span->end - span->start;
+    free_span(span);
+  }
+
+  free(c);
+  d->conn = NULL;
+}
+
+/* Whether the network thread has read anything for d, or lost it. */
+static bool net_pending(struct descriptor_data *d) {
+  struct net_conn *c = d->conn;
+
+  return (c && (LOAD_ACQUIRE(&c->in_head) != c->in_tail || LOAD_ACQUIRE(&c->lost)));
+}
+
+/* perform_socket_read for a descriptor the network thread reads for; it
+ * returns the same. */
+static ssize_t net_read(struct descriptor_data *d, char *buf, size_t len) {
+  struct net_conn *c = d->conn;
+  int lost = LOAD_ACQUIRE(&c->lost); /* before in_head: it is set after */
+  unsigned int head = LOAD_ACQUIRE(&c->in_head), tail = c->in_tail;
+  size_t n = 0, chunk;
+
+  while (head != tail && n < len) {
+    chunk = MIN(len - n, MIN(head - tail, NET_IN_SIZE - tail % NET_IN_SIZE));
+    memcpy(buf + n, c->in + tail % NET_IN_SIZE, chunk);
+    n += chunk;
+    tail += chunk;
+  }
+
+  if (n) {
+    STORE_RELEASE(&c->in_tail, tail);
+    return (n);
+  }
+
+  if (lost) {
+    if (lost == NET_EOF)
+      log("WARNING: EOF on socket read (connection broken by peer)");
+    return (-1);
+  }
+
+  /* The thread has been stopped: the socket is ours again. */
+  if (!net_running)
+    return (perform_socket_read(d->descriptor, buf, len));
+
+  return (0);
+}
+
+/* Lets go of the spans the network thread has sent for d. */
+static void net_reclaim(struct descriptor_data *d) {
+  struct net_conn *c = d->conn;
+  struct out_span *span;
+  unsigned int sent = LOAD_ACQUIRE(&c->out_sent);
+
+  for (; c->out_done != sent; c->out_done++) {
+    span = c->out[c->out_done % NET_OUT_SLOTS];
+    d->bufptr -= span->end - span->start;
+    free_span(span);
+  }
+}
+
+/* Moves as much of t's queued output as there is room for onto its output
+ * ring, in order.  The spans are the thread's until it has sent them, but
+ * t->bufptr still counts them until then. */
+static int hand_spans(struct descriptor_data *t) {
+  struct net_conn *c = t->conn;
+  struct out_span *span;
+  int handed = 0;
+
+  while ((span = t->out_head) && c->out_head - c->out_done < NET_OUT_SLOTS) {
+    if (!(t->out_head = span->next))
+      t->out_tail = NULL;
+    span->next = NULL;
+    handed += span->end - span->start;
+
+    c->out[c->out_head % NET_OUT_SLOTS] = span;
+    STORE_RELEASE(&c->out_head, c->out_head + 1);
+  }
+  if (handed)
+    net_handed = TRUE;
+
+  return (handed);
+}
+
+/* Queues len bytes of txt behind everything else for t, and hands them to
+ * the network thread if there is room. */
+static void hand_text(struct descriptor_data *t, const char *txt, int len) {
+  if (len > 0) {
+    append_output(t, txt, len);
+    hand_spans(t);
+  }
+}
+
+/* process_output() for a descriptor the network thread writes for: the
+ * same text, in the same order, goes onto its output ring instead of out
+ * through writev(). */
+static int hand_output(struct descriptor_data *t) {
+  struct net_conn *c = t->conn;
+  struct out_block *b;
+  struct out_span *span;
+  char trailer[GARBAGE_SPACE + MAX_PROMPT_LENGTH];
+  int room, queued = 0, lead = 0;
+
+  net_reclaim(t);
+
+  if ((room = NET_OUT_SLOTS - (c->out_head - c->out_done)) == 0)
+    return (0);
+
+  /* if this is an 'interruption', start with a CRLF */
+  if (t->has_prompt && !t->pProtocol->WriteOOB) {
+    b = new_out_block();
+    strcpy(b->text, "\r\n"); /* strcpy: OK (OUT_BLOCK_SIZE > 2) */
+    t->bufptr += lead = 2;
+    c->out[c->out_head % NET_OUT_SLOTS] = new_span(b, 0, lead);
+    STORE_RELEASE(&c->out_head, c->out_head + 1);
+    net_handed = TRUE;
+    room--;
+    t->has_prompt = FALSE;
+  }
+
+  /* Handle snooping: prepend "% " and send to snooper. */
+  for (span = t->out_head; span != NULL && room > 0; span = span->next, room--)
+    queued += span->end - span->start;
+  if (t->snoop_by && queued > 0) {
+    write_to_output(t->snoop_by, "%% ");
+    share_output(t->snoop_by, t, queued);
+    write_to_output(t->snoop_by, "%%%%");
+  }
+
+  hand_spans(t);
+
+  /* The rest only goes out after the last of the output. */
+  if (!t->out_head) {
+    *trailer = '\0';
+
+    /* if we're in the overflow state, notify the user */
+    if (t->bufptr >= output_cap())
+      strcat(trailer, "**OVERFLOW**"); /* strcpy: OK (trailer reserves GARBAGE_SPACE) */
+
+    /* add the extra CRLF if the person isn't in compact mode */
+    if (STATE(t) == CON_PLAYING && t->character && !IS_NPC(t->character) &&
+            !PRF_FLAGGED(t->character, PRF_COMPACT)) {
+      if (!t->pProtocol->WriteOOB)
+        strcat(trailer, "\r\n"); /* strcpy: OK (trailer reserves GARBAGE_SPACE) */
+    }
+
+    if (!t->pProtocol->WriteOOB) /* add a prompt */
+      strncat(trailer, make_prompt(t), MAX_PROMPT_LENGTH - 1);
+
+    hand_text(t, trailer, strlen(trailer));
+  }
+
+  return (lead + queued);
+}
+
+#else /* !CIRCLE_IO_THREAD */
+
+static void start_net_thread(void) {
+  if (io_thread)
+    log("No network thread on this system; sockets will be served from the game loop.");
+}
+
+void stop_net_thread(void) {
+}
+
+static bool net_attach(struct descriptor_data *d) {
+  return (FALSE);
+}
+
+static void net_detach(struct descriptor_data *d) {
+}
+
+static bool net_pending(struct descriptor_data *d) {
+  return (FALSE);
+}
+
+static ssize_t net_read(struct descriptor_data *d, char *buf, size_t len) {
+  return (perform_socket_read(d->descriptor, buf, len));
+}
+
+static void net_reclaim(struct descriptor_data *d) {
+}
+
+static void net_wake(void) {
+}
+
+static int hand_output(struct descriptor_data *t) {
+  return (0);
+}
+
+static void hand_text(struct descriptor_data *t, const char *txt, int len) {
+}
+
+#endif /* CIRCLE_IO_THREAD */
+
 /* Same information about perform_socket_write applies here. I like
  * standards, there are so many of them. -gg 6/30/98 */
 static ssize_t perform_socket_read(socket_t desc, char *read_point, size_t space_left) {
@@ -2240,9 +3242,11 @@ static int process_input(struct descriptor_data *t) {
 
     /* Read # of "bytes_read" from socket, and if we have something, mark the
      * sizeof data in the read_buf array as NULL */
-    if ((bytes_read =
+    if ((bytes_read = t->conn ? net_read(t, read_buf, space_left) :
             perform_socket_read(t->descriptor, read_buf, space_left)) > 0)
       read_buf[bytes_read] = '\0';
+    else if (bytes_read == 0) /* drained: wait to hear there is more */
+      t->io_flags &= ~DIO_INPUT;
 
     /* Since we have received at least 1 byte of data from the socket, lets run
      * it through ProtocolInput() and rip out anything that is Out Of Band */
@@ -2316,7 +3320,7 @@ static int process_input(struct descriptor_data *t) {
       char buffer[MAX_INPUT_LENGTH + 64];
 
       snprintf(buffer, sizeof (buffer), "Line too long.  Truncated to:\r\n%s\r\n", tmp);
-      if (write_to_descriptor(t->descriptor, buffer) < 0)
+      if (write_to_client(t, buffer) < 0)
         return (-1);
     }
     if (t->snoop_by)
@@ -2434,8 +3438,14 @@ void close_socket(struct descriptor_data *d) {
   struct descriptor_data *temp;
 
   REMOVE_FROM_LIST(d, descriptor_list, next);
+  net_detach(d);
+#ifdef CIRCLE_EPOLL
+  if (epoll_fd >= 0)
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, d->descriptor, NULL);
+#endif
   CLOSE_SOCKET(d->descriptor);
   flush_queues(d);
+  clear_output(d);
 
   /* Forget snooping */
   if (d->snooping)
@@ -2452,6 +3462,7 @@ void close_socket(struct descriptor_data *d) {
 
     /* If we're switched, this resets the mobile taken. */
     d->character->desc = NULL;
+    zone_occupant_changed(d->character);
 
     /* Plug memory leak, from Eric Green. */
     if (!IS_NPC(d->character) && PLR_FLAGGED(d->character, PLR_MAILING) && d->str) {
@@ -2499,6 +3510,7 @@ void close_socket(struct descriptor_data *d) {
     free(d->showstr_vector);
 
   /* KaVir's plugin*/
+  CompressReport(d);
   ProtocolDestroy(d->pProtocol);
 
   /* Mud Events */
@@ -2896,124 +3908,197 @@ const char *ACTNULL = "<NULL>";
 #define CHECK_NULL(pointer, expression) \
   if ((pointer) == NULL) i = ACTNULL; else i = (expression);
 
+/* An act() string is broken up once into the runs of plain text between its
+ * $-codes, and each person it goes to just gets the runs with the codes
+ * filled in for them, rather than the string being scanned again for every
+ * one of them. */
+#define ACT_MAX_CODES  128
+
+struct act_segment {
+  const char *text; /* plain text up to the code */
+  int len;
+  char code; /* letter after the '$', or '\0' after the last run */
+};
+
+struct act_template {
+  const char *orig;
+  struct act_segment seg[ACT_MAX_CODES + 1];
+};
+
+/* Whether the person a message is going to can see who and what it names,
+ * worked out the first time a code needs it: -1 until then. */
+struct act_sight {
+  sbyte ch, vict, obj, vict_obj;
+};
+
+#define ACT_SEES(known, test) ((known) < 0 ? ((known) = ((test) ? 1 : 0)) : (known))
+
+static void compile_act(const char *orig, struct act_template *tmpl) {
+  struct act_segment *seg = tmpl->seg;
+
+  tmpl->orig = orig;
+
+  for (;; seg++) {
+    seg->text = orig;
+    while (*orig && *orig != '$')
+      orig++;
+    seg->len = orig - seg->text;
+
+    if (!*orig || !*(orig + 1)) {
+      if (*orig)
+        log("SYSERR: Illegal $-code to act(): end of string in %s", tmpl->orig);
+      seg->code = '\0';
+      return;
+    }
+
+    if (seg == &tmpl->seg[ACT_MAX_CODES]) {
+      log("SYSERR: More than %d $-codes to act(): %s", ACT_MAX_CODES, tmpl->orig);
+      seg->len += strlen(orig);
+      seg->code = '\0';
+      return;
+    }
+
+    seg->code = *(++orig);
+    orig++;
+  }
+}
+
+static const char *act_pers(struct char_data *ch, int sees) {
+  if (!sees)
+    return "someone";
+  return !GET_DISGUISE_RACE(ch) ? GET_NAME(ch) : race_list[GET_DISGUISE_RACE(ch)].name;
+}
+
+/* Copies len bytes of i to *bufp, uppercasing the first thing that is not a
+ * space if a $U is waiting for it, and not running past end. */
+static void act_append(char **bufp, char *end, const char *i, size_t len, bool *uppercasenext) {
+  char *buf = *bufp;
+
+  if (len > (size_t) (end - buf))
+    len = end - buf;
+
+  for (; *uppercasenext && len; len--) {
+    if (!isspace((int) (*buf++ = *i++))) {
+      *(buf - 1) = UPPER(*(buf - 1));
+      *uppercasenext = FALSE;
+    }
+  }
+
+  memcpy(buf, i, len);
+  *bufp = buf + len;
+}
+
 /* higher-level communication: the act() function */
-void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
-        void *vict_obj, struct char_data *to, bool carrier_return) {
+static void perform_act_template(const struct act_template *tmpl, struct char_data *ch,
+        struct obj_data *obj, void *vict_obj, struct char_data *to,
+        struct act_sight *sight, bool carrier_return) {
+  const struct act_segment *seg;
   const char *i = NULL;
-  char lbuf[MAX_STRING_LENGTH] = {'\0'}, *buf = NULL, *j = NULL;
+  char lbuf[MAX_STRING_LENGTH], *buf = lbuf, *j = NULL;
+  char *end = lbuf + sizeof (lbuf) - 3; /* room for the \r\n */
   bool uppercasenext = FALSE;
-  struct char_data *dg_victim = NULL;
-  struct obj_data *dg_target = NULL;
+  struct char_data *dg_victim = NULL, *vict_c = (struct char_data *) vict_obj;
+  struct obj_data *dg_target = NULL, *vict_o = (struct obj_data *) vict_obj;
   char *dg_arg = NULL;
 
-  buf = lbuf;
-
-  for (;;) {
-    if (*orig == '$') {
-      switch (*(++orig)) {
-        case 'n':
-          i = PERS(ch, to);
-          break;
-        case 'N':
-          CHECK_NULL(vict_obj, PERS((struct char_data *) vict_obj, to));
-          dg_victim = (struct char_data *) vict_obj;
-          break;
-        case 'm':
-          i = HMHR(ch);
-          break;
-        case 'M':
-          CHECK_NULL(vict_obj, HMHR((const struct char_data *) vict_obj));
-          dg_victim = (struct char_data *) vict_obj;
-          break;
-        case 's':
-          i = HSHR(ch);
-          break;
-        case 'S':
-          CHECK_NULL(vict_obj, HSHR((const struct char_data *) vict_obj));
-          dg_victim = (struct char_data *) vict_obj;
-          break;
-        case 'e':
-          i = HSSH(ch);
-          break;
-        case 'E':
-          CHECK_NULL(vict_obj, HSSH((const struct char_data *) vict_obj));
-          dg_victim = (struct char_data *) vict_obj;
-          break;
-        case 'o':
-          CHECK_NULL(obj, OBJN(obj, to));
-          break;
-        case 'O':
-          CHECK_NULL(vict_obj, OBJN((const struct obj_data *) vict_obj, to));
-          dg_target = (struct obj_data *) vict_obj;
-          break;
-        case 'p':
-          CHECK_NULL(obj, OBJS(obj, to));
-          break;
-        case 'P':
-          CHECK_NULL(vict_obj, OBJS((const struct obj_data *) vict_obj, to));
-          dg_target = (struct obj_data *) vict_obj;
-          break;
-        case 'a':
-          CHECK_NULL(obj, SANA(obj));
-          break;
-        case 'A':
-          CHECK_NULL(vict_obj, SANA((const struct obj_data *) vict_obj));
-          dg_target = (struct obj_data *) vict_obj;
-          break;
-        case 'T':
-          CHECK_NULL(vict_obj, (const char *) vict_obj);
-          dg_arg = (char *) vict_obj;
-          break;
-        case 't':
-          CHECK_NULL(obj, (char *) obj);
-          break;
-        case 'F':
-          CHECK_NULL(vict_obj, fname((const char *) vict_obj));
-          break;
-          /* uppercase previous word */
-        case 'u':
-          for (j = buf; j > lbuf && !isspace((int) *(j - 1)); j--);
-          if (j != buf)
-            *j = UPPER(*j);
-          i = "";
-          break;
-          /* uppercase next word */
-        case 'U':
-          uppercasenext = TRUE;
-          i = "";
-          break;
-        case '$':
-          i = "$";
-          break;
-        default:
-          log("SYSERR: Illegal $-code to act(): %c", *orig);
-          log("SYSERR: %s", orig);
-          i = "";
-          break;
-      }
-      while ((*buf = *(i++))) {
-        if (uppercasenext && !isspace((int) *buf)) {
-          *buf = UPPER(*buf);
-          uppercasenext = FALSE;
-        }
-        buf++;
-      }
-      orig++;
-    } else if (!(*(buf++) = *(orig++))) {
+  for (seg = tmpl->seg;; seg++) {
+    act_append(&buf, end, seg->text, seg->len, &uppercasenext);
+    if (!seg->code)
       break;
-    } else if (uppercasenext && !isspace((int) *(buf - 1))) {
-      *(buf - 1) = UPPER(*(buf - 1));
-      uppercasenext = FALSE;
+
+    switch (seg->code) {
+      case 'n':
+        i = act_pers(ch, ACT_SEES(sight->ch, CAN_SEE(to, ch)));
+        break;
+      case 'N':
+        CHECK_NULL(vict_c, act_pers(vict_c, ACT_SEES(sight->vict, CAN_SEE(to, vict_c))));
+        dg_victim = (struct char_data *) vict_obj;
+        break;
+      case 'm':
+        i = HMHR(ch);
+        break;
+      case 'M':
+        CHECK_NULL(vict_obj, HMHR((const struct char_data *) vict_obj));
+        dg_victim = (struct char_data *) vict_obj;
+        break;
+      case 's':
+        i = HSHR(ch);
+        break;
+      case 'S':
+        CHECK_NULL(vict_obj, HSHR((const struct char_data *) vict_obj));
+        dg_victim = (struct char_data *) vict_obj;
+        break;
+      case 'e':
+        i = HSSH(ch);
+        break;
+      case 'E':
+        CHECK_NULL(vict_obj, HSSH((const struct char_data *) vict_obj));
+        dg_victim = (struct char_data *) vict_obj;
+        break;
+      case 'o':
+        CHECK_NULL(obj, ACT_SEES(sight->obj, CAN_SEE_OBJ(to, obj)) ?
+                fname(obj->name) : "something");
+        break;
+      case 'O':
+        CHECK_NULL(vict_o, ACT_SEES(sight->vict_obj, CAN_SEE_OBJ(to, vict_o)) ?
+                fname(vict_o->name) : "something");
+        dg_target = (struct obj_data *) vict_obj;
+        break;
+      case 'p':
+        CHECK_NULL(obj, ACT_SEES(sight->obj, CAN_SEE_OBJ(to, obj)) ?
+                obj->short_description : "something");
+        break;
+      case 'P':
+        CHECK_NULL(vict_o, ACT_SEES(sight->vict_obj, CAN_SEE_OBJ(to, vict_o)) ?
+                vict_o->short_description : "something");
+        dg_target = (struct obj_data *) vict_obj;
+        break;
+      case 'a':
+        CHECK_NULL(obj, SANA(obj));
+        break;
+      case 'A':
+        CHECK_NULL(vict_obj, SANA((const struct obj_data *) vict_obj));
+        dg_target = (struct obj_data *) vict_obj;
+        break;
+      case 'T':
+        CHECK_NULL(vict_obj, (const char *) vict_obj);
+        dg_arg = (char *) vict_obj;
+        break;
+      case 't':
+        CHECK_NULL(obj, (char *) obj);
+        break;
+      case 'F':
+        CHECK_NULL(vict_obj, fname((const char *) vict_obj));
+        break;
+        /* uppercase previous word */
+      case 'u':
+        for (j = buf; j > lbuf && !isspace((int) *(j - 1)); j--);
+        if (j != buf)
+          *j = UPPER(*j);
+        i = "";
+        break;
+        /* uppercase next word */
+      case 'U':
+        uppercasenext = TRUE;
+        i = "";
+        break;
+      case '$':
+        i = "$";
+        break;
+      default:
+        log("SYSERR: Illegal $-code to act(): %c", seg->code);
+        log("SYSERR: %s", tmpl->orig);
+        i = "";
+        break;
     }
+    act_append(&buf, end, i, strlen(i), &uppercasenext);
   }
 
   if (carrier_return) {
-    *(--buf) = '\r';
-    *(++buf) = '\n';
-    *(++buf) = '\0';
-  } else {
-    *(--buf) = '\0';
+    *(buf++) = '\r';
+    *(buf++) = '\n';
   }
+  *buf = '\0';
 
   if (to->desc)
     write_to_output(to->desc, "%s", CAP(lbuf));
@@ -3021,14 +4106,23 @@ void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
   if ((IS_NPC(to) && dg_act_check) && (to != ch))
     act_mtrigger(to, lbuf, ch, dg_victim, obj, dg_target, dg_arg);
 
-  if (last_act_message)
-    free(last_act_message);
-  last_act_message = strdup(lbuf);
+  memcpy(last_act_message, lbuf, buf - lbuf + 1);
+}
+
+void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
+        void *vict_obj, struct char_data *to, bool carrier_return) {
+  struct act_template tmpl;
+  struct act_sight sight = {-1, -1, -1, -1};
+
+  compile_act(orig, &tmpl);
+  perform_act_template(&tmpl, ch, obj, vict_obj, to, &sight, carrier_return);
 }
 
 char *act(const char *str, int hide_invisible, struct char_data *ch,
         struct obj_data *obj, void *vict_obj, int type) {
   struct char_data *to = NULL;
+  struct act_template tmpl;
+  struct act_sight sight;
   int to_sleeping = 0;
 
   /*
@@ -3103,14 +4197,17 @@ char *act(const char *str, int hide_invisible, struct char_data *ch,
     return NULL;
   }
 
+  compile_act(str, &tmpl);
+
   for (; to; to = to->next_in_room) {
     if (!SENDOK(to) || (to == ch))
       continue;
-    if (hide_invisible && ch && !CAN_SEE(to, ch))
-      continue;
     if (type != TO_ROOM && to == vict_obj)
       continue;
-    perform_act(str, ch, obj, vict_obj, to, TRUE);
+    sight.ch = sight.vict = sight.obj = sight.vict_obj = -1;
+    if (hide_invisible && ch && !ACT_SEES(sight.ch, CAN_SEE(to, ch)))
+      continue;
+    perform_act_template(&tmpl, ch, obj, vict_obj, to, &sight, TRUE);
   }
   return last_act_message;
 }
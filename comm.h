@@ -51,8 +51,10 @@ char *act(const char *str, int hide_invisible, struct char_data *ch, struct obj_
 /* I/O functions */
 void	write_to_q(const char *txt, struct txt_q *queue, int aliased);
 int	write_to_descriptor(socket_t desc, const char *txt);
+int	write_to_client(struct descriptor_data *d, const char *txt);
 size_t	write_to_output(struct descriptor_data *d, const char *txt, ...) __attribute__ ((format (printf, 2, 3)));
 size_t	vwrite_to_output(struct descriptor_data *d, const char *format, va_list args);
+void	clear_output(struct descriptor_data *d);
 
 typedef RETSIGTYPE sigfunc(int);
 
@@ -61,6 +63,10 @@ void echo_on(struct descriptor_data *d);
 void game_loop(socket_t mother_desc);
 void heartbeat(int heart_pulse);
 void copyover_recover(void);
+void stop_net_thread(void);
+#ifdef CIRCLE_NO_MAIN
+void process_all_output(void);
+#endif
 
 /* global buffering system - allow access to global variables within comm.c */
 #ifndef __COMM_C__
@@ -69,9 +75,10 @@ void copyover_recover(void);
 extern long last_webster_teller;
 
 extern struct descriptor_data *descriptor_list;
-extern int buf_largecount;
-extern int buf_overflows;
-extern int buf_switches;
+extern int out_blocks;
+extern int out_overflows;
+extern int out_throttles;
+extern int out_peak;
 extern int circle_shutdown;
 extern int circle_reboot;
 extern int no_specials;
@@ -37,6 +37,9 @@
 /* Define if the system is capable of using crypt() to encrypt.  */
 #define CIRCLE_CRYPT 1
 
+/* Define to wait on sockets with select() even if epoll is available.  */
+/* #undef CIRCLE_USE_SELECT */
+
 /* Define if we don't have proper support for the system's crypt().  */
 /* #undef HAVE_UNSAFE_CRYPT */
 
@@ -127,6 +130,9 @@
 /* Define if you have the <netinet/in.h> header file.  */
 #define HAVE_NETINET_IN_H 1
 
+/* Define if you have the <pthread.h> header file.  */
+#define HAVE_PTHREAD_H 1
+
 /* Define if you have the <signal.h> header file.  */
 #define HAVE_SIGNAL_H 1
 
@@ -136,6 +142,9 @@
 /* Define if you have the <strings.h> header file.  */
 #define HAVE_STRINGS_H 1
 
+/* Define if you have the <sys/epoll.h> header file.  */
+#define HAVE_SYS_EPOLL_H 1
+
 /* Define if you have the <sys/fcntl.h> header file.  */
 #define HAVE_SYS_FCNTL_H 1
 
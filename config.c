@@ -196,6 +196,39 @@ int bitwarning = FALSE;
  * world files will be 128bit anyway. */
 int bitsavetodisk = TRUE;
 
+/* If true, every wilderness region/path lookup answered from the in-memory
+ * spatial index is repeated against MySQL and any disagreement is logged.
+ * This brings back the per-tile query load, so only turn it on to validate
+ * the index after changing the region or path data. */
+int verify_wilderness_index = NO;
+
+/* Seconds a zone must be empty of players before it goes dormant, after
+ * which its mobiles, objects and room affections are left alone by the
+ * periodic updates until a player returns.  0 keeps every zone awake. */
+int zone_dormancy_delay = 300;
+
+/* zlib level (1 fastest .. 9 smallest) for MCCP compressed connections.
+ * 6 is zlib's own default, a middle ground between ratio and CPU.  Game
+ * output is short and repetitive, so 1-3 still save most of the bandwidth
+ * for less CPU if 'show compression' shows zlib time adding up. */
+int mccp_compression_level = 6;
+
+/* Bytes of output that may be waiting for a player's client before the game
+ * stops taking that player's commands.  They are taken again once the client
+ * has read half of it, so a slow link or a huge 'who' never loses text. */
+int output_high_water = 32768;
+
+/* Bytes of output that may be waiting for a player at all.  Past this the
+ * rest is thrown away and they are told **OVERFLOW**; only a client that has
+ * stopped reading while things keep happening around it gets this far. */
+int output_hard_cap = 262144;
+
+/* Reading from and writing to players' sockets (and compressing what goes
+ * out) is done by a network thread of its own, so a slow client or a big
+ * burst of output never holds up the game.  Set this to NO to do it all in
+ * the game loop as it used to be. */
+int io_thread = YES;
+
 /* This is the default port on which the game should run if no port is given on
  * the command-line.  NOTE WELL: If you're using the 'autorun' script, the port
  * number there will override this setting. Change the PORT= line in autorun
@@ -85,6 +85,12 @@ extern int ibt_autosave;
 /* Game operation settings. */
 extern int bitwarning;
 extern int bitsavetodisk;
+extern int verify_wilderness_index;
+extern int zone_dormancy_delay;
+extern int mccp_compression_level;
+extern int output_high_water;
+extern int output_hard_cap;
+extern int io_thread;
 extern int auto_pwipe;
 extern struct pclean_criteria_data pclean_criteria[];
 extern int selfdelete_fastwipe;
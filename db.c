@@ -79,6 +79,13 @@ obj_rnum top_of_objt = 0; /* top of object index table	 */
 
 struct zone_data *zone_table = NULL; /* zone table      */
 zone_rnum top_of_zone_table = 0; /* top element of zone tab   */
+struct dormancy_stats_data dormancy_stats[NUM_DORMANCY_PULSES] = {
+  { "mobile_activity" },
+  { "proc_update" },
+  { "affect_update" },
+  { "pulse_luminari" },
+  { "script_trigger_check" }
+};
 
 struct region_data *region_table = NULL; /* Region table */
 region_rnum top_of_region_table = 0; /* top element of region tab */
@@ -598,6 +605,9 @@ void boot_world(void) {
   init_perlin(NOISE_MATERIAL_PLANE_ELEV_DIST, NOISE_MATERIAL_PLANE_ELEV_DIST_SEED);
   init_perlin(NOISE_WEATHER, NOISE_WEATHER_SEED);
 
+  log("Loading wilderness terrain.");
+  load_wilderness_terrain();
+
   log("Indexing wilderness rooms.");
   initialize_wilderness_lists();
 
@@ -660,6 +670,9 @@ void destroy_db(void) {
       }
       free_list(world[cnt].events);
       world[cnt].events = NULL;
+      if (world[cnt].events_by_id)
+        free(world[cnt].events_by_id);
+      world[cnt].events_by_id = NULL;
     }
 
     /* free any assigned scripts */
@@ -779,6 +792,8 @@ void destroy_db(void) {
           j = i->next;
           if (i->cmd)
             free(i->cmd);
+          if (i->subst)
+            free(i->subst);
           free(i);
           i = j;
         }
@@ -3041,6 +3056,7 @@ struct char_data *create_char(void) {
 
 void new_mobile_data(struct char_data *ch) {
   ch->events = NULL;
+  ch->events_by_id = NULL;
   ch->group = NULL;
 
   /* Set up the action queues. */
@@ -3065,6 +3081,7 @@ struct char_data *read_mobile(mob_vnum nr, int type) /* and mob_rnum */ {
   clear_char(mob);
 
   *mob = mob_proto[i];
+  affects_changed(mob);
   mob->next = character_list;
   character_list = mob;
 
@@ -3135,6 +3152,7 @@ struct obj_data *create_obj(void) {
   object_list = obj;
 
   obj->events = NULL;
+  obj->events_by_id = NULL;
   obj->special_abilities = NULL; /* Ornir 19/08/2013 */
 
   GET_ID(obj) = max_obj_id++;
@@ -3163,6 +3181,7 @@ struct obj_data *read_object(obj_vnum nr, int type) /* and obj_rnum */ {
   object_list = obj;
 
   obj->events = NULL;
+  obj->events_by_id = NULL;
 
   obj_index[i].number++;
 
@@ -3257,6 +3276,8 @@ void zone_update(void) {
     }
   } /* end - one minute has passed */
 
+  update_zone_dormancy();
+
   /* Dequeue zones (if possible) and reset. This code is executed every x
    * seconds (i.e. PULSE_ZONE). */
   for (update_u = reset_q.head; update_u; update_u = update_u->next)
@@ -3698,12 +3719,12 @@ void reset_zone(zone_rnum zone) {
         if (ZCMD.arg1 == MOB_TRIGGER && tmob) {
           if (!SCRIPT(tmob))
             CREATE(SCRIPT(tmob), struct script_data, 1);
-          add_trigger(SCRIPT(tmob), read_trigger(ZCMD.arg2), -1);
+          add_trigger(SCRIPT(tmob), read_trigger(ZCMD.arg2), -1, tmob, MOB_TRIGGER);
           push_result(1);
         } else if (ZCMD.arg1 == OBJ_TRIGGER && tobj) {
           if (!SCRIPT(tobj))
             CREATE(SCRIPT(tobj), struct script_data, 1);
-          add_trigger(SCRIPT(tobj), read_trigger(ZCMD.arg2), -1);
+          add_trigger(SCRIPT(tobj), read_trigger(ZCMD.arg2), -1, tobj, OBJ_TRIGGER);
           push_result(1);
         } else if (ZCMD.arg1 == WLD_TRIGGER) {
           if (ZCMD.arg3 == NOWHERE || ZCMD.arg3 > top_of_world) {
@@ -3712,7 +3733,7 @@ void reset_zone(zone_rnum zone) {
           }
           if (!world[ZCMD.arg3].script)
             CREATE(world[ZCMD.arg3].script, struct script_data, 1);
-          add_trigger(world[ZCMD.arg3].script, read_trigger(ZCMD.arg2), -1);
+          add_trigger(world[ZCMD.arg3].script, read_trigger(ZCMD.arg2), -1, &world[ZCMD.arg3], WLD_TRIGGER);
           push_result(1);
         }
 
@@ -3770,19 +3791,18 @@ void reset_zone(zone_rnum zone) {
 }
 
 /* for use in reset_zone; return TRUE if zone 'nr' is free of PC's  */
+/* Each zone keeps a list of the characters in it that could be players:
+ * every PC, and any mobile a player has switched into.  is_empty() only has
+ * to look at that list, which is empty for nearly every zone. */
 int is_empty(zone_rnum zone_nr) {
-  struct descriptor_data *i;
+  struct char_data *ch;
 
-  for (i = descriptor_list; i; i = i->next) {
-    if (STATE(i) != CON_PLAYING)
-      continue;
-    if (IN_ROOM(i->character) == NOWHERE)
-      continue;
-    if (world[IN_ROOM(i->character)].zone != zone_nr)
+  for (ch = zone_table[zone_nr].players; ch; ch = ch->next_in_zone) {
+    if (!ch->desc || STATE(ch->desc) != CON_PLAYING)
       continue;
     /* If an immortal has nohassle off, he counts as present. Added for testing
      * zone reset triggers -Welcor */
-    if ((!IS_NPC(i->character)) && (GET_LEVEL(i->character) >= LVL_IMMORT) && (PRF_FLAGGED(i->character, PRF_NOHASSLE)))
+    if ((!IS_NPC(ch)) && (GET_LEVEL(ch) >= LVL_IMMORT) && (PRF_FLAGGED(ch, PRF_NOHASSLE)))
       continue;
 
     return (0);
@@ -3791,6 +3811,82 @@ int is_empty(zone_rnum zone_nr) {
   return (1);
 }
 
+#define ZONE_LISTED(ch) (!IS_NPC(ch) || (ch)->desc != NULL)
+
+/* Called by char_to_room() once ch is in room.  A zone that was dormant
+ * (see ZONE_DORMANT in db.h) wakes up as soon as a player arrives. */
+void zone_add_occupant(struct char_data *ch, room_rnum room) {
+  struct zone_data *zone;
+
+  if (ch->in_zone_list || !ZONE_LISTED(ch))
+    return;
+
+  zone = &zone_table[world[room].zone];
+  ch->next_in_zone = zone->players;
+  zone->players = ch;
+  ch->in_zone_list = TRUE;
+  zone->num_players++;
+
+  zone->dormant = FALSE;
+}
+
+/* Called by char_from_room() while ch is still in room. */
+void zone_remove_occupant(struct char_data *ch, room_rnum room) {
+  struct zone_data *zone;
+  struct char_data *temp;
+
+  if (!ch->in_zone_list)
+    return;
+
+  zone = &zone_table[world[room].zone];
+  REMOVE_FROM_LIST(ch, zone->players, next_in_zone);
+  ch->next_in_zone = NULL;
+  ch->in_zone_list = FALSE;
+
+  if (--zone->num_players <= 0) {
+    zone->num_players = 0;
+    zone->empty_since = pulse;
+  }
+}
+
+/* A mobile is on its zone's list only while someone is switched into it,
+ * so this is called whenever a mobile gains or loses its descriptor. */
+void zone_occupant_changed(struct char_data *ch) {
+  if (IN_ROOM(ch) == NOWHERE)
+    return;
+
+  if (ch->in_zone_list && !ZONE_LISTED(ch))
+    zone_remove_occupant(ch, IN_ROOM(ch));
+  else if (!ch->in_zone_list && ZONE_LISTED(ch))
+    zone_add_occupant(ch, IN_ROOM(ch));
+}
+
+/* Called every PULSE_ZONE, puts to sleep the zones that have been empty for
+ * zone_dormancy_delay seconds, or wakes them all if dormancy is turned off. */
+void update_zone_dormancy(void) {
+  zone_rnum i;
+
+  for (i = 0; i <= top_of_zone_table; i++) {
+    if (zone_dormancy_delay <= 0) {
+      zone_table[i].dormant = FALSE;
+      continue;
+    }
+
+    if (zone_table[i].dormant || zone_table[i].num_players > 0)
+      continue;
+
+    if (pulse - zone_table[i].empty_since >= (unsigned long) zone_dormancy_delay RL_SEC)
+      zone_table[i].dormant = TRUE;
+  }
+}
+
+/* The pulses that skip dormant zones count what they did in dormancy_stats[],
+ * for the 'show dormancy' command; this starts a new run. */
+void dormancy_pulse_start(int which) {
+  dormancy_stats[which].processed = 0;
+  dormancy_stats[which].skipped = 0;
+}
+
 /* Functions of a general utility nature. */
 
 /* read and allocate space for a '~'-terminated string from a given file */
@@ -4142,6 +4238,10 @@ void free_char(struct char_data *ch) {
   int i = 0;
   struct alias_data *a = NULL;
 
+  /* Don't leave it on its zone's player list, see is_empty(). */
+  if (ch->in_zone_list && IN_ROOM(ch) != NOWHERE)
+    zone_remove_occupant(ch, IN_ROOM(ch));
+
   if (ch->player_specials != NULL && ch->player_specials != &dummy_mob) {
     while ((a = GET_ALIASES(ch)) != NULL) {
       GET_ALIASES(ch) = (GET_ALIASES(ch))->next;
@@ -4243,6 +4343,8 @@ void free_char(struct char_data *ch) {
     }
     if (ch->events)
       free_list(ch->events);
+    if (ch->events_by_id)
+      free(ch->events_by_id);
   }
 
   /* DR */
@@ -4390,6 +4492,7 @@ void reset_char(struct char_data *ch) {
 
   for (i = 0; i < NUM_WEARS; i++)
     GET_EQ(ch, i) = NULL;
+  gear_feats_changed(ch);
 
   ch->followers = NULL;
   ch->master = NULL;
@@ -4446,6 +4549,7 @@ void clear_char(struct char_data *ch) {
   GET_POS(ch) = POS_STANDING;
   ch->mob_specials.default_pos = POS_STANDING;
   ch->events = NULL;
+  ch->events_by_id = NULL;
 
   /* worried about mobiles having junk-data for wards */
   for (i = 0; i < MAX_WARDING; i++)
@@ -109,6 +109,7 @@
 #define SOCMESS_FILE	LIB_MISC"socials"  /* messages for social acts	*/
 #define SOCMESS_FILE_NEW LIB_MISC"socials.new"  /* messages for social acts with aedit patch*/
 #define XNAME_FILE	LIB_MISC"xnames"   /* invalid name substrings	*/
+#define WILD_TERRAIN_FILE LIB_MISC"wilderness.terrain" /* precomputed wilderness terrain */
 
 /* BEGIN: Assumed default locations for logfiles, mainly used in do_file. */
 /**/
@@ -201,12 +202,47 @@ struct zone_data {
 
    int show_weather;
 
+   /* Occupancy, kept by char_to_room() and char_from_room(). */
+   struct char_data *players;  /* PCs (and switched mobs) in zone    */
+   int num_players;            /* length of the players list         */
+   unsigned long empty_since;  /* pulse the last player left         */
+   bool dormant;               /* no players for zone_dormancy_delay */
+
    /* Reset mode:
     *   0: Don't reset, and don't update age.
     *   1: Reset if no PC's are located in zone.
     *   2: Just reset. */
 };
 
+/* A dormant zone has had no players in it for zone_dormancy_delay seconds.
+ * Its mobiles, objects and room affections are skipped by the periodic
+ * pulses until a player walks back in; affect durations that were skipped
+ * are caught up the next time the affect pulse reaches them. */
+#define ZONE_DORMANT(rnum)  (zone_table[(rnum)].dormant)
+#define ROOM_DORMANT(rnum)  ((rnum) != NOWHERE && (rnum) <= top_of_world && \
+                             ZONE_DORMANT(world[(rnum)].zone))
+
+/* The pulses that skip dormant zones, for dormancy_stats[]. */
+#define DORMANCY_MOBILE     0   /* mobile_activity()      */
+#define DORMANCY_OBJPROC    1   /* proc_update()          */
+#define DORMANCY_AFFECT     2   /* affect_update()        */
+#define DORMANCY_LUMINARI   3   /* pulse_luminari()       */
+#define DORMANCY_SCRIPT     4   /* script_trigger_check() */
+#define NUM_DORMANCY_PULSES 5
+
+struct dormancy_stats_data {
+   const char *name;
+   long processed;             /* entities handled on the last run   */
+   long skipped;               /* entities skipped on the last run   */
+   long long total_processed;
+   long long total_skipped;
+};
+
+#define DORMANCY_PROCESSED(which) (dormancy_stats[(which)].processed++, \
+                                   dormancy_stats[(which)].total_processed++)
+#define DORMANCY_SKIPPED(which)   (dormancy_stats[(which)].skipped++, \
+                                   dormancy_stats[(which)].total_skipped++)
+
 /* for queueing zones for update   */
 struct reset_q_element {
    zone_rnum zone_to_reset;            /* ref to zone_data */
@@ -329,6 +365,11 @@ void parse_room(FILE *fl, int virtual_nr);
 void parse_mobile(FILE *mob_f, int nr);
 char *parse_object(FILE *obj_f, int nr);
 int is_empty(zone_rnum zone_nr);
+void zone_add_occupant(struct char_data *ch, room_rnum room);
+void zone_remove_occupant(struct char_data *ch, room_rnum room);
+void zone_occupant_changed(struct char_data *ch);
+void update_zone_dormancy(void);
+void dormancy_pulse_start(int which);
 void reset_zone(zone_rnum zone);
 void reboot_wizlists(void);
 ACMD(do_reboot);
@@ -388,6 +429,7 @@ extern room_rnum top_of_world;
 
 extern struct zone_data *zone_table;
 extern zone_rnum top_of_zone_table;
+extern struct dormancy_stats_data dormancy_stats[NUM_DORMANCY_PULSES];
 
 extern struct region_data *region_table;
 extern region_rnum top_of_region_table;
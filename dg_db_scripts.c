@@ -71,6 +71,8 @@ void parse_trigger(FILE *trig_f, int nr)
 
     free(cmds);
 
+    compile_cmdlist(trig->cmdlist, nr);
+
     trig_index[top_of_trigt++] = t_index;
 }
 
@@ -105,7 +107,7 @@ static void trig_data_init(trig_data *this_data)
     this_data->depth = 0;
     this_data->wait_event = NULL;
     this_data->purged = FALSE;
-    this_data->var_list = NULL;
+    memset(&this_data->var_list, 0, sizeof (this_data->var_list));
 
     this_data->next = NULL;
 }
@@ -202,7 +204,7 @@ void dg_read_trigger(FILE *fp, void *proto, int type)
       if (rnum != NOTHING) {
         if (!(room->script))
           CREATE(room->script, struct script_data, 1);
-        add_trigger(SCRIPT(room), read_trigger(rnum), -1);
+        add_trigger(SCRIPT(room), read_trigger(rnum), -1, room, WLD_TRIGGER);
       } else {
         mudlog(BRF, LVL_BUILDER, TRUE,
                "SYSERR: non-existant trigger #%d assigned to room #%d",
@@ -272,7 +274,7 @@ void assign_triggers(void *i, int type)
         } else {
           if (!SCRIPT(mob))
             CREATE(SCRIPT(mob), struct script_data, 1);
-          add_trigger(SCRIPT(mob), read_trigger(rnum), -1);
+          add_trigger(SCRIPT(mob), read_trigger(rnum), -1, mob, MOB_TRIGGER);
         }
         trg_proto = trg_proto->next;
       }
@@ -288,7 +290,7 @@ void assign_triggers(void *i, int type)
         } else {
           if (!SCRIPT(obj))
             CREATE(SCRIPT(obj), struct script_data, 1);
-          add_trigger(SCRIPT(obj), read_trigger(rnum), -1);
+          add_trigger(SCRIPT(obj), read_trigger(rnum), -1, obj, OBJ_TRIGGER);
         }
         trg_proto = trg_proto->next;
       }
@@ -305,7 +307,7 @@ void assign_triggers(void *i, int type)
         } else {
           if (!SCRIPT(room))
             CREATE(SCRIPT(room), struct script_data, 1);
-          add_trigger(SCRIPT(room), read_trigger(rnum), -1);
+          add_trigger(SCRIPT(room), read_trigger(rnum), -1, room, WLD_TRIGGER);
         }
         trg_proto = trg_proto->next;
       }
@@ -175,6 +175,138 @@ int event_is_queued(struct event *event)
 /***************************************************************************
  * Begin generic (abstract) priority queue functions
  **************************************************************************/
+/* Elements with the same key come out newest first, as they always have.
+ * Each list keeps its newest element at the head; new elements are pushed
+ * there, and elements cascading down from a coarser level (which are always
+ * older than anything already placed below) are appended at the tail. */
+
+/** Takes a q_element from q's pool, allocating another block if needed. */
+static struct q_element *queue_new_element(struct dg_queue *q)
+{
+  struct q_element *block = NULL, *qe = NULL;
+  int i = 0;
+
+  if (!q->pool) {
+    CREATE(block, struct q_element, EVENT_POOL_BLOCK);
+
+    /* The first element of each block only chains the blocks together. */
+    block[0].next = q->blocks;
+    q->blocks = block;
+
+    for (i = EVENT_POOL_BLOCK - 1; i > 0; i--) {
+      block[i].next = q->pool;
+      q->pool = &block[i];
+    }
+  }
+
+  qe = q->pool;
+  q->pool = qe->next;
+  qe->prev = qe->next = NULL;
+
+  return qe;
+}
+
+/** Links qe into the list for its key, at the head or (when cascading) the
+ * tail. */
+static void queue_place(struct dg_queue *q, struct q_element *qe, bool append)
+{
+  struct q_list *list = NULL;
+  long when = (qe->key > q->now ? qe->key : q->now); /* Overdue elements go out next. */
+  long delta = when - q->now;
+  int level = 0, shift = EVENT_WHEEL_BITS0;
+
+  if (delta < EVENT_WHEEL_SLOTS0)
+    list = &q->wheel0[when & (EVENT_WHEEL_SLOTS0 - 1)];
+  else {
+    for (level = 0; level < EVENT_WHEEL_LEVELS; level++, shift += EVENT_WHEEL_BITS) {
+      if (delta < (1L << (shift + EVENT_WHEEL_BITS))) {
+        list = &q->wheel[level][(when >> shift) & (EVENT_WHEEL_SLOTS - 1)];
+        break;
+      }
+    }
+    if (!list)
+      list = &q->far;
+  }
+
+  qe->list = list;
+
+  if (!list->head) {
+    qe->prev = qe->next = NULL;
+    list->head = list->tail = qe;
+  } else if (append) {
+    qe->prev = list->tail;
+    qe->next = NULL;
+    list->tail->next = qe;
+    list->tail = qe;
+  } else {
+    qe->prev = NULL;
+    qe->next = list->head;
+    list->head->prev = qe;
+    list->head = qe;
+  }
+}
+
+/** Re-places everything on list, which belongs to a coarser level, now that
+ * q->now has reached it. */
+static void queue_cascade(struct dg_queue *q, struct q_list *list)
+{
+  struct q_element *qe = list->head, *next_qe = NULL;
+
+  list->head = list->tail = NULL;
+
+  for (; qe; qe = next_qe) {
+    next_qe = qe->next;
+    queue_place(q, qe, TRUE);
+  }
+}
+
+/** Moves q->now on by one pulse, cascading the coarser levels each time a
+ * level below them wraps around. */
+static void queue_advance(struct dg_queue *q)
+{
+  int level = 0, shift = EVENT_WHEEL_BITS0, slot = 0;
+
+  q->now++;
+
+  if (q->now & (EVENT_WHEEL_SLOTS0 - 1))
+    return;
+
+  for (level = 0; level < EVENT_WHEEL_LEVELS; level++, shift += EVENT_WHEEL_BITS) {
+    slot = (q->now >> shift) & (EVENT_WHEEL_SLOTS - 1);
+    queue_cascade(q, &q->wheel[level][slot]);
+    if (slot)
+      return;
+  }
+
+  queue_cascade(q, &q->far);
+}
+
+/** Finds the first element due at or before the current pulse.
+ * @pre pulse must be defined.
+ * @retval q_element * The element, or NULL if nothing is due yet. */
+static struct q_element *queue_first_due(struct dg_queue *q)
+{
+  struct q_list *slot = NULL;
+
+  for (;;) {
+    slot = &q->wheel0[q->now & (EVENT_WHEEL_SLOTS0 - 1)];
+
+    if (slot->head)
+      return slot->head;
+
+    if (q->now >= (long) pulse)
+      return NULL;
+
+    /* Nothing queued at all, no need to step through the empty slots. */
+    if (!q->count) {
+      q->now = pulse;
+      return NULL;
+    }
+
+    queue_advance(q);
+  }
+}
+
 /** Create a new, empty, priority queue and return it.
  * @retval dg_queue * Pointer to the newly created queue structure. */
 struct dg_queue *queue_init(void)
@@ -182,13 +314,14 @@ struct dg_queue *queue_init(void)
   struct dg_queue *q = NULL;
 
   CREATE(q, struct dg_queue, 1);
+  q->now = pulse;
 
   return q;
 }
 
 /** Add some 'data' to a priority queue. 
  * @pre The paremeter q must have been previously created by queue_init.
- * @post A new q_element is created to hold the data parameter.
+ * @post A q_element from q's pool is used to hold the data parameter.
  * @param q The existing dg_queue to add an element to. 
  * @param data The data to be associated with, and theoretically used, when
  * the element comes up in q. data is wrapped in a new q_element.
@@ -198,77 +331,48 @@ struct dg_queue *queue_init(void)
  * the data. */
 struct q_element *queue_enq(struct dg_queue *q, void *data, long key)
 {
-  struct q_element *qe = NULL, *i = NULL;
-  int bucket = 0;
+  struct q_element *qe = queue_new_element(q);
 
-  CREATE(qe, struct q_element, 1);
   qe->data = data;
   qe->key = key;
 
-  bucket = key % NUM_EVENT_QUEUES;   /* which queue does this go in */
-
-  if (!q->head[bucket]) { /* queue is empty */
-    q->head[bucket] = qe;
-    q->tail[bucket] = qe;
-  }
-
-  else {
-    for (i = q->tail[bucket]; i; i = i->prev) {
-
-      if (i->key < key) { /* found insertion point */
-	if (i == q->tail[bucket])
-	  q->tail[bucket] = qe;
-	else {
-	  qe->next = i->next;
-	  i->next->prev = qe;
-	}
-
-	qe->prev = i;
-	i->next = qe;
-	break;
-      }
-    }
-
-    if (i == NULL) { /* insertion point is front of list */
-      qe->next = q->head[bucket];
-      q->head[bucket] = qe;
-      qe->next->prev = qe;
-    }
-  }
+  queue_place(q, qe, FALSE);
+  q->count++;
 
   return qe;
 }
 
 /** Remove queue element qe from the priority queue q.
  * @pre qe->data has been dealt with in some way.
- * @post qe has been freed. 
+ * @post qe has been returned to q's pool.
  * @param q Pointer to the queue containing qe.
  * @param qe Pointer to the q_element to remove from q.
  */
 void queue_deq(struct dg_queue *q, struct q_element *qe)
 {
-  int i = 0;
-
   assert(qe);
 
-  i = qe->key % NUM_EVENT_QUEUES;
-
   if (qe->prev == NULL)
-    q->head[i] = qe->next;
+    qe->list->head = qe->next;
   else
     qe->prev->next = qe->next;
 
   if (qe->next == NULL)
-    q->tail[i] = qe->prev;
+    qe->list->tail = qe->prev;
   else
     qe->next->prev = qe->prev;
 
-  free(qe);
+  qe->data = NULL;
+  qe->list = NULL;
+  qe->prev = NULL;
+  qe->next = q->pool;
+  q->pool = qe;
+  q->count--;
 }
 
 /** Removes and returns the data of the first element of the priority queue q. 
- * @pre pulse must be defined. This is a multi-headed queue, the current
- * head is determined by the current pulse.
+ * @pre pulse must be defined. Only elements due at or before the current
+ * pulse are returned.
  * @post the q->head is dequeued. 
  * @param q The queue to return the head of. 
  * @retval void * NULL if there is not a currently available head, pointer
@@ -276,32 +380,28 @@ void queue_deq(struct dg_queue *q, struct q_element *qe)
 void *queue_head(struct dg_queue *q)
 {
   void *dg_data = NULL;
-  int i = 0;
-
-  i = pulse % NUM_EVENT_QUEUES;
+  struct q_element *qe = NULL;
 
-  if (!q->head[i])
+  if (!(qe = queue_first_due(q)))
     return NULL;
 
-  dg_data = q->head[i]->data;
-  queue_deq(q, q->head[i]);
+  dg_data = qe->data;
+  queue_deq(q, qe);
   return dg_data;
 }
 
 /** Returns the key of the head element of the priority queue.
- * @pre pulse must be defined. This is a multi-headed queue, the current
- * head is determined by the current pulse. 
+ * @pre pulse must be defined. Only elements due at or before the current
+ * pulse are considered.
  * @param q Queue to check for.
  * @retval long Return the key element of the head q_element. If no head
  * q_element is available, return LONG_MAX. */
 long queue_key(struct dg_queue *q)
 {
-  int i = 0;
-
-  i = pulse % NUM_EVENT_QUEUES;
+  struct q_element *qe = NULL;
 
-  if (q->head[i])
-    return q->head[i]->key;
+  if ((qe = queue_first_due(q)) != NULL)
+    return qe->key;
   else
     return LONG_MAX;
 }
@@ -314,6 +414,24 @@ long queue_elmt_key(struct q_element *qe)
   return qe->key;
 }
 
+/** Frees the events on one list of q. */
+static void queue_free_list(struct q_list *list)
+{
+  struct q_element *qe = NULL;
+  struct event *event = NULL;
+
+  for (qe = list->head; qe; qe = qe->next)
+  {
+    if ((event = (struct event *) qe->data) != NULL) 
+    {
+      if (event->event_obj)
+        cleanup_event_obj(event);
+
+      free(event);
+    }
+  }
+}
+
 /** Free q and all contents.
  * @pre Function requires definition of struct event.
  * @post All items associeated qith q, including non-abstract data, are freed.
@@ -321,26 +439,22 @@ long queue_elmt_key(struct q_element *qe)
  */
 void queue_free(struct dg_queue *q)
 {
-  int i = 0;
-  struct q_element *qe = NULL, *next_qe = NULL;
-  struct event *event = NULL;
+  int i = 0, j = 0;
+  struct q_element *block = NULL, *next_block = NULL;
 
-  for (i = 0; i < NUM_EVENT_QUEUES; i++)
-  {
-    for (qe = q->head[i]; qe; qe = next_qe) 
-    {
-      next_qe = qe->next;
-      if ((event = (struct event *) qe->data) != NULL) 
-      {
-        if (event->event_obj)
-          cleanup_event_obj(event);
+  for (i = 0; i < EVENT_WHEEL_SLOTS0; i++)
+    queue_free_list(&q->wheel0[i]);
 
-        free(event);
-      }
-      free(qe);
-    }
+  for (i = 0; i < EVENT_WHEEL_LEVELS; i++)
+    for (j = 0; j < EVENT_WHEEL_SLOTS; j++)
+      queue_free_list(&q->wheel[i][j]);
+
+  queue_free_list(&q->far);
+
+  for (block = q->blocks; block; block = next_block) {
+    next_block = block[0].next;
+    free(block);
   }
 
   free(q);
 }
-
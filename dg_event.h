@@ -42,13 +42,36 @@ struct event {
 /**************************************************************************
  * Begin priority queue structures and defines.
  **************************************************************************/
-/** Number of buckets available in each queue. Reduces enqueue cost. */
-#define NUM_EVENT_QUEUES    10
+/** The queue is a hierarchical timing wheel.  Level 0 has one slot per pulse
+ * for the next EVENT_WHEEL_SLOTS0 pulses; each higher level has
+ * EVENT_WHEEL_SLOTS slots, each covering a whole turn of the level below.
+ * Elements are moved (cascaded) down a level as their time comes closer.
+ * Anything further out than the top level waits on a separate list. */
+#define EVENT_WHEEL_BITS0   8
+#define EVENT_WHEEL_SLOTS0  (1 << EVENT_WHEEL_BITS0)
+#define EVENT_WHEEL_BITS    6
+#define EVENT_WHEEL_SLOTS   (1 << EVENT_WHEEL_BITS)
+/** Number of levels above level 0. */
+#define EVENT_WHEEL_LEVELS  3
+
+/** q_elements are handed out from blocks of this many. */
+#define EVENT_POOL_BLOCK    256
+
+/** One list of queued elements, newest first. */
+struct q_list {
+  struct q_element *head; /**< Newest element. */
+  struct q_element *tail; /**< Oldest element. */
+};
 
 /** The priority queue. */
 struct dg_queue {
-  struct q_element *head[NUM_EVENT_QUEUES]; /**< Front of each queue bucket. */
-  struct q_element *tail[NUM_EVENT_QUEUES]; /**< Rear of each queue bucket. */
+  struct q_list wheel0[EVENT_WHEEL_SLOTS0];  /**< One slot per pulse. */
+  struct q_list wheel[EVENT_WHEEL_LEVELS][EVENT_WHEEL_SLOTS]; /**< Coarser levels. */
+  struct q_list far;         /**< Elements beyond the top level. */
+  long now;                  /**< Key of the level 0 slot being handed out. */
+  long count;                /**< Number of queued elements. */
+  struct q_element *pool;    /**< Unused q_elements. */
+  struct q_element *blocks;  /**< Allocated blocks, chained through [0].next */
 };
 
 /** Queued elements. */
@@ -56,6 +79,7 @@ struct q_element {
   void *data;  /**< The event to be handled. */
   long key;    /**< When the event should be handled. */
   struct q_element *prev, *next; /**< Points to other q_elements in line. */
+  struct q_list *list;           /**< The list this element is on. */
 };
 /**************************************************************************
  * End priority queue structures and defines.
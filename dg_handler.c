@@ -28,45 +28,41 @@
 void free_var_el(struct trig_var_data *var)
 {
   if (var->name)
-    free(var->name);
+    release_var_name(var->name);
   if (var->value)
     free(var->value);
   free(var);
 }
 
-/* release memory allocated for a variable list */
-void free_varlist(struct trig_var_data *vd)
+/* release memory allocated for a variable table, leaving it empty */
+void free_varlist(struct trig_var_table *vars)
 {
     struct trig_var_data *i, *j;
 
-    for (i = vd; i;) {
+    for (i = vars->list; i;) {
 	j = i;
 	i = i->next;
 	free_var_el(j);
     }
+
+    if (vars->buckets)
+      free(vars->buckets);
+    vars->list = NULL;
+    vars->buckets = NULL;
+    vars->num_buckets = 0;
+    vars->num_vars = 0;
 }
 
-/* Remove var name from var_list. Returns 1 if found, else 0. */
-int remove_var(struct trig_var_data **var_list, char *name)
+/* Remove var name from vars. Returns 1 if found, else 0. */
+int remove_var(struct trig_var_table *vars, char *name)
 {
-  struct trig_var_data *i, *j;
-
-  for (j = NULL, i = *var_list; i && str_cmp(name, i->name);
-       j = i, i = i->next);
-
-  if (i) {
-    if (j) {
-      j->next = i->next;
-      free_var_el(i);
-    } else {
-      *var_list = i->next;
-      free_var_el(i);
-    }
+  struct trig_var_data *vd;
 
-    return 1;
-  }
+  if ((vd = find_var(vars, name)) == NULL)
+    return 0;
 
-  return 0;
+  remove_var_el(vars, vd);
+  return 1;
 }
 
 /* Return memory used by a trigger. The command list is free'd when changed and
@@ -80,10 +76,7 @@ void free_trigger(struct trig_data *trig)
       free(trig->arglist);
       trig->arglist = NULL;
     }
-    if (trig->var_list) {
-      free_varlist(trig->var_list);
-      trig->var_list = NULL;
-    }
+    free_varlist(&trig->var_list);
     if (GET_TRIG_WAIT(trig))
       event_cancel(GET_TRIG_WAIT(trig));
 
@@ -153,6 +146,11 @@ void extract_script(void *thing, int type) {
   }
 #endif
   
+  if (!sc)
+    return;
+
+  unlist_random_script(sc);
+
   for (trig = TRIGGERS(sc); trig; trig = next_trig) {
     next_trig = trig->next;
     extract_trigger(trig);
@@ -160,7 +158,7 @@ void extract_script(void *thing, int type) {
   TRIGGERS(sc) = NULL;
 
   /* Thanks to James Long for tracking down this memory leak */
-  free_varlist(sc->global_vars);
+  free_varlist(&sc->global_vars);
 
   free(sc);
 }
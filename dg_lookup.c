@@ -0,0 +1,174 @@
+/**
+* @file dg_lookup.c
+* The uid lookup table behind find_char() and find_obj() in dg_scripts.c.
+*
+* Every character and object in the game is entered here under its uid when
+* it is created and taken out when it is extracted, so scripts can turn the
+* uids they keep in variables back into pointers.  The table is open
+* addressing with linear probing over a power of 2 number of slots; it
+* doubles when it gets too full, and removal shifts the rest of the probe run
+* back instead of leaving tombstones, so lookups never have to step over dead
+* slots no matter how much churn there has been.  Nothing is allocated per
+* entry.
+*
+* Part of the LuminariMUD distribution.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "dg_lookup.h"
+
+/** One slot. A slot with no pointer in it is empty. */
+struct lookup_slot {
+  long uid;
+  void *c;
+};
+
+static struct lookup_slot *lookup_slots = NULL;
+static int lookup_bits = 0;     /* log2 of the number of slots */
+static int lookup_entries = 0;
+
+#define LOOKUP_SIZE     (1 << lookup_bits)
+#define LOOKUP_MASK     (LOOKUP_SIZE - 1)
+
+/** Home slot of a uid.  Uids are handed out in runs (players, then mobs from
+ * MOB_ID_BASE, objects from OBJ_ID_BASE), so they are spread out with a
+ * Fibonacci hash rather than just masked. */
+static int lookup_home(long uid)
+{
+  return (int) (((unsigned int) uid * 2654435769U) >> (32 - lookup_bits));
+}
+
+/** Returns the slot holding uid, or the empty slot ending its probe run. */
+static int lookup_slot_of(long uid)
+{
+  int i = lookup_home(uid);
+
+  while (lookup_slots[i].c && lookup_slots[i].uid != uid)
+    i = (i + 1) & LOOKUP_MASK;
+
+  return i;
+}
+
+static void lookup_resize(int bits)
+{
+  struct lookup_slot *old = lookup_slots;
+  int i, old_size = LOOKUP_SIZE;
+
+  lookup_bits = bits;
+  CREATE(lookup_slots, struct lookup_slot, LOOKUP_SIZE);
+
+  for (i = 0; old && i < old_size; i++)
+    if (old[i].c)
+      lookup_slots[lookup_slot_of(old[i].uid)] = old[i];
+
+  if (old)
+    free(old);
+}
+
+void init_lookup_table(void)
+{
+  if (lookup_slots)
+    free(lookup_slots);
+  lookup_slots = NULL;
+  lookup_entries = 0;
+
+  lookup_resize(LOOKUP_MIN_BITS);
+}
+
+/** Returns whatever was entered under uid, or NULL if nothing was. */
+void *lookup_table_find(long uid)
+{
+  if (!lookup_slots)
+    return NULL;
+
+  return lookup_slots[lookup_slot_of(uid)].c;
+}
+
+void add_to_lookup_table(long uid, void *c)
+{
+  int i;
+
+  if (!c) {
+    log("SYSERR: add_to_lookup_table called with no entity for uid=%ld", uid);
+    return;
+  }
+
+  if (!lookup_slots)
+    init_lookup_table();
+
+  i = lookup_slot_of(uid);
+  if (lookup_slots[i].c) {
+    log("add_to_lookup updating existing value for uid=%ld (%p -> %p)", uid, lookup_slots[i].c, c);
+    lookup_slots[i].c = c;
+    return;
+  }
+
+  /* Grow first, so the run we are about to extend stays short. */
+  if ((lookup_entries + 1) * LOOKUP_LOAD_DEN > LOOKUP_SIZE * LOOKUP_LOAD_NUM) {
+    lookup_resize(lookup_bits + 1);
+    i = lookup_slot_of(uid);
+  }
+
+  lookup_slots[i].uid = uid;
+  lookup_slots[i].c = c;
+  lookup_entries++;
+}
+
+void remove_from_lookup_table(long uid)
+{
+  int i, j, home;
+
+  /* This is not supposed to happen. UID 0 is not used. However, while I'm
+   * debugging the issue, let's just return right away. - Welcor */
+  if (uid == 0)
+    return;
+
+  if (!lookup_slots || !lookup_slots[i = lookup_slot_of(uid)].c) {
+    log("remove_from_lookup. UID %ld not found.", uid);
+    return;
+  }
+
+  /* Close the gap: walk the rest of the run and pull back every entry whose
+   * home is not between the hole and where it sits now, since a lookup for it
+   * would otherwise stop at the hole. */
+  for (j = i;;) {
+    j = (j + 1) & LOOKUP_MASK;
+    if (!lookup_slots[j].c)
+      break;
+
+    home = lookup_home(lookup_slots[j].uid);
+    if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+      continue;
+
+    lookup_slots[i] = lookup_slots[j];
+    i = j;
+  }
+
+  lookup_slots[i].uid = 0;
+  lookup_slots[i].c = NULL;
+  lookup_entries--;
+}
+
+void get_lookup_table_stats(struct lookup_table_stats *st)
+{
+  long total = 0;
+  int i, probe;
+
+  st->entries = lookup_entries;
+  st->slots = lookup_slots ? LOOKUP_SIZE : 0;
+  st->max_probe = 0;
+
+  for (i = 0; i < st->slots; i++) {
+    if (!lookup_slots[i].c)
+      continue;
+    probe = ((i - lookup_home(lookup_slots[i].uid)) & LOOKUP_MASK) + 1;
+    total += probe;
+    if (probe > st->max_probe)
+      st->max_probe = probe;
+  }
+
+  st->avg_probe = lookup_entries ? (double) total / lookup_entries : 0.0;
+}
@@ -0,0 +1,33 @@
+/**
+* @file dg_lookup.h
+* The uid lookup table behind find_char() and find_obj() in dg_scripts.c.
+*
+* Part of the LuminariMUD distribution.
+*/
+#ifndef _DG_LOOKUP_H_
+#define _DG_LOOKUP_H_
+
+/** The table starts with this many slots and doubles from there. Must be a
+ * power of 2. */
+#define LOOKUP_MIN_BITS   10
+/** The table doubles once more than LOOKUP_LOAD_NUM / LOOKUP_LOAD_DEN of its
+ * slots are in use. */
+#define LOOKUP_LOAD_NUM   7
+#define LOOKUP_LOAD_DEN   10
+
+/** Figures for 'show stats'. A probe length is the number of slots looked at
+ * to find an entry, so an entry sitting in its home slot counts as 1. */
+struct lookup_table_stats {
+  int entries;    /**< uids in the table */
+  int slots;      /**< slots allocated */
+  int max_probe;  /**< longest probe of any entry */
+  double avg_probe; /**< mean probe over all entries */
+};
+
+void init_lookup_table(void);
+void add_to_lookup_table(long uid, void *c);
+void remove_from_lookup_table(long uid);
+void *lookup_table_find(long uid);
+void get_lookup_table_stats(struct lookup_table_stats *st);
+
+#endif /* _DG_LOOKUP_H_ */
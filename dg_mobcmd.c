@@ -1000,8 +1000,13 @@ ACMD(do_mtransform) {
     IS_CARRYING_W(&tmpmob) = IS_CARRYING_W(ch);
     IS_CARRYING_N(&tmpmob) = IS_CARRYING_N(ch);
     FIGHTING(&tmpmob) = FIGHTING(ch);
+    GET_INITIATIVE(&tmpmob) = GET_INITIATIVE(ch);
+    GET_ROUND_DUE(&tmpmob) = GET_ROUND_DUE(ch);
+    GET_ROUND_ROOM(&tmpmob) = GET_ROUND_ROOM(ch);
+    GET_ROUND_PHASE(&tmpmob) = GET_ROUND_PHASE(ch);
     HUNTING(&tmpmob) = HUNTING(ch);
     memcpy(ch, &tmpmob, sizeof (*ch));
+    affects_changed(ch);
 
     for (pos = 0; pos < NUM_WEARS; pos++) {
       if (obj[pos])
@@ -410,6 +410,8 @@ void trigedit_save(struct descriptor_data *d) {
       next_cmd = cmd->next;
       if (cmd->cmd)
         free(cmd->cmd);
+      if (cmd->subst)
+        free(cmd->subst);
       free(cmd);
     }
 
@@ -437,6 +439,8 @@ void trigedit_save(struct descriptor_data *d) {
     } else
       trig->cmdlist->cmd = strdup("* No Script");
 
+    compile_cmdlist(trig->cmdlist, OLC_NUM(d));
+
     /* make the prorotype look like what we have */
     trig_data_copy(proto, trig);
 
@@ -463,10 +467,7 @@ void trigedit_save(struct descriptor_data *d) {
           event_cancel(GET_TRIG_WAIT(live_trig));
           GET_TRIG_WAIT(live_trig) = NULL;
         }
-        if (live_trig->var_list) {
-          free_varlist(live_trig->var_list);
-          live_trig->var_list = NULL;
-        }
+        free_varlist(&live_trig->var_list);
 
         live_trig->cmdlist = proto->cmdlist;
         live_trig->curr_state = live_trig->cmdlist;
@@ -502,6 +503,8 @@ void trigedit_save(struct descriptor_data *d) {
     } else
       trig->cmdlist->cmd = strdup("* No Script");
 
+    compile_cmdlist(trig->cmdlist, OLC_NUM(d));
+
     for (i = 0; i < top_of_trigt; i++) {
       if (!found) {
         if (trig_index[i]->vnum > OLC_NUM(d)) {
@@ -612,44 +612,68 @@ obj_data *get_obj_by_room(room_data *room, char *name) {
   return NULL;
 }
 
+/* Scripts with random triggers, by owner type, and how many are on each
+ * list.  A script is put on its list when it gets a random trigger and taken
+ * off when it loses the last one or is extracted. */
+struct script_data *random_scripts[3] = {NULL, NULL, NULL};
+int num_random_scripts[3] = {0, 0, 0};
+
+/* The next script script_trigger_check() will look at.  A trigger can purge
+ * anything, so unlist_random_script() moves this along if it has to. */
+static struct script_data *random_scripts_next = NULL;
+
 /* checks every PULSE_SCRIPT for random triggers */
 void script_trigger_check(void) {
   char_data *ch;
   obj_data *obj;
   struct room_data *room = NULL;
-  int nr;
+  room_rnum nr;
   struct script_data *sc;
 
-  for (ch = character_list; ch; ch = ch->next) {
-    if (SCRIPT(ch)) {
-      sc = SCRIPT(ch);
+  dormancy_pulse_start(DORMANCY_SCRIPT);
 
-      if (IS_SET(SCRIPT_TYPES(sc), WTRIG_RANDOM) &&
-              (!is_empty(world[IN_ROOM(ch)].zone) ||
-              IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
-        random_mtrigger(ch);
+  for (sc = random_scripts[MOB_TRIGGER]; sc; sc = random_scripts_next) {
+    random_scripts_next = sc->next_random;
+    ch = sc->owner.mob;
+
+    if (IN_ROOM(ch) == NOWHERE)
+      continue;
+
+    if (!IS_SET(SCRIPT_TYPES(sc), MTRIG_GLOBAL) &&
+            (ZONE_DORMANT(world[IN_ROOM(ch)].zone) || is_empty(world[IN_ROOM(ch)].zone))) {
+      DORMANCY_SKIPPED(DORMANCY_SCRIPT);
+      continue;
     }
+    DORMANCY_PROCESSED(DORMANCY_SCRIPT);
+    random_mtrigger(ch);
   }
 
-  for (obj = object_list; obj; obj = obj->next) {
-    if (SCRIPT(obj)) {
-      sc = SCRIPT(obj);
+  for (sc = random_scripts[OBJ_TRIGGER]; sc; sc = random_scripts_next) {
+    random_scripts_next = sc->next_random;
+    obj = sc->owner.obj;
 
-      if (IS_SET(SCRIPT_TYPES(sc), OTRIG_RANDOM))
-        random_otrigger(obj);
+    if (!IS_SET(SCRIPT_TYPES(sc), OTRIG_GLOBAL) && ROOM_DORMANT(obj_room(obj))) {
+      DORMANCY_SKIPPED(DORMANCY_SCRIPT);
+      continue;
     }
+    DORMANCY_PROCESSED(DORMANCY_SCRIPT);
+    random_otrigger(obj);
   }
 
-  for (nr = 0; nr <= top_of_world; nr++) {
-    if (SCRIPT(&world[nr])) {
-      room = &world[nr];
-      sc = SCRIPT(room);
+  for (sc = random_scripts[WLD_TRIGGER]; sc; sc = random_scripts_next) {
+    random_scripts_next = sc->next_random;
 
-      if (IS_SET(SCRIPT_TYPES(sc), WTRIG_RANDOM) &&
-              (!is_empty(room->zone) ||
-              IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
-        random_wtrigger(room);
+    if ((nr = real_room(sc->owner.room)) == NOWHERE)
+      continue;
+    room = &world[nr];
+
+    if (!IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL) &&
+            (ZONE_DORMANT(room->zone) || is_empty(room->zone))) {
+      DORMANCY_SKIPPED(DORMANCY_SCRIPT);
+      continue;
     }
+    DORMANCY_PROCESSED(DORMANCY_SCRIPT);
+    random_wtrigger(room);
   }
 }
 
@@ -810,10 +834,10 @@ static void script_stat(char_data *ch, struct script_data *sc) {
   char namebuf[512];
   char buf1[MAX_STRING_LENGTH];
 
-  send_to_char(ch, "\tCScript-Stat Global Variables:\tn %s\r\n", sc->global_vars ? "" : "None");
+  send_to_char(ch, "\tCScript-Stat Global Variables:\tn %s\r\n", sc->global_vars.list ? "" : "None");
   send_to_char(ch, "\tCScript-Stat Global context:\tn %ld\r\n", sc->context);
 
-  for (tv = sc->global_vars; tv; tv = tv->next) {
+  for (tv = sc->global_vars.list; tv; tv = tv->next) {
     snprintf(namebuf, sizeof (namebuf), "%s:%ld", tv->name, tv->context);
     if (*(tv->value) == UID_CHAR) {
       find_uid_name(tv->value, name, sizeof (name));
@@ -846,9 +870,9 @@ static void script_stat(char_data *ch, struct script_data *sc) {
       send_to_char(ch, "    \tCWait:\tn %ld\tC, Current line: \tn%s\r\n",
               event_time(GET_TRIG_WAIT(t)),
               t->curr_state ? t->curr_state->cmd : "End of Script");
-      send_to_char(ch, "  \tCVariables: \tn%s\r\n", GET_TRIG_VARS(t) ? "" : "None");
+      send_to_char(ch, "  \tCVariables: \tn%s\r\n", GET_TRIG_VARS(t).list ? "" : "None");
 
-      for (tv = GET_TRIG_VARS(t); tv; tv = tv->next) {
+      for (tv = GET_TRIG_VARS(t).list; tv; tv = tv->next) {
         if (*(tv->value) == UID_CHAR) {
           find_uid_name(tv->value, name, sizeof (name));
           send_to_char(ch, "    %15s:  %s\r\n", tv->name, name);
@@ -889,9 +913,58 @@ void do_sstat_character(char_data *ch, char_data *k) {
   script_stat(ch, SCRIPT(k));
 }
 
+static void list_random_script(struct script_data *sc, void *go, int type) {
+  if (sc->random_listed)
+    return;
+
+  sc->owner_type = type;
+  switch (type) {
+    case MOB_TRIGGER:
+      sc->owner.mob = (char_data *) go;
+      break;
+    case OBJ_TRIGGER:
+      sc->owner.obj = (obj_data *) go;
+      break;
+    case WLD_TRIGGER:
+      sc->owner.room = ((room_data *) go)->number;
+      break;
+    default:
+      log("SYSERR: list_random_script: unknown owner type %d", type);
+      return;
+  }
+
+  sc->prev_random = NULL;
+  sc->next_random = random_scripts[type];
+  if (random_scripts[type])
+    random_scripts[type]->prev_random = sc;
+  random_scripts[type] = sc;
+  num_random_scripts[type]++;
+  sc->random_listed = TRUE;
+}
+
+void unlist_random_script(struct script_data *sc) {
+  if (!sc->random_listed)
+    return;
+
+  if (sc == random_scripts_next)
+    random_scripts_next = sc->next_random;
+
+  if (sc->prev_random)
+    sc->prev_random->next_random = sc->next_random;
+  else
+    random_scripts[sc->owner_type] = sc->next_random;
+  if (sc->next_random)
+    sc->next_random->prev_random = sc->prev_random;
+
+  sc->next_random = sc->prev_random = NULL;
+  num_random_scripts[sc->owner_type]--;
+  sc->random_listed = FALSE;
+}
+
 /* Adds the trigger t to script sc in in location loc.  loc = -1 means add to
- * the end, loc = 0 means add before all other triggers. */
-void add_trigger(struct script_data *sc, trig_data *t, int loc) {
+ * the end, loc = 0 means add before all other triggers.  go is the mob, obj
+ * or room (according to type) the script belongs to. */
+void add_trigger(struct script_data *sc, trig_data *t, int loc, void *go, int type) {
   trig_data *i;
   int n;
 
@@ -909,6 +982,10 @@ void add_trigger(struct script_data *sc, trig_data *t, int loc) {
 
   SCRIPT_TYPES(sc) |= GET_TRIG_TYPE(t);
 
+  /* MTRIG_RANDOM, OTRIG_RANDOM and WTRIG_RANDOM are the same bit */
+  if (IS_SET(GET_TRIG_TYPE(t), MTRIG_RANDOM))
+    list_random_script(sc, go, type);
+
   t->next_in_world = trigger_list;
   trigger_list = t;
 }
@@ -964,7 +1041,7 @@ ACMD(do_attach) {
 
     if (!SCRIPT(victim))
       CREATE(SCRIPT(victim), struct script_data, 1);
-    add_trigger(SCRIPT(victim), trig, loc);
+    add_trigger(SCRIPT(victim), trig, loc, victim, MOB_TRIGGER);
 
     if (IS_NPC(victim))
       send_to_char(ch, "Trigger %d (%s) attached to %s [%d].\r\n",
@@ -1004,7 +1081,7 @@ ACMD(do_attach) {
 
     if (!SCRIPT(object))
       CREATE(SCRIPT(object), struct script_data, 1);
-    add_trigger(SCRIPT(object), trig, loc);
+    add_trigger(SCRIPT(object), trig, loc, object, OBJ_TRIGGER);
 
     send_to_char(ch, "Trigger %d (%s) attached to %s [%d].\r\n",
             tn, GET_TRIG_NAME(trig),
@@ -1039,7 +1116,7 @@ ACMD(do_attach) {
 
     if (!SCRIPT(room))
       CREATE(SCRIPT(room), struct script_data, 1);
-    add_trigger(SCRIPT(room), trig, loc);
+    add_trigger(SCRIPT(room), trig, loc, room, WLD_TRIGGER);
 
     send_to_char(ch, "Trigger %d (%s) attached to room %d.\r\n",
             tn, GET_TRIG_NAME(trig), world[rnum].number);
@@ -1100,6 +1177,9 @@ static int remove_trigger(struct script_data *sc, char *name) {
     for (i = TRIGGERS(sc); i; i = i->next)
       SCRIPT_TYPES(sc) |= GET_TRIG_TYPE(i);
 
+    if (!IS_SET(SCRIPT_TYPES(sc), MTRIG_RANDOM))
+      unlist_random_script(sc);
+
     return 1;
   } else
     return 0;
@@ -1508,75 +1588,31 @@ static int process_if(char *cond, void *go, struct script_data *sc,
     return 1;
 }
 
-/* Scans for end of if-block.  returns the line containg 'end', or the last
- * line of the trigger if not found. */
+/* Returns the line containing the 'end' of the if-block at cl, or the last
+ * line of the trigger if there is none.  compile_cmdlist() has found it. */
 static struct cmdlist_element *find_end(trig_data *trig, struct cmdlist_element *cl) {
-  struct cmdlist_element *c;
-  char *p;
-
-  if (!(cl->next)) { /* rryan: if this is the last line, theres no end */
-    script_log("Trigger VNum %d has 'if' without 'end'. (error 1)", GET_TRIG_VNUM(trig));
-    return cl;
-  }
-
-  for (c = cl->next; c; c = c->next) {
-    for (p = c->cmd; *p && isspace(*p); p++);
-
-    if (!strn_cmp("if ", p, 3))
-      c = find_end(trig, c);
-    else if (!strn_cmp("end", p, 3))
-      return c;
-
-    /* thanks to Russell Ryan for this fix */
-    if (!c->next) { /* rryan: this is the last line, we didn't find an end. */
-      script_log("Trigger VNum %d has 'if' without 'end'. (error 2)", GET_TRIG_VNUM(trig));
-      return c;
-    }
-  }
-
-  /* rryan: we didn't find an end */
-  script_log("Trigger VNum %d has 'if' without 'end'. (error 3)", GET_TRIG_VNUM(trig));
-  return c;
+  return cl->end;
 }
 
 /* Searches for valid elseif, else, or end to continue execution at. Returns
- * line of elseif, else, or end if found, or last line of trigger. */
+ * line of elseif, else, or end if found, or last line of trigger.  Only the
+ * elseif conditions are left to work out here, compile_cmdlist() has found
+ * the lines to stop at. */
 static struct cmdlist_element *find_else_end(trig_data *trig,
         struct cmdlist_element *cl, void *go, struct script_data *sc, int type) {
   struct cmdlist_element *c;
-  char *p;
-
-  if (!(cl->next))
-    return cl;
 
-  for (c = cl->next; c->next; c = c->next) {
-    for (p = c->cmd; *p && isspace(*p); p++); /* skip spaces */
-
-    if (!strn_cmp("if ", p, 3))
-      c = find_end(trig, c);
-
-    else if (!strn_cmp("elseif ", p, 7)) {
-      if (process_if(p + 7, go, sc, trig, type)) {
-        GET_TRIG_DEPTH(trig)++;
-        return c;
-      }
-    } else if (!strn_cmp("else", p, 4)) {
+  for (c = cl->branch; cl->branch_type == DG_BRANCH_ELSEIF; c = cl->branch) {
+    if (process_if(c->line + 7, go, sc, trig, type)) {
       GET_TRIG_DEPTH(trig)++;
       return c;
-    } else if (!strn_cmp("end", p, 3))
-      return c;
-
-    /* thanks to Russell Ryan for this fix */
-    if (!c->next) { /* rryan: this is the last line, return. */
-      script_log("Trigger VNum %d has 'if' without 'end'. (error 4)", GET_TRIG_VNUM(trig));
-      return c;
     }
+    cl = c;
   }
 
-  /* rryan: if we got here, it's the last line, if its not an end, log it. */
-  for (p = c->cmd; *p && isspace(*p); p++); /* skip spaces */
-  if (strn_cmp("end", p, 3))
-    script_log("Trigger VNum %d has 'if' without 'end'. (error 5)", GET_TRIG_VNUM(trig));
+  if (cl->branch_type == DG_BRANCH_ELSE)
+    GET_TRIG_DEPTH(trig)++;
+
   return c;
 }
 
@@ -1735,21 +1771,21 @@ static void process_attach(void *go, struct script_data *sc, trig_data *trig,
     }
     if (!SCRIPT(c))
       CREATE(SCRIPT(c), struct script_data, 1);
-    add_trigger(SCRIPT(c), newtrig, -1);
+    add_trigger(SCRIPT(c), newtrig, -1, c, MOB_TRIGGER);
     return;
   }
 
   if (o) {
     if (!SCRIPT(o))
       CREATE(SCRIPT(o), struct script_data, 1);
-    add_trigger(SCRIPT(o), newtrig, -1);
+    add_trigger(SCRIPT(o), newtrig, -1, o, OBJ_TRIGGER);
     return;
   }
 
   if (r) {
     if (!SCRIPT(r))
       CREATE(SCRIPT(r), struct script_data, 1);
-    add_trigger(SCRIPT(r), newtrig, -1);
+    add_trigger(SCRIPT(r), newtrig, -1, r, WLD_TRIGGER);
     return;
   }
 }
@@ -2009,15 +2045,10 @@ static void process_remote(struct script_data *sc, trig_data *trig, char *cmd) {
   }
 
   /* find the locally owned variable */
-  for (vd = GET_TRIG_VARS(trig); vd; vd = vd->next)
-    if (!str_cmp(vd->name, buf))
-      break;
+  vd = find_var(&GET_TRIG_VARS(trig), buf);
 
   if (!vd)
-    for (vd = sc->global_vars; vd; vd = vd->next)
-      if (!str_cmp(vd->name, var) &&
-              (vd->context == 0 || vd->context == sc->context))
-        break;
+    vd = find_var_context(&sc->global_vars, var, sc->context);
 
   if (!vd) {
     script_log("Trigger: %s, VNum %d. local var '%s' not found in remote call",
@@ -2057,7 +2088,7 @@ static void process_remote(struct script_data *sc, trig_data *trig, char *cmd) {
 /* Command-line interface to rdelete. Named vdelete so people didn't think it
  * was to delete rooms. */
 ACMD(do_vdelete) {
-  struct trig_var_data *vd, *vd_prev = NULL;
+  struct trig_var_data *vd;
   struct script_data *sc_remote = NULL;
   char *var, *uid_p;
   char buf[MAX_INPUT_LENGTH], buf2[MAX_INPUT_LENGTH];
@@ -2102,42 +2133,25 @@ ACMD(do_vdelete) {
     return;
   }
 
-  if (sc_remote->global_vars == NULL) {
+  if (sc_remote->global_vars.list == NULL) {
     send_to_char(ch, "That id represents no global variables.(2)\r\n");
     return;
   }
 
   if (*var == '*' || is_abbrev(var, "all")) {
-    struct trig_var_data *vd_next;
-    for (vd = sc_remote->global_vars; vd; vd = vd_next) {
-      vd_next = vd->next;
-      free(vd->value);
-      free(vd->name);
-      free(vd);
-    }
-    sc_remote->global_vars = NULL;
+    free_varlist(&sc_remote->global_vars);
     send_to_char(ch, "All variables deleted from that id.\r\n");
     return;
   }
 
   /* find the global */
-  for (vd = sc_remote->global_vars; vd; vd_prev = vd, vd = vd->next)
-    if (!str_cmp(vd->name, var))
-      break;
-
-  if (!vd) {
+  if (!(vd = find_var(&sc_remote->global_vars, var))) {
     send_to_char(ch, "That variable cannot be located.\r\n");
     return;
   }
 
   /* ok, delete the variable */
-  if (vd_prev) vd_prev->next = vd->next;
-  else sc_remote->global_vars = vd->next;
-
-  /* and free up the space */
-  free(vd->value);
-  free(vd->name);
-  free(vd);
+  remove_var_el(&sc_remote->global_vars, vd);
 
   send_to_char(ch, "Deleted.\r\n");
 }
@@ -2163,7 +2177,7 @@ int perform_set_dg_var(struct char_data *ch, struct char_data *vict, char *val_a
 /* Delete a variable from the globals of another script.
  * 'rdelete <variable_name> <uid>' */
 static void process_rdelete(struct script_data *sc, trig_data *trig, char *cmd) {
-  struct trig_var_data *vd, *vd_prev = NULL;
+  struct trig_var_data *vd;
   struct script_data *sc_remote = NULL;
   char *line, *var, *uid_p;
   char arg[MAX_INPUT_LENGTH], buf[MAX_STRING_LENGTH], buf2[MAX_STRING_LENGTH];
@@ -2207,24 +2221,15 @@ static void process_rdelete(struct script_data *sc, trig_data *trig, char *cmd)
   }
 
   if (sc_remote == NULL) return; /* no script to delete a trigger from */
-  if (sc_remote->global_vars == NULL) return; /* no script globals */
+  if (sc_remote->global_vars.list == NULL) return; /* no script globals */
 
   /* find the global */
-  for (vd = sc_remote->global_vars; vd; vd_prev = vd, vd = vd->next)
-    if (!str_cmp(vd->name, var) &&
-            (vd->context == 0 || vd->context == sc->context))
-      break;
+  vd = find_var_context(&sc_remote->global_vars, var, sc->context);
 
   if (!vd) return; /* the variable doesn't exist, or is the wrong context */
 
   /* ok, delete the variable */
-  if (vd_prev) vd_prev->next = vd->next;
-  else sc_remote->global_vars = vd->next;
-
-  /* and free up the space */
-  free(vd->value);
-  free(vd->name);
-  free(vd);
+  remove_var_el(&sc_remote->global_vars, vd);
 }
 
 /* Makes a local variable into a global variable. */
@@ -2242,9 +2247,7 @@ static void process_global(struct script_data *sc, trig_data *trig, char *cmd, l
     return;
   }
 
-  for (vd = GET_TRIG_VARS(trig); vd; vd = vd->next)
-    if (!str_cmp(vd->name, var))
-      break;
+  vd = find_var(&GET_TRIG_VARS(trig), var);
 
   if (!vd) {
     script_log("Trigger: %s, VNum %d. local var '%s' not found in global call",
@@ -2340,6 +2343,222 @@ static void dg_letter_value(struct script_data *sc, trig_data *trig, char *cmd)
   add_var(&GET_TRIG_VARS(trig), varname, junk, sc->context);
 }
 
+/* The commands script_driver() handles itself, in the order it has always
+ * tested for them: "halting" is a halt, "setting" is not a set. */
+static const struct {
+  const char *word;
+  size_t len;
+  int type;
+} dg_commands[] = {
+  {"eval ", 5, DG_CMD_EVAL},
+  {"nop ", 4, DG_CMD_NOP},
+  {"extract ", 8, DG_CMD_EXTRACT},
+  {"dg_letter ", 10, DG_CMD_DG_LETTER},
+  {"makeuid ", 8, DG_CMD_MAKEUID},
+  {"halt", 4, DG_CMD_HALT},
+  {"dg_cast ", 8, DG_CMD_DG_CAST},
+  {"dg_affect ", 10, DG_CMD_DG_AFFECT},
+  {"global ", 7, DG_CMD_GLOBAL},
+  {"context ", 8, DG_CMD_CONTEXT},
+  {"remote ", 7, DG_CMD_REMOTE},
+  {"rdelete ", 8, DG_CMD_RDELETE},
+  {"return ", 7, DG_CMD_RETURN},
+  {"set ", 4, DG_CMD_SET},
+  {"unset ", 6, DG_CMD_UNSET},
+  {"wait ", 5, DG_CMD_WAIT},
+  {"attach ", 7, DG_CMD_ATTACH},
+  {"detach ", 7, DG_CMD_DETACH},
+  {NULL, 0, DG_CMD_GAME}
+};
+
+/* The longest word in dg_commands[]. */
+#define DG_CMD_WORD_LEN 10
+
+static int dg_command_type(const char *cmd) {
+  int i;
+
+  for (i = 0; dg_commands[i].word; i++)
+    if (!strn_cmp(cmd, dg_commands[i].word, dg_commands[i].len))
+      break;
+
+  return dg_commands[i].type;
+}
+
+static int dg_line_type(const char *p) {
+  if (*p == '*')
+    return DG_LINE_COMMENT;
+  if (!strn_cmp(p, "if ", 3))
+    return DG_LINE_IF;
+  if (!strn_cmp("elseif ", p, 7) || !strn_cmp("else", p, 4))
+    return DG_LINE_ELSE;
+  if (!strn_cmp("while ", p, 6))
+    return DG_LINE_WHILE;
+  if (!strn_cmp("switch ", p, 7))
+    return DG_LINE_SWITCH;
+  if (!strn_cmp("end", p, 3))
+    return DG_LINE_END;
+  if (!strn_cmp("done", p, 4))
+    return DG_LINE_DONE;
+  if (!strn_cmp("break", p, 5))
+    return DG_LINE_BREAK;
+  if (!strn_cmp("case", p, 4))
+    return DG_LINE_CASE;
+  return DG_LINE_COMMAND;
+}
+
+/* Scans for end of if-block.  returns the line containg 'end', or the last
+ * line of the trigger if not found.  Later lines are already compiled. */
+static struct cmdlist_element *compile_end(struct cmdlist_element *cl,
+        trig_vnum vnum, bool report) {
+  struct cmdlist_element *c;
+
+  if (!(cl->next)) { /* rryan: if this is the last line, theres no end */
+    if (report)
+      script_log("Trigger VNum %d has 'if' without 'end'. (error 1)", vnum);
+    return cl;
+  }
+
+  for (c = cl->next; c; c = c->next) {
+    if (!strn_cmp("if ", c->line, 3))
+      c = c->end;
+    else if (!strn_cmp("end", c->line, 3))
+      return c;
+
+    /* thanks to Russell Ryan for this fix */
+    if (!c->next) { /* rryan: this is the last line, we didn't find an end. */
+      if (report)
+        script_log("Trigger VNum %d has 'if' without 'end'. (error 2)", vnum);
+      return c;
+    }
+  }
+
+  /* rryan: we didn't find an end */
+  if (report)
+    script_log("Trigger VNum %d has 'if' without 'end'. (error 3)", vnum);
+  return c;
+}
+
+/* Finds where find_else_end() stops after the if or elseif at cl: the next
+ * elseif, else or end at this level, or the last line of the trigger. */
+static void compile_branch(struct cmdlist_element *cl, trig_vnum vnum) {
+  struct cmdlist_element *c;
+
+  cl->branch = cl;
+  cl->branch_type = DG_BRANCH_END;
+
+  if (!(cl->next))
+    return;
+
+  for (c = cl->next; c->next; c = c->next) {
+    cl->branch = c;
+
+    if (!strn_cmp("if ", c->line, 3))
+      c = c->end;
+
+    else if (!strn_cmp("elseif ", c->line, 7)) {
+      cl->branch_type = DG_BRANCH_ELSEIF;
+      return;
+    } else if (!strn_cmp("else", c->line, 4)) {
+      cl->branch_type = DG_BRANCH_ELSE;
+      return;
+    } else if (!strn_cmp("end", c->line, 3))
+      return;
+
+    /* thanks to Russell Ryan for this fix */
+    if (!c->next) { /* rryan: this is the last line, return. */
+      script_log("Trigger VNum %d has 'if' without 'end'. (error 4)", vnum);
+      cl->branch = c;
+      return;
+    }
+  }
+
+  /* rryan: if we got here, it's the last line, if its not an end, log it. */
+  if (strn_cmp("end", c->line, 3))
+    script_log("Trigger VNum %d has 'if' without 'end'. (error 5)", vnum);
+  cl->branch = c;
+}
+
+/* Scans for end of while/switch-blocks. Returns the line containg 'done', or
+ * the last line of the trigger if not found. Malformed scripts may cause NULL
+ * to be returned.  Later lines are already compiled. */
+static struct cmdlist_element *compile_done(struct cmdlist_element *cl) {
+  struct cmdlist_element *c;
+
+  if (!(cl->next))
+    return cl;
+
+  for (c = cl->next; c && c->next; c = c->next) {
+    if (!strn_cmp("while ", c->line, 6) || !strn_cmp("switch ", c->line, 7)) {
+      /* The scan used to fall off the end of the list here. */
+      if (!(c = c->done))
+        break;
+    } else if (!strn_cmp("done", c->line, 3))
+      return c;
+  }
+
+  return c;
+}
+
+/* Works out once what script_driver() used to work out every time a line
+ * ran: what kind of line it is, which command it is when no variable can
+ * change that, how a command splits up into text and variables, and where
+ * the blocks it opens or closes end.  Called when a
+ * trigger is loaded or saved in trigedit; the results are kept on the lines
+ * themselves, which every copy of the trigger shares. */
+void compile_cmdlist(struct cmdlist_element *cmdlist, trig_vnum vnum) {
+  struct cmdlist_element **lines, *cl;
+  size_t len;
+  int num_lines = 0, i;
+  char *p;
+
+  for (cl = cmdlist; cl; cl = cl->next)
+    num_lines++;
+
+  if (!num_lines)
+    return;
+
+  CREATE(lines, struct cmdlist_element *, num_lines);
+
+  for (i = 0, cl = cmdlist; cl; cl = cl->next, i++) {
+    lines[i] = cl;
+
+    for (p = cl->cmd; *p && isspace(*p); p++);
+    cl->line = p;
+    cl->line_type = dg_line_type(p);
+    cl->end = cl->branch = cl->done = NULL;
+    cl->branch_type = DG_BRANCH_END;
+
+    /* var_subst() copies everything up to the first %, so if there is none
+     * among the characters the commands are told apart by, it is known now. */
+    len = strcspn(p, "%");
+    if (cl->line_type == DG_LINE_COMMAND && (!p[len] || len >= DG_CMD_WORD_LEN))
+      cl->cmd_type = dg_command_type(p);
+    else
+      cl->cmd_type = DG_CMD_UNKNOWN;
+
+    if (cl->subst)
+      free(cl->subst);
+    cl->subst = cl->line_type == DG_LINE_COMMAND ? compile_subst(p) : NULL;
+  }
+
+  /* Backwards, so the blocks nested in a block are done before it. */
+  for (i = num_lines - 1; i >= 0; i--) {
+    cl = lines[i];
+
+    if (cl->line_type == DG_LINE_IF || cl->line_type == DG_LINE_ELSE)
+      cl->end = compile_end(cl, vnum, cl->line_type == DG_LINE_IF);
+
+    if (cl->line_type == DG_LINE_IF || !strn_cmp("elseif ", cl->line, 7))
+      compile_branch(cl, vnum);
+
+    if (cl->line_type == DG_LINE_WHILE || cl->line_type == DG_LINE_BREAK ||
+            !strn_cmp("switch", cl->line, 6))
+      cl->done = compile_done(cl);
+  }
+
+  free(lines);
+}
+
 /* This is the core driver for scripts.
  * Arguments:
  * void *go_adress
@@ -2421,137 +2640,179 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode) {
 
   dg_owner_purged = 0;
 
+  if (trig->cmdlist && !trig->cmdlist->line)
+    compile_cmdlist(trig->cmdlist, GET_TRIG_VNUM(trig));
+
   for (cl = (mode == TRIG_NEW) ? trig->cmdlist : trig->curr_state;
           cl && GET_TRIG_DEPTH(trig); cl = cl->next) {
-    for (p = cl->cmd; *p && isspace(*p); p++);
+    p = cl->line;
 
-    if (*p == '*') /* comment */
-      continue;
+    switch (cl->line_type) {
+      case DG_LINE_COMMENT:
+        continue;
 
-    else if (!strn_cmp(p, "if ", 3)) {
-      if (process_if(p + 3, go, sc, trig, type))
-        GET_TRIG_DEPTH(trig)++;
-      else
-        cl = find_else_end(trig, cl, go, sc, type);
-    } else if (!strn_cmp("elseif ", p, 7) ||
-            !strn_cmp("else", p, 4)) {
-      /* If not in an if-block, ignore the extra 'else[if]' and warn about it. */
-      if (GET_TRIG_DEPTH(trig) == 1) {
-        script_log("Trigger VNum %d has 'else' without 'if'.",
-                GET_TRIG_VNUM(trig));
+      case DG_LINE_IF:
+        if (process_if(p + 3, go, sc, trig, type))
+          GET_TRIG_DEPTH(trig)++;
+        else
+          cl = find_else_end(trig, cl, go, sc, type);
         continue;
-      }
-      cl = find_end(trig, cl);
-      GET_TRIG_DEPTH(trig)--;
-    } else if (!strn_cmp("while ", p, 6)) {
-      temp = find_done(cl);
-      if (!temp) {
-        script_log("Trigger VNum %d has 'while' without 'done'.",
-                GET_TRIG_VNUM(trig));
-        return ret_val;
-      }
-      if (process_if(p + 6, go, sc, trig, type)) {
-        temp->original = cl;
-      } else {
-        cl = temp;
-        loops = 0;
-      }
-    } else if (!strn_cmp("switch ", p, 7)) {
-      cl = find_case(trig, cl, go, sc, type, p + 7);
-    } else if (!strn_cmp("end", p, 3)) {
-      /* If not in an if-block, ignore the extra 'end' and warn about it. */
-      if (GET_TRIG_DEPTH(trig) == 1) {
-        script_log("Trigger VNum %d has 'end' without 'if'.",
-                GET_TRIG_VNUM(trig));
+
+      case DG_LINE_ELSE:
+        /* If not in an if-block, ignore the extra 'else[if]' and warn about it. */
+        if (GET_TRIG_DEPTH(trig) == 1) {
+          script_log("Trigger VNum %d has 'else' without 'if'.",
+                  GET_TRIG_VNUM(trig));
+          continue;
+        }
+        cl = find_end(trig, cl);
+        GET_TRIG_DEPTH(trig)--;
         continue;
-      }
-      GET_TRIG_DEPTH(trig)--;
-    } else if (!strn_cmp("done", p, 4)) {
-      /* if in a while loop, cl->original is non-NULL */
-      if (cl->original) {
-        char *orig_cmd = cl->original->cmd;
-        while (*orig_cmd && isspace(*orig_cmd)) orig_cmd++;
-        if (cl->original && process_if(orig_cmd + 6, go, sc, trig,
-                type)) {
-          cl = cl->original;
-          loops++;
-          GET_TRIG_LOOPS(trig)++;
-          if (loops == 30) {
-            process_wait(go, trig, type, "wait 1", cl);
-            depth--;
-            return ret_val;
-          }
-          if (GET_TRIG_LOOPS(trig) >= 100) {
-            script_log("Trigger VNum %d has looped 100 times!!!",
-                    GET_TRIG_VNUM(trig));
-            break;
-          }
+
+      case DG_LINE_WHILE:
+        temp = find_done(cl);
+        if (!temp) {
+          script_log("Trigger VNum %d has 'while' without 'done'.",
+                  GET_TRIG_VNUM(trig));
+          return ret_val;
+        }
+        if (process_if(p + 6, go, sc, trig, type)) {
+          temp->original = cl;
         } else {
-          /* if we're falling through a switch statement, this ends it. */
+          cl = temp;
+          loops = 0;
         }
-      }
-    } else if (!strn_cmp("break", p, 5)) {
-      cl = find_done(cl);
-    } else if (!strn_cmp("case", p, 4)) {
-      /* Do nothing, this allows multiple cases to a single instance */
-    } else {
-      var_subst(go, sc, trig, type, p, cmd);
+        continue;
+
+      case DG_LINE_SWITCH:
+        cl = find_case(trig, cl, go, sc, type, p + 7);
+        continue;
+
+      case DG_LINE_END:
+        /* If not in an if-block, ignore the extra 'end' and warn about it. */
+        if (GET_TRIG_DEPTH(trig) == 1) {
+          script_log("Trigger VNum %d has 'end' without 'if'.",
+                  GET_TRIG_VNUM(trig));
+          continue;
+        }
+        GET_TRIG_DEPTH(trig)--;
+        continue;
+
+      case DG_LINE_DONE:
+        /* if in a while loop, cl->original is non-NULL.  If we're falling
+         * through a switch statement, this ends it. */
+        if (!cl->original || !process_if(cl->original->line + 6, go, sc, trig, type))
+          continue;
+
+        cl = cl->original;
+        loops++;
+        GET_TRIG_LOOPS(trig)++;
+        if (loops == 30) {
+          process_wait(go, trig, type, "wait 1", cl);
+          depth--;
+          return ret_val;
+        }
+        if (GET_TRIG_LOOPS(trig) < 100)
+          continue;
+
+        script_log("Trigger VNum %d has looped 100 times!!!",
+                GET_TRIG_VNUM(trig));
+        break;
+
+      case DG_LINE_BREAK:
+        cl = find_done(cl);
+        continue;
 
-      if (!strn_cmp(cmd, "eval ", 5))
+      case DG_LINE_CASE:
+        /* Do nothing, this allows multiple cases to a single instance */
+        continue;
+
+      case DG_LINE_COMMAND:
+        break;
+    }
+
+    /* Only a while that has looped 100 times gets here on a control line. */
+    if (cl->line_type != DG_LINE_COMMAND)
+      break;
+
+    if (cl->subst)
+      var_subst_compiled(go, sc, trig, type, cl->subst, cmd);
+    else
+      strcpy(cmd, p);
+
+    switch (cl->cmd_type == DG_CMD_UNKNOWN ? dg_command_type(cmd) : cl->cmd_type) {
+      case DG_CMD_EVAL:
         process_eval(go, sc, trig, type, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "nop ", 4)); /* nop: do nothing */
+      case DG_CMD_NOP: /* nop: do nothing */
+        continue;
 
-      else if (!strn_cmp(cmd, "extract ", 8))
+      case DG_CMD_EXTRACT:
         extract_value(sc, trig, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "dg_letter ", 10))
+      case DG_CMD_DG_LETTER:
         dg_letter_value(sc, trig, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "makeuid ", 8))
+      case DG_CMD_MAKEUID:
         makeuid_var(go, sc, trig, type, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "halt", 4))
+      case DG_CMD_HALT:
         break;
 
-      else if (!strn_cmp(cmd, "dg_cast ", 8))
+      case DG_CMD_DG_CAST:
         do_dg_cast(go, sc, trig, type, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "dg_affect ", 10))
+      case DG_CMD_DG_AFFECT:
         do_dg_affect(go, sc, trig, type, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "global ", 7))
+      case DG_CMD_GLOBAL:
         process_global(sc, trig, cmd, sc->context);
+        continue;
 
-      else if (!strn_cmp(cmd, "context ", 8))
+      case DG_CMD_CONTEXT:
         process_context(sc, trig, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "remote ", 7))
+      case DG_CMD_REMOTE:
         process_remote(sc, trig, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "rdelete ", 8))
+      case DG_CMD_RDELETE:
         process_rdelete(sc, trig, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "return ", 7))
+      case DG_CMD_RETURN:
         ret_val = process_return(trig, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "set ", 4))
+      case DG_CMD_SET:
         process_set(sc, trig, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "unset ", 6))
+      case DG_CMD_UNSET:
         process_unset(sc, trig, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "wait ", 5)) {
+      case DG_CMD_WAIT:
         process_wait(go, trig, type, cmd, cl);
         depth--;
         return ret_val;
-      } else if (!strn_cmp(cmd, "attach ", 7))
+
+      case DG_CMD_ATTACH:
         process_attach(go, sc, trig, type, cmd);
+        continue;
 
-      else if (!strn_cmp(cmd, "detach ", 7))
+      case DG_CMD_DETACH:
         process_detach(go, sc, trig, type, cmd);
+        continue;
 
-      else {
+      default:
         switch (type) {
           case MOB_TRIGGER:
             if (!script_command_interpreter((char_data *) go, cmd))
@@ -2570,8 +2831,11 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode) {
             *(obj_data **) go_adress = NULL;
           return ret_val;
         }
-      }
+        continue;
     }
+
+    /* halt */
+    break;
   }
 
   switch (type) { /* the script may have been detached */
@@ -2583,8 +2847,7 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode) {
       break;
   }
   if (sc)
-    free_varlist(GET_TRIG_VARS(trig));
-  GET_TRIG_VARS(trig) = NULL;
+    free_varlist(&GET_TRIG_VARS(trig));
   GET_TRIG_DEPTH(trig) = 0;
 
   depth--;
@@ -2647,10 +2910,10 @@ find_case(struct trig_data *trig, struct cmdlist_element *cl,
     return cl;
 
   for (c = cl->next; c->next; c = c->next) {
-    for (p = c->cmd; *p && isspace(*p); p++);
+    p = c->line;
 
     if (!strn_cmp("while ", p, 6) || !strn_cmp("switch", p, 6))
-      c = find_done(c);
+      c = c->done;
     else if (!strn_cmp("case ", p, 5)) {
       buf = (char *) malloc(MAX_STRING_LENGTH);
       if (buf != NULL) {
@@ -2669,26 +2932,11 @@ find_case(struct trig_data *trig, struct cmdlist_element *cl,
   return c;
 }
 
-/* Scans for end of while/switch-blocks. Returns the line containg 'end', or
- * the last line of the trigger if not found. Malformed scripts may cause NULL
- * to be returned. */
+/* Returns the line containing the 'done' of the while/switch-block at cl, or
+ * the last line of the trigger if not found.  Malformed scripts may cause
+ * NULL to be returned.  compile_cmdlist() has found it. */
 static struct cmdlist_element *find_done(struct cmdlist_element *cl) {
-  struct cmdlist_element *c;
-  char *p;
-
-  if (!cl || !(cl->next))
-    return cl;
-
-  for (c = cl->next; c && c->next; c = c->next) {
-    for (p = c->cmd; *p && isspace(*p); p++);
-
-    if (!strn_cmp("while ", p, 6) || !strn_cmp("switch ", p, 7))
-      c = find_done(c);
-    else if (!strn_cmp("done", p, 3))
-      return c;
-  }
-
-  return c;
+  return cl ? cl->done : NULL;
 }
 
 /* load in a character's saved variables */
@@ -2754,8 +3002,8 @@ void save_char_vars(struct char_data *ch) {
   unlink(fn);
 
   /* make sure this char has global variables to save */
-  if (ch->script->global_vars == NULL) return;
-  vars = ch->script->global_vars;
+  if (ch->script->global_vars.list == NULL) return;
+  vars = ch->script->global_vars.list;
 
   file = fopen(fn, "wt");
   if (!file) {
@@ -2820,114 +3068,40 @@ void save_char_vars_ascii(FILE *file, struct char_data *ch) {
   if (IS_NPC(ch)) return;
 
   /* make sure this char has global variables to save */
-  if (ch->script->global_vars == NULL) return;
+  if (ch->script->global_vars.list == NULL) return;
 
   /* Note that currently, context will always be zero. This may change in the
    * future */
-  for (vars = ch->script->global_vars; vars; vars = vars->next)
+  for (vars = ch->script->global_vars.list; vars; vars = vars->next)
     if (*vars->name != '-')
       count++;
 
   if (count != 0) {
     fprintf(file, "Vars: %d\n", count);
 
-    for (vars = ch->script->global_vars; vars; vars = vars->next)
+    for (vars = ch->script->global_vars.list; vars; vars = vars->next)
       if (*vars->name != '-') /* don't save if it begins with - */
         fprintf(file, "%s %ld %s\n", vars->name, vars->context, vars->value);
   }
 }
 
-/* find_char() helpers */
-/* Must be power of 2. */
-#define BUCKET_COUNT 64
-/* To recognize an empty bucket. */
-#define UID_OUT_OF_RANGE 1000000000
-
-struct lookup_table_t {
-  long uid;
-  void * c;
-  struct lookup_table_t *next;
-};
-struct lookup_table_t lookup_table[BUCKET_COUNT];
-
-void init_lookup_table(void) {
-  int i;
-  for (i = 0; i < BUCKET_COUNT; i++) {
-    lookup_table[i].uid = UID_OUT_OF_RANGE;
-    lookup_table[i].c = NULL;
-    lookup_table[i].next = NULL;
-  }
-}
-
+/* find_char() helpers, see dg_lookup.c for the table itself */
 static struct char_data *find_char_by_uid_in_lookup_table(long uid) {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket];
-
-  for (; lt && lt->uid != uid; lt = lt->next);
+  struct char_data *c = (struct char_data *) lookup_table_find(uid);
 
-  if (lt)
-    return (struct char_data *) (lt->c);
+  if (!c)
+    log("find_char_by_uid_in_lookup_table : No entity with number %ld in lookup table", uid);
 
-  log("find_char_by_uid_in_lookup_table : No entity with number %ld in lookup table", uid);
-  return NULL;
+  return c;
 }
 
 static struct obj_data *find_obj_by_uid_in_lookup_table(long uid) {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket];
-
-  for (; lt && lt->uid != uid; lt = lt->next);
-
-  if (lt)
-    return (struct obj_data *) (lt->c);
+  struct obj_data *o = (struct obj_data *) lookup_table_find(uid);
 
-  log("find_obj_by_uid_in_lookup_table : No entity with number %ld in lookup table", uid);
-  return NULL;
-}
-
-void add_to_lookup_table(long uid, void *c) {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket];
-
-  if (lt && lt->uid == uid) {
-    log("add_to_lookup updating existing value for uid=%ld (%p -> %p)", uid, lt->c, c);
-    lt->c = c;
-    return;
-  }
-
-  for (; lt && lt->next; lt = lt->next)
-    if (lt->next->uid == uid) {
-      log("add_to_lookup updating existing value for uid=%ld (%p -> %p)", uid, lt->next->c, c);
-      return;
-    }
-
-  CREATE(lt->next, struct lookup_table_t, 1);
-  lt->next->uid = uid;
-  lt->next->c = c;
-}
-
-void remove_from_lookup_table(long uid) {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket], *flt = NULL;
-
-  /* This is not supposed to happen. UID 0 is not used. However, while I'm
-   * debugging the issue, let's just return right away. - Welcor */
-  if (uid == 0)
-    return;
-
-  for (; lt; lt = lt->next)
-    if (lt->uid == uid)
-      flt = lt;
-
-  if (flt) {
-    for (lt = &lookup_table[bucket]; lt->next != flt; lt = lt->next)
-      ;
-    lt->next = flt->next;
-    free(flt);
-    return;
-  }
+  if (!o)
+    log("find_obj_by_uid_in_lookup_table : No entity with number %ld in lookup table", uid);
 
-  log("remove_from_lookup. UID %ld not found.", uid);
+  return o;
 }
 
 bool check_flags_by_name_ar(int *array, int numflags, char *search, const char *namelist[]) {
@@ -16,6 +16,7 @@
 #define _DG_SCRIPTS_H_
 
 #include "utils.h" /* To make sure ACMD is defined */
+#include "dg_lookup.h"
 
 #define    MOB_TRIGGER   0
 #define    OBJ_TRIGGER   1
@@ -73,7 +74,7 @@
 #define MTRIG_TIME             (1 << 19)     /* trigger based on game hour */
 
 /* obj trigger types */
-#define OTRIG_GLOBAL           (1 << 0)	     /* unused                     */
+#define OTRIG_GLOBAL           (1 << 0)	     /* check even if zone dormant */
 #define OTRIG_RANDOM           (1 << 1)	     /* checked randomly           */
 #define OTRIG_COMMAND          (1 << 2)      /* character types a command  */
 
@@ -130,21 +131,94 @@
 
 #define SCRIPT_ERROR_CODE     -9999999   /* this shouldn't happen too often */
 
+/* What compile_cmdlist() makes of a line, in the order script_driver()
+ * tests for them. */
+#define DG_LINE_COMMAND         0          /* anything else               */
+#define DG_LINE_COMMENT         1          /* * ...                       */
+#define DG_LINE_IF              2
+#define DG_LINE_ELSE            3          /* else or elseif              */
+#define DG_LINE_WHILE           4
+#define DG_LINE_SWITCH          5
+#define DG_LINE_END             6
+#define DG_LINE_DONE            7
+#define DG_LINE_BREAK           8
+#define DG_LINE_CASE            9
+
+/* The command on a DG_LINE_COMMAND line, after variable substitution. */
+#define DG_CMD_UNKNOWN         -1          /* a variable decides, look at run time */
+#define DG_CMD_GAME             0          /* passed to the command interpreter */
+#define DG_CMD_EVAL             1
+#define DG_CMD_NOP              2
+#define DG_CMD_EXTRACT          3
+#define DG_CMD_DG_LETTER        4
+#define DG_CMD_MAKEUID          5
+#define DG_CMD_HALT             6
+#define DG_CMD_DG_CAST          7
+#define DG_CMD_DG_AFFECT        8
+#define DG_CMD_GLOBAL           9
+#define DG_CMD_CONTEXT         10
+#define DG_CMD_REMOTE          11
+#define DG_CMD_RDELETE         12
+#define DG_CMD_RETURN          13
+#define DG_CMD_SET             14
+#define DG_CMD_UNSET           15
+#define DG_CMD_WAIT            16
+#define DG_CMD_ATTACH          17
+#define DG_CMD_DETACH          18
+
+/* Where the scan for an else, elseif or end after an if or elseif stops. */
+#define DG_BRANCH_END           0          /* end, or the end of the trigger */
+#define DG_BRANCH_ELSE          1
+#define DG_BRANCH_ELSEIF        2          /* evaluate it to know          */
+
+/* compile_subst() splits a line into the pieces var_subst_compiled() works
+ * through: each is one of these bytes followed by a NUL-terminated string, and
+ * the last is a DG_SUBST_END byte on its own. */
+#define DG_SUBST_END            0
+#define DG_SUBST_TEXT           1          /* copied as is, %% already %  */
+#define DG_SUBST_VAR            2          /* what was between the %'s    */
+
 /* one line of the trigger */
 struct cmdlist_element {
   char *cmd; /* one line of a trigger */
   struct cmdlist_element *original;
   struct cmdlist_element *next;
+
+  /* Filled in by compile_cmdlist(), shared by every copy of the trigger. */
+  char *line; /* cmd without the leading spaces, NULL until compiled */
+  char *subst; /* line split up by compile_subst(), NULL without a % */
+  byte line_type; /* DG_LINE_ */
+  sbyte cmd_type; /* DG_CMD_ */
+  byte branch_type; /* DG_BRANCH_, for if and elseif */
+  struct cmdlist_element *end; /* matching end, for if, else and elseif */
+  struct cmdlist_element *branch; /* next else/elseif/end, for if and elseif */
+  struct cmdlist_element *done; /* matching done, for while, switch, break */
 };
 
 struct trig_var_data {
-  char *name; /* name of variable  */
+  char *name; /* name of variable, interned: see intern_var_name() */
   char *value; /* value of variable */
   long context; /* 0: global context */
+  unsigned int hash; /* of the name, ignoring case */
+
+  struct trig_var_data *next; /* newest first */
+  struct trig_var_data *prev;
+  struct trig_var_data *next_in_bucket;
+};
 
-  struct trig_var_data *next;
+/* The variables of a trigger or the globals of a script.  Which of several
+ * variables of the same name is found depends on the order they were added
+ * in; list keeps that order, and so does each bucket chain.  The buckets are
+ * only made once there are VAR_TABLE_MIN variables. */
+struct trig_var_table {
+  struct trig_var_data *list; /* all of them, newest first */
+  struct trig_var_data **buckets;
+  int num_buckets;
+  int num_vars;
 };
 
+#define VAR_TABLE_MIN           8
+
 /** structure for triggers */
 struct trig_data {
   IDXTYPE nr; /**< trigger's rnum                  */
@@ -160,7 +234,7 @@ struct trig_data {
   int loops; /**< loop iteration counter          */
   struct event *wait_event; /**< event to pause the trigger  */
   ubyte purged; /**< trigger is set to be purged     */
-  struct trig_var_data *var_list; /**< list of local vars for trigger  */
+  struct trig_var_table var_list; /**< local vars for trigger          */
 
   struct trig_data *next;
   struct trig_data *next_in_world; /**< next in the global trigger list */
@@ -170,11 +244,23 @@ struct trig_data {
 struct script_data {
   long types; /**< bitvector of trigger types */
   struct trig_data *trig_list; /**< list of triggers           */
-  struct trig_var_data *global_vars; /**< list of global variables   */
+  struct trig_var_table global_vars; /**< global variables          */
   ubyte purged; /**< script is set to be purged */
   long context; /**< current context for statics */
 
   struct script_data *next; /**< used for purged_scripts    */
+
+  /* Scripts with random triggers are kept on random_scripts[owner_type], so
+   * script_trigger_check() needn't look at every mob, object and room. */
+  ubyte random_listed; /**< on a random_scripts list      */
+  int owner_type; /**< MOB_TRIGGER, OBJ_TRIGGER or WLD_TRIGGER */
+  union {
+    struct char_data *mob;
+    struct obj_data *obj;
+    room_vnum room; /**< by vnum, since world[] can move */
+  } owner;
+  struct script_data *next_random; /**< next on random_scripts list  */
+  struct script_data *prev_random; /**< prev on random_scripts list  */
 };
 
 /* The event data for the wait command */
@@ -292,7 +378,10 @@ void find_uid_name(char *uid, char *name, size_t nlen);
 void do_sstat_room(struct char_data * ch, room_data *r);
 void do_sstat_object(char_data *ch, obj_data *j);
 void do_sstat_character(char_data *ch, char_data *k);
-void add_trigger(struct script_data *sc, trig_data *t, int loc);
+void add_trigger(struct script_data *sc, trig_data *t, int loc, void *go, int type);
+void unlist_random_script(struct script_data *sc);
+extern struct script_data *random_scripts[3];
+extern int num_random_scripts[3];
 void script_vlog(const char *format, va_list args);
 void script_log(const char *format, ...) __attribute__((format(printf, 1, 2)));
 char *matching_quote(char *p);
@@ -306,14 +395,12 @@ int trig_is_attached(struct script_data *sc, int trig_num);
 /* To maintain strict-aliasing we'll have to do this trick with a union */
 /* Thanks to Chris Gilbert for reminding me that there are other options. */
 int script_driver(void *go_adress, trig_data *trig, int type, int mode);
+void compile_cmdlist(struct cmdlist_element *cmdlist, trig_vnum vnum);
 trig_rnum real_trigger(trig_vnum vnum);
 void process_eval(void *go, struct script_data *sc, trig_data *trig,
         int type, char *cmd);
 void read_saved_vars(struct char_data *ch);
 void save_char_vars(struct char_data *ch);
-void init_lookup_table(void);
-void add_to_lookup_table(long uid, void *c);
-void remove_from_lookup_table(long uid);
 
 /* from dg_db_scripts.c */
 void parse_trigger(FILE *trig_f, int nr);
@@ -324,12 +411,21 @@ void dg_obj_trigger(char *line, struct obj_data *obj);
 void assign_triggers(void *i, int type);
 
 /* From dg_variables.c */
-void add_var(struct trig_var_data **var_list, const char *name, const char *value, long id);
+void add_var(struct trig_var_table *vars, const char *name, const char *value, long id);
+struct trig_var_data *find_var(struct trig_var_table *vars, const char *name);
+struct trig_var_data *find_var_context(struct trig_var_table *vars,
+        const char *name, long context);
+void remove_var_el(struct trig_var_table *vars, struct trig_var_data *vd);
+char *intern_var_name(const char *name, unsigned int *hash);
+void release_var_name(char *name);
 int item_in_list(char *item, obj_data *list);
 char *skill_percent(struct char_data *ch, char *skill);
 int char_has_item(char *item, struct char_data *ch);
 void var_subst(void *go, struct script_data *sc, trig_data *trig,
         int type, char *line, char *buf);
+char *compile_subst(const char *line);
+void var_subst_compiled(void *go, struct script_data *sc, trig_data *trig,
+        int type, const char *subst, char *buf);
 int text_processed(char *field, char *subfield, struct trig_var_data *vd,
         char *str, size_t slen);
 void find_replacement(void *go, struct script_data *sc, trig_data *trig,
@@ -337,8 +433,8 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
 /* From dg_handler.c */
 void free_var_el(struct trig_var_data *var);
-void free_varlist(struct trig_var_data *vd);
-int remove_var(struct trig_var_data **var_list, char *name);
+void free_varlist(struct trig_var_table *vars);
+int remove_var(struct trig_var_table *vars, char *name);
 void free_trigger(trig_data *trig);
 void extract_trigger(struct trig_data *trig);
 void extract_script(void *thing, int type);
@@ -9,6 +9,7 @@
 
 #include "conf.h"
 #include "sysdep.h"
+#include <stddef.h>
 #include "structs.h"
 #include "dg_scripts.h"
 #include "utils.h"
@@ -35,8 +36,162 @@
 /* Thanks to James Long for his assistance in plugging the memory leak that
  * used to be here. - Welcor */
 
+/* Variable names are interned: every variable of the same name, in any
+ * script, points at one copy, which goes away with the last of them. */
+struct var_name {
+  unsigned int hash;
+  int refs;
+  struct var_name *next;
+  char str[1];
+};
+
+#define VAR_NAME_BUCKETS 1024
+
+static struct var_name *var_names[VAR_NAME_BUCKETS];
+
+static unsigned int var_name_hash(const char *name) {
+  unsigned int hash = 2166136261U;
+
+  for (; *name; name++)
+    hash = (hash ^ (unsigned char) LOWER(*name)) * 16777619U;
+
+  return hash;
+}
+
+/* Returns the interned copy of name, counting one more user of it. */
+char *intern_var_name(const char *name, unsigned int *hash) {
+  struct var_name *vn;
+  unsigned int h = var_name_hash(name);
+
+  for (vn = var_names[h % VAR_NAME_BUCKETS]; vn; vn = vn->next)
+    if (vn->hash == h && !strcmp(vn->str, name))
+      break;
+
+  if (!vn) {
+    vn = (struct var_name *) calloc(1, sizeof (struct var_name) + strlen(name));
+    if (!vn) {
+      perror("SYSERR: intern_var_name");
+      abort();
+    }
+    vn->hash = h;
+    strcpy(vn->str, name); /* strcpy: ok */
+    vn->next = var_names[h % VAR_NAME_BUCKETS];
+    var_names[h % VAR_NAME_BUCKETS] = vn;
+  }
+
+  vn->refs++;
+  if (hash)
+    *hash = h;
+  return vn->str;
+}
+
+/* One user fewer of an interned name. */
+void release_var_name(char *name) {
+  struct var_name *vn, **prev;
+
+  vn = (struct var_name *) (name - offsetof(struct var_name, str));
+  if (--vn->refs > 0)
+    return;
+
+  for (prev = &var_names[vn->hash % VAR_NAME_BUCKETS]; *prev; prev = &(*prev)->next)
+    if (*prev == vn) {
+      *prev = vn->next;
+      break;
+    }
+  free(vn);
+}
+
+/* Puts the buckets in step with the list, oldest first so the newest of any
+ * name ends up first in its chain. */
+static void rehash_vars(struct trig_var_table *vars, int num_buckets) {
+  struct trig_var_data *vd;
+  int i;
+
+  if (vars->buckets)
+    free(vars->buckets);
+  CREATE(vars->buckets, struct trig_var_data *, num_buckets);
+  vars->num_buckets = num_buckets;
+
+  if (!(vd = vars->list))
+    return;
+  while (vd->next)
+    vd = vd->next;
+
+  for (; vd; vd = vd->prev) {
+    i = vd->hash & (num_buckets - 1);
+    vd->next_in_bucket = vars->buckets[i];
+    vars->buckets[i] = vd;
+  }
+}
+
+/* The first variable called name, newest first, in any context. */
+struct trig_var_data *find_var(struct trig_var_table *vars, const char *name) {
+  struct trig_var_data *vd;
+  unsigned int hash;
+
+  if (!vars->buckets) {
+    for (vd = vars->list; vd; vd = vd->next)
+      if (!str_cmp(vd->name, name))
+        return vd;
+    return NULL;
+  }
+
+  hash = var_name_hash(name);
+  for (vd = vars->buckets[hash & (vars->num_buckets - 1)]; vd; vd = vd->next_in_bucket)
+    if (vd->hash == hash && !str_cmp(vd->name, name))
+      return vd;
+
+  return NULL;
+}
+
+/* The first variable called name that is global or in the given context. */
+struct trig_var_data *find_var_context(struct trig_var_table *vars,
+        const char *name, long context) {
+  struct trig_var_data *vd;
+  unsigned int hash;
+
+  if (!vars->buckets) {
+    for (vd = vars->list; vd; vd = vd->next)
+      if (!str_cmp(vd->name, name) && (vd->context == 0 || vd->context == context))
+        return vd;
+    return NULL;
+  }
+
+  hash = var_name_hash(name);
+  for (vd = vars->buckets[hash & (vars->num_buckets - 1)]; vd; vd = vd->next_in_bucket)
+    if (vd->hash == hash && !str_cmp(vd->name, name) &&
+            (vd->context == 0 || vd->context == context))
+      return vd;
+
+  return NULL;
+}
+
+/* Takes vd out of vars and frees it. */
+void remove_var_el(struct trig_var_table *vars, struct trig_var_data *vd) {
+  struct trig_var_data **prev;
+
+  if (vars->buckets) {
+    for (prev = &vars->buckets[vd->hash & (vars->num_buckets - 1)]; *prev;
+            prev = &(*prev)->next_in_bucket)
+      if (*prev == vd) {
+        *prev = vd->next_in_bucket;
+        break;
+      }
+  }
+
+  if (vd->prev)
+    vd->prev->next = vd->next;
+  else
+    vars->list = vd->next;
+  if (vd->next)
+    vd->next->prev = vd->prev;
+
+  vars->num_vars--;
+  free_var_el(vd);
+}
+
 /* Adds a variable with given name and value to trigger. */
-void add_var(struct trig_var_data **var_list, const char *name, const char *value, long id) {
+void add_var(struct trig_var_table *vars, const char *name, const char *value, long id) {
   struct trig_var_data *vd;
 
   if (strchr(name, '.')) {
@@ -44,7 +199,7 @@ void add_var(struct trig_var_data **var_list, const char *name, const char *valu
     return;
   }
 
-  for (vd = *var_list; vd && str_cmp(vd->name, name); vd = vd->next);
+  vd = find_var(vars, name);
 
   if (vd && (!vd->context || vd->context == id)) {
     free(vd->value);
@@ -53,14 +208,22 @@ void add_var(struct trig_var_data **var_list, const char *name, const char *valu
   else {
     CREATE(vd, struct trig_var_data, 1);
 
-    CREATE(vd->name, char, strlen(name) + 1);
-    strcpy(vd->name, name); /* strcpy: ok*/
+    vd->name = intern_var_name(name, &vd->hash);
 
     CREATE(vd->value, char, strlen(value) + 1);
 
-    vd->next = *var_list;
+    vd->next = vars->list;
+    if (vars->list)
+      vars->list->prev = vd;
     vd->context = id;
-    *var_list = vd;
+    vars->list = vd;
+    vars->num_vars++;
+
+    if (vars->buckets && vars->num_vars <= vars->num_buckets * 2) {
+      vd->next_in_bucket = vars->buckets[vd->hash & (vars->num_buckets - 1)];
+      vars->buckets[vd->hash & (vars->num_buckets - 1)] = vd;
+    } else if (vars->num_vars >= VAR_TABLE_MIN)
+      rehash_vars(vars, vars->buckets ? vars->num_buckets * 2 : VAR_TABLE_MIN * 2);
   }
 
   strcpy(vd->value, value); /* strcpy: ok*/
@@ -276,16 +439,11 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
   /* X.global() will have a NULL trig */
   if (trig)
-    for (vd = GET_TRIG_VARS(trig); vd; vd = vd->next)
-      if (!str_cmp(vd->name, var))
-        break;
+    vd = find_var(&GET_TRIG_VARS(trig), var);
 
   /* some evil waitstates could crash the mud if sent here with sc==NULL*/
   if (!vd && sc)
-    for (vd = sc->global_vars; vd; vd = vd->next)
-      if (!str_cmp(vd->name, var) &&
-              (vd->context == 0 || vd->context == sc->context))
-        break;
+    vd = find_var_context(&sc->global_vars, var, sc->context);
 
   if (!*field) {
     if (vd)
@@ -414,9 +572,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           script_log("Attempt to find global var. Apparently the void has no script.");
           return;
         }
-        for (vd = thescript->global_vars; vd; vd = vd->next)
-          if (!str_cmp(vd->name, field))
-            break;
+        vd = find_var(&thescript->global_vars, field);
 
         if (vd)
           snprintf(str, slen, "%s", vd->value);
@@ -1237,16 +1393,9 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           break;
         case 'v':
           if (!str_cmp(field, "varexists")) {
-            struct trig_var_data *remote_vd;
             strcpy(str, "0");
-            if (SCRIPT(c)) {
-              for (remote_vd = SCRIPT(c)->global_vars; remote_vd; remote_vd = remote_vd->next) {
-                if (!str_cmp(remote_vd->name, subfield))
-                  break;
-              }
-              if (remote_vd)
-                strcpy(str, "1");
-            }
+            if (SCRIPT(c) && find_var(&SCRIPT(c)->global_vars, subfield))
+              strcpy(str, "1");
           } else if (!str_cmp(field, "vnum")) {
             if (subfield && *subfield) {
               snprintf(str, slen, "%d", IS_NPC(c) ? (int) (GET_MOB_VNUM(c) == atoi(subfield)) : -1);
@@ -1281,9 +1430,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
       if (*str == '\x1') { /* no match found in switch */
         if (SCRIPT(c)) {
-          for (vd = (SCRIPT(c))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
+          vd = find_var(&SCRIPT(c)->global_vars, field);
           if (vd)
             snprintf(str, slen, "%s", vd->value);
           else {
@@ -1488,9 +1635,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
       if (*str == '\x1') { /* no match in switch */
         if (SCRIPT(o)) { /* check for global var */
-          for (vd = (SCRIPT(o))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
+          vd = find_var(&SCRIPT(o)->global_vars, field);
           if (vd)
             snprintf(str, slen, "%s", vd->value);
           else {
@@ -1515,9 +1660,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           script_log("Trigger: %s, Vnum %d, type %d. Trying to access Global var list of void. Apparently this has not been set up!",
                   GET_TRIG_NAME(trig), GET_TRIG_VNUM(trig), type);
         } else {
-          for (vd = (SCRIPT(r))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
+          vd = find_var(&SCRIPT(r)->global_vars, field);
           if (vd)
             snprintf(str, slen, "%s", vd->value);
           else
@@ -1726,9 +1869,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           *str = '\0';      
       } else {
         if (SCRIPT(r)) { /* check for global var */
-          for (vd = (SCRIPT(r))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
+          vd = find_var(&SCRIPT(r)->global_vars, field);
           if (vd)
             snprintf(str, slen, "%s", vd->value);
           else {
@@ -1753,9 +1894,103 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
  * %actor.gold(%actor.gold%)% will double the actors gold every time its called.
  * - Jamie Nelson */
 
+/* Splits line into the pieces var_subst_compiled() works through, see
+ * DG_SUBST_TEXT.  A reference ends where the parser in var_subst_compiled()
+ * stops: at the first % that is neither inside (...) nor just after a dot.
+ * paren_count carries on from one reference to the next, as it does there.
+ * Returns the number of bytes used in out. */
+static size_t split_subst(const char *line, char *out) {
+  char tmp[MAX_INPUT_LENGTH];
+  const char *p = line;
+  char *o = out;
+  int paren_count = 0, dots;
+
+  /* Lines are no longer than input, but out only has room for that much. */
+  if (strlen(line) >= sizeof (tmp)) {
+    strlcpy(tmp, line, sizeof (tmp));
+    p = tmp;
+  }
+
+  while (*p) {
+    /* plain text, with %% standing for a % */
+    if (*p != '%' || *(p + 1) == '%') {
+      *(o++) = DG_SUBST_TEXT;
+      while (*p && (*p != '%' || *(p + 1) == '%')) {
+        if (*p == '%')
+          p++;
+        *(o++) = *(p++);
+      }
+      *(o++) = '\0';
+      continue;
+    }
+
+    /* a % at the very end of the line is dropped */
+    if (!*(++p))
+      break;
+
+    *(o++) = DG_SUBST_VAR;
+    while (*p && (*p != '%') && (*p != '.'))
+      *(o++) = *(p++);
+
+    if (*p == '.') {
+      *(o++) = *(p++);
+      for (dots = 0; *p && ((*p != '%') || (paren_count > 0) || (dots)); p++) {
+        if (dots > 0)
+          dots = 0;
+        else if (*p == '(')
+          paren_count++;
+        else if (*p == ')')
+          paren_count--;
+        else if (paren_count <= 0 && *p == '.')
+          dots++;
+        *(o++) = *p;
+      }
+    }
+    *(o++) = '\0';
+
+    if (*p)
+      p++;
+  }
+  *(o++) = DG_SUBST_END;
+
+  return o - out;
+}
+
+/* Splits a trigger line up for var_subst_compiled() once, when the trigger is
+ * compiled.  Returns NULL if the line has nothing to substitute. */
+char *compile_subst(const char *line) {
+  char out[MAX_INPUT_LENGTH * 2 + 2], *subst;
+  size_t len;
+
+  if (!strchr(line, '%'))
+    return NULL;
+
+  len = split_subst(line, out);
+  CREATE(subst, char, len);
+  memcpy(subst, out, len);
+
+  return subst;
+}
+
 /* substitutes any variables into line and returns it as buf */
 void var_subst(void *go, struct script_data *sc, trig_data *trig,
         int type, char *line, char *buf) {
+  char subst[MAX_INPUT_LENGTH * 2 + 2];
+
+  /* skip out if no %'s */
+  if (!strchr(line, '%')) {
+    strcpy(buf, line);
+    return;
+  }
+
+  split_subst(line, subst);
+  var_subst_compiled(go, sc, trig, type, subst, buf);
+}
+
+/* substitutes the variables into a line split up by split_subst() and
+ * returns it as buf */
+void var_subst_compiled(void *go, struct script_data *sc, trig_data *trig,
+        int type, const char *subst, char *buf) {
   char tmp[MAX_INPUT_LENGTH], repl_str[MAX_INPUT_LENGTH];
   char *var = NULL, *field = NULL, *p = NULL;
   char tmp2[MAX_INPUT_LENGTH];
@@ -1764,88 +1999,75 @@ void var_subst(void *go, struct script_data *sc, trig_data *trig,
   int paren_count = 0;
   int dots = 0;
 
-  /* skip out if no %'s */
-  if (!strchr(line, '%')) {
-    strcpy(buf, line);
-    return;
-  }
   /*lets just empty these to start with*/
-  *repl_str = *tmp = *tmp2 = '\0';
+  *repl_str = *tmp = *tmp2 = *buf = '\0';
 
-  p = strcpy(tmp, line);
   subfield_p = subfield;
 
   left = MAX_INPUT_LENGTH - 1;
 
-  while (*p && (left > 0)) {
+  while (*subst != DG_SUBST_END && (left > 0)) {
 
+    len = strlen(++subst);
 
-    /* copy until we find the first % */
-    while (*p && (*p != '%') && (left > 0)) {
-      *(buf++) = *(p++);
-      left--;
+    if (*(subst - 1) == DG_SUBST_TEXT) {
+      memcpy(buf, subst, MIN(len, left));
+      buf += MIN(len, left);
+      left -= MIN(len, left);
+      *buf = '\0';
+      subst += len + 1;
+      continue;
     }
 
-    *buf = '\0';
+    /* search until end of var or beginning of field */
+    p = memcpy(tmp, subst, len + 1);
+    subst += len + 1;
+    for (var = p; *p && (*p != '.'); p++);
 
-    /* double % */
-    if (*p && (*(++p) == '%') && (left > 0)) {
-      *(buf++) = *(p++);
-      *buf = '\0';
-      left--;
-      continue;
-    }      /* so it wasn't double %'s */
-    else if (*p && (left > 0)) {
-
-      /* search until end of var or beginning of field */
-      for (var = p; *p && (*p != '%') && (*p != '.'); p++);
-
-      field = p;
-      if (*p == '.') {
-        *(p++) = '\0';
-        dots = 0;
-        for (field = p; *p && ((*p != '%') || (paren_count > 0) || (dots)); p++) {
-          if (dots > 0) {
-            *subfield_p = '\0';
-            find_replacement(go, sc, trig, type, var, field, subfield, repl_str, sizeof (repl_str));
-            if (*repl_str) {
-              snprintf(tmp2, sizeof (tmp2), "eval tmpvr %s", repl_str); //temp var
-              process_eval(go, sc, trig, type, tmp2);
-              strcpy(var, "tmpvr");
-              field = p;
-              dots = 0;
-              continue;
-            }
+    field = p;
+    if (*p == '.') {
+      *(p++) = '\0';
+      dots = 0;
+      for (field = p; *p; p++) {
+        if (dots > 0) {
+          *subfield_p = '\0';
+          find_replacement(go, sc, trig, type, var, field, subfield, repl_str, sizeof (repl_str));
+          if (*repl_str) {
+            snprintf(tmp2, sizeof (tmp2), "eval tmpvr %s", repl_str); //temp var
+            process_eval(go, sc, trig, type, tmp2);
+            strcpy(var, "tmpvr");
+            field = p;
             dots = 0;
-          } else if (*p == '(') {
-            *p = '\0';
-            paren_count++;
-          } else if (*p == ')') {
-            *p = '\0';
-            paren_count--;
-          } else if (paren_count > 0) {
-            *subfield_p++ = *p;
-          } else if (*p == '.') {
-            *p = '\0';
-            dots++;
+            continue;
           }
-        } /* for (field.. */
-      } /* if *p == '.' */
+          dots = 0;
+        } else if (*p == '(') {
+          *p = '\0';
+          paren_count++;
+        } else if (*p == ')') {
+          *p = '\0';
+          paren_count--;
+        } else if (paren_count > 0) {
+          *subfield_p++ = *p;
+        } else if (*p == '.') {
+          *p = '\0';
+          dots++;
+        }
+      } /* for (field.. */
+    } /* if *p == '.' */
 
-      *(p++) = '\0';
-      *subfield_p = '\0';
+    *subfield_p = '\0';
 
-      if (*subfield) {
-        var_subst(go, sc, trig, type, subfield, tmp2);
-        strcpy(subfield, tmp2);
-      }
+    if (*subfield) {
+      var_subst(go, sc, trig, type, subfield, tmp2);
+      strcpy(subfield, tmp2);
+    }
 
-      find_replacement(go, sc, trig, type, var, field, subfield, repl_str, sizeof (repl_str));
+    find_replacement(go, sc, trig, type, var, field, subfield, repl_str, sizeof (repl_str));
 
-      strncat(buf, repl_str, left);
-      len = strlen(repl_str);
-      buf += len;
-      left -= len;
-    } /* else if *p .. */
-  } /* while *p .. */
+    strncat(buf, repl_str, left);
+    len = strlen(repl_str);
+    buf += len;
+    left -= len;
+  }
 }
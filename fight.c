@@ -54,6 +54,26 @@ struct char_data *combat_list = NULL;
 
 int hands_used(struct char_data *ch);
 
+#ifdef COMBAT_PROFILE
+/* The real damage(), hit() and perform_violence() get these names, and the
+ * wrappers at the bottom of the file count and time them, so calls from in
+ * here are counted too.  See util/combatbench.c. */
+#define PROFILED(fn) fn##_profiled
+static int damage_profiled(struct char_data *ch, struct char_data *victim,
+        int dam, int w_type, int dam_type, int offhand);
+static int hit_profiled(struct char_data *ch, struct char_data *victim,
+        int type, int dam_type, int penalty, int attack_type);
+static void perform_violence_profiled(struct char_data *ch, int phase);
+
+struct combat_profile combat_profiles[NUM_COMBAT_PROFILES] = {
+  {"perform_violence"},
+  {"hit"},
+  {"damage"}
+};
+#else
+#define PROFILED(fn) fn
+#endif
+
 /* Weapon attack texts
  * don't forget to add to constants.c attack_hit_types */
 struct attack_hit_type attack_hit_text[] = {
@@ -106,9 +126,6 @@ struct attack_hit_type attack_damage_type_text[NUM_ATTACK_DAMAGE_TYPE_TEXT] = {
 
 };
 
-/* local (file scope only) variables */
-static struct char_data *next_combat_list = NULL;
-
 /* local file scope utility functions */
 struct obj_data *get_wielded(struct char_data *ch, int attack_type);
 static void perform_group_gain(struct char_data *ch, int base,
@@ -495,11 +512,7 @@ int compute_armor_class(struct char_data *attacker, struct char_data *ch,
   int armorclass = 0, eq_armoring = 0, temp = GET_AC(ch),
           ac_penalty = 0; /* we keep track of all AC penalties */
   int i = 0, bonuses[NUM_BONUS_TYPES];
-  struct affected_type *affections = NULL, *next = NULL;
-
-  /* Initialize bonuse-types to 0 */
-  for (i = 0; i < NUM_BONUS_TYPES; i++)
-    bonuses[i] = 0;
+  const struct affect_snapshot *snap = get_affect_snapshot(ch);
 
   /* base AC */
   armorclass = 10;
@@ -515,21 +528,12 @@ int compute_armor_class(struct char_data *attacker, struct char_data *ch,
      respective bonuses to the right bonus-types
    *note:  base armor class of stock code system is a system of 100 vs 10 of pathfinder
    */
-  /* increment through all the affections on the character, check for matches */
-  for (affections = ch->affected; affections; affections = next) {
-    next = affections->next;
-
-    if (affections->location == APPLY_AC_NEW) {
-      bonuses[affections->bonus_type] += affections->modifier;
-      /* temp is just our GET_AC(), so remember 10 factor */
-      temp -= (affections->modifier * 10);
-    }
-    /* divide by 10 since old AC system */
-    if (affections->location == APPLY_AC) {
-      bonuses[affections->bonus_type] += (affections->modifier / 10);
-      temp -= affections->modifier;
-    }
-  }
+  /* the affections on the character, added up by bonus type (APPLY_AC is in
+     the old system, so divided by 10) when they last changed */
+  for (i = 0; i < NUM_BONUS_TYPES; i++)
+    bonuses[i] = snap->ac_bonuses[i];
+  /* temp is just our GET_AC(), so take out what they put in it */
+  temp -= snap->ac_applied;
 
   /* now that affections have been extracted from AC, all that is left is
      armoring (helm, body, leggings, sleeves) and shield */
@@ -920,12 +924,60 @@ void check_killer(struct char_data *ch, struct char_data *vict) {
           GET_NAME(ch), GET_NAME(vict), world[IN_ROOM(vict)].name);
 }
 
+/* Combat rounds are run from combat_list, which holds everyone with a round
+ * coming up in the order the rounds are to be run: by pulse, then by room,
+ * then highest initiative first.  Each room's fighters thus sit together and
+ * act one after the other, and combat_round_update() only ever has to look at
+ * the head of the list.  A room's rounds all fall on the same pulses, every
+ * COMBAT_ROUND_PULSES, offset by its vnum so that busy rooms do not all land
+ * on the same pulse. */
+
+/* TRUE if a should have its round before b when both are in the same room. */
+static bool round_goes_first(struct char_data *a, struct char_data *b) {
+  if (GET_INITIATIVE(a) != GET_INITIATIVE(b))
+    return GET_INITIATIVE(a) > GET_INITIATIVE(b);
+  return GET_DEX_BONUS(a) > GET_DEX_BONUS(b);
+}
+
+/* Schedules ch's next round for the first of its room's round pulses that is
+ * not before 'when', taking it off any round it already had. */
+static void schedule_round(struct char_data *ch, unsigned long when) {
+  struct char_data *current = NULL, *previous = NULL, *temp = NULL;
+  room_vnum room = GET_ROOM_VNUM(IN_ROOM(ch));
+
+  if (IN_COMBAT_ROUND(ch)) {
+    REMOVE_FROM_LIST(ch, combat_list, next_fighting);
+  }
+
+  when = MAX(when, pulse + 1);
+  when += (COMBAT_ROUND_PULSES - (when + room) % COMBAT_ROUND_PULSES) % COMBAT_ROUND_PULSES;
+
+  GET_ROUND_DUE(ch) = when;
+  GET_ROUND_ROOM(ch) = room;
+
+  for (current = combat_list; current; previous = current, current = current->next_fighting) {
+    if (GET_ROUND_DUE(current) != when) {
+      if (GET_ROUND_DUE(current) > when)
+        break;
+    } else if (GET_ROUND_ROOM(current) != room) {
+      if (GET_ROUND_ROOM(current) > room)
+        break;
+    } else if (round_goes_first(ch, current))
+      break;
+  }
+
+  ch->next_fighting = current;
+  if (previous == NULL)
+    combat_list = ch;
+  else
+    previous->next_fighting = ch;
+}
+
 /* a function that sets ch fighting victim */
 
 /* TRUE - succeeding in engaging in combat
    FALSE - failed to engage in combat */
 bool set_fighting(struct char_data *ch, struct char_data *vict) {
-  struct char_data *current = NULL, *previous = NULL;
   int delay;
 
   if (ch == vict)
@@ -937,36 +989,13 @@ bool set_fighting(struct char_data *ch, struct char_data *vict) {
     ;
   }
 
-  if (char_has_mud_event(ch, eCOMBAT_ROUND)) {
+  if (IN_COMBAT_ROUND(ch)) {
     return FALSE;
     ;
   }
 
   GET_INITIATIVE(ch) = roll_initiative(ch);
 
-  if (combat_list == NULL) {
-    ch->next_fighting = combat_list;
-    combat_list = ch;
-  } else {
-    for (current = combat_list; current != NULL; current = current->next_fighting) {
-      if ((GET_INITIATIVE(ch) > GET_INITIATIVE(current)) ||
-              ((GET_INITIATIVE(ch) == GET_INITIATIVE(current)) &&
-              (GET_DEX_BONUS(ch) < GET_DEX_BONUS(current)))) {
-        previous = current;
-        continue;
-      }
-      break;
-    }
-    if (previous == NULL) {
-      /* First. */
-      ch->next_fighting = combat_list;
-      combat_list = ch;
-    } else {
-      ch->next_fighting = current;
-      previous->next_fighting = ch;
-    }
-  }
-
   if (AFF_FLAGGED(ch, AFF_SLEEP))
     affect_from_char(ch, SPELL_SLEEP);
 
@@ -988,8 +1017,10 @@ bool set_fighting(struct char_data *ch, struct char_data *vict) {
   if (can_fire_ammo(ch, TRUE))
     FIRING(ch) = TRUE;
 
-  /* start the combat loop, making sure we begin with phase "1" */
-  attach_mud_event(new_mud_event(eCOMBAT_ROUND, ch, strdup("1")), delay);
+  /* start the combat loop, making sure we begin with phase "1": the first
+   * round is the room's round nearest to 'delay' from now */
+  GET_ROUND_PHASE(ch) = 1;
+  schedule_round(ch, pulse + delay - COMBAT_ROUND_PULSES / 2);
 
   return TRUE;
 }
@@ -998,22 +1029,18 @@ bool set_fighting(struct char_data *ch, struct char_data *vict) {
 void stop_fighting(struct char_data *ch) {
   struct char_data *temp = NULL;
 
-  if (ch == next_combat_list)
-    next_combat_list = ch->next_fighting;
-
-  REMOVE_FROM_LIST(ch, combat_list, next_fighting);
+  /* don't forget to take them off the round schedule! */
+  if (IN_COMBAT_ROUND(ch)) {
+    REMOVE_FROM_LIST(ch, combat_list, next_fighting);
+  }
   ch->next_fighting = NULL;
+  GET_ROUND_DUE(ch) = 0;
   FIGHTING(ch) = NULL;
   FIRING(ch) = 0;
   if (GET_POS(ch) == POS_FIGHTING) /* in case they are position fighting */
     change_position(ch, POS_STANDING);
   update_pos(ch);
 
-  /* don't forget to remove the fight event! */
-  if (char_has_mud_event(ch, eCOMBAT_ROUND)) {
-    event_cancel_specific(ch, eCOMBAT_ROUND);
-  }
-
   /* Reset the combat data */
   GET_TOTAL_AOO(ch) = 0;
   REMOVE_BIT_AR(AFF_FLAGS(ch), AFF_FLAT_FOOTED);
@@ -2841,7 +2868,7 @@ int dam_killed_vict(struct char_data *ch, struct char_data *victim) {
    -spell
    -item
    -etc */
-int damage(struct char_data *ch, struct char_data *victim, int dam,
+int PROFILED(damage)(struct char_data *ch, struct char_data *victim, int dam,
         int w_type, int dam_type, int offhand) {
   char buf[MAX_INPUT_LENGTH] = {'\0'};
   char buf1[MAX_INPUT_LENGTH] = {'\0'};
@@ -3835,18 +3862,10 @@ int compute_hit_damage(struct char_data *ch, struct char_data *victim,
 
         /* has event?  then we increment the events svariable */
         if ((pMudEvent = char_has_mud_event(victim, eCRIPPLING_CRITICAL))) {
-          int crippling_critical_var = 0;
-          char buf[10] = {'\0'};
-
-          crippling_critical_var = atoi((char *) pMudEvent->sVariables);
-          crippling_critical_var++;
-          sprintf(buf, "%d", crippling_critical_var);
-          if (pMudEvent->sVariables) /* need to free memory if we changing it */
-            free(pMudEvent->sVariables);
-          pMudEvent->sVariables = strdup(buf);
+          mud_event_set_num(pMudEvent, mud_event_num(pMudEvent, 0) + 1);
 
         } else { /* no event, so make one */
-          pMudEvent = new_mud_event(eCRIPPLING_CRITICAL, victim, strdup("1"));
+          pMudEvent = new_mud_event_num(eCRIPPLING_CRITICAL, victim, 1);
           /* create and attach new event, apply the first effect */
           attach_mud_event(pMudEvent, 60 * PASSES_PER_SEC);
         }
@@ -3858,7 +3877,7 @@ int compute_hit_damage(struct char_data *ch, struct char_data *victim,
           act("\tRYou strike $N with a crippling critical!\tn", FALSE, ch, NULL, victim, TO_CHAR);
           act("\tr$n strikes you with a crippling critical!\tn", FALSE, ch, NULL, victim, TO_VICT);
           act("\tr$n strikes $N with a crippling critical!\tn", FALSE, ch, NULL, victim, TO_NOTVICT);
-          switch (atoi((char *) pMudEvent->sVariables)) {
+          switch (mud_event_num(pMudEvent, 0)) {
             case 1: /* 1d4 strength damage */
               new_affect(&af);
               af.spell = SKILL_CRIPPLING_CRITICAL;
@@ -5752,7 +5771,7 @@ int damage_shield_check(struct char_data *ch, struct char_data *victim,
      #define ATTACK_TYPE_TWOHAND   4
    Attack queue will determine what kind of hit this is. */
 #define DAM_MES_LENGTH  20
-int hit(struct char_data *ch, struct char_data *victim, int type, int dam_type,
+int PROFILED(hit)(struct char_data *ch, struct char_data *victim, int type, int dam_type,
         int penalty, int attack_type) {
   int w_type = 0, /* Weapon type? */
           victim_ac = 0, /* Target's AC, from compute_ac(). */
@@ -6775,51 +6794,60 @@ void autoDiagnose(struct char_data * ch) {
     }
 }
 
-/* Fight control event.  Replaces the violence loop. */
-EVENTFUNC(event_combat_round) {
-  struct char_data *ch = NULL;
-          struct mud_event_data *pMudEvent = NULL;
-
-          /*  This is just a dummy check, but we'll do it anyway */
-  if (event_obj == NULL)
-    return 0;
-
-    /*  For the sake of simplicity, we will place the event data in easily
-     * referenced pointers */
-    pMudEvent = (struct mud_event_data *) event_obj;
-          ch = (struct char_data *) pMudEvent->pStruct;
-
-    if ((!IS_NPC(ch) && (ch->desc != NULL && !IS_PLAYING(ch->desc))) || (FIGHTING(ch) == NULL)) {
-      /*send_to_char(ch, "DEBUG: RETURNING 0 FROM COMBAT EVENT.\r\n");*/
-      stop_fighting(ch);
-      return 0;
-    }
+/* One combat round for ch.  Returns FALSE if ch is out of the fight. */
+static bool combat_round(struct char_data *ch) {
+  int phase = GET_ROUND_PHASE(ch);
 
-  if (FIGHTING(ch) == NULL) {
-    return 0;
+  if ((!IS_NPC(ch) && (ch->desc != NULL && !IS_PLAYING(ch->desc))) || (FIGHTING(ch) == NULL)) {
+    stop_fighting(ch);
+    return FALSE;
   }
 
   if (GET_POS(FIGHTING(ch)) <= POS_DEAD || GET_POS(ch) <= POS_DEAD) {
     stop_fighting(ch);
-    return 0;
+    return FALSE;
   }
 
   if (IN_ROOM(ch) != IN_ROOM(FIGHTING(ch))) {
     stop_fighting(ch);
-    return 0;
+    return FALSE;
   }
 
   /* action queue system */
   execute_next_action(ch);
-          /* execute phase */
-          perform_violence(ch, (pMudEvent->sVariables != NULL && is_number(pMudEvent->sVariables) ? atoi(pMudEvent->sVariables) : 0));
+  /* execute phase */
+  perform_violence(ch, phase);
+
+  return TRUE;
+}
 
-          /* set the next phase */
-  if (pMudEvent->sVariables != NULL)
-          sprintf(pMudEvent->sVariables, "%d", (atoi(pMudEvent->sVariables) < 3 ? atoi(pMudEvent->sVariables) + 1 : 1));
+/* Fight control, called every pulse.  Replaces the violence loop: runs the
+ * rounds that are due now, room by room and in initiative order within a
+ * room, so a room's round reaches the people watching it all in one go. */
+void combat_round_update(void) {
+  struct char_data *ch = NULL;
+  unsigned long due;
 
-    return 2 RL_SEC; /* 6 second rounds, hack! */
+  while ((ch = combat_list) && GET_ROUND_DUE(ch) <= pulse) {
+    due = GET_ROUND_DUE(ch);
+
+    /* Moved on, and the fight with them: fall in with the new room's rounds. */
+    if (GET_ROUND_ROOM(ch) != GET_ROOM_VNUM(IN_ROOM(ch)) && FIGHTING(ch) &&
+            IN_ROOM(ch) == IN_ROOM(FIGHTING(ch))) {
+      schedule_round(ch, due);
+      continue;
+    }
+
+    if (!combat_round(ch))
+      continue;
+
+    /* set the next phase, unless the round ended the fight or started another */
+    if (GET_ROUND_DUE(ch) == due) {
+      GET_ROUND_PHASE(ch) = (GET_ROUND_PHASE(ch) < 3 ? GET_ROUND_PHASE(ch) + 1 : 1);
+      schedule_round(ch, due + COMBAT_ROUND_PULSES);
+    }
   }
+}
 
 void handle_cleave(struct char_data *ch) {
   struct list_data *target_list = NULL;
@@ -6907,8 +6935,8 @@ void handle_smash_defense(struct char_data *ch) {
                   }
 
 /* control the fights going on.
- * Called from combat round event. */
-void perform_violence(struct char_data *ch, int phase) {
+ * Called from combat_round_update(). */
+void PROFILED(perform_violence)(struct char_data *ch, int phase) {
   struct char_data *tch = NULL, *charmee;
           struct list_data *room_list = NULL;
 
@@ -7189,6 +7217,63 @@ void perform_violence(struct char_data *ch, int phase) {
 
 }
 
+#ifdef COMBAT_PROFILE
+static double profile_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/* Time is only taken around the outermost call, so a function that ends up
+ * calling itself (damage() through a damage shield, say) is not counted
+ * twice. */
+static void profile_enter(int which) {
+  struct combat_profile *prof = &combat_profiles[which];
+
+  prof->calls++;
+  if (prof->depth++ == 0)
+    prof->started = profile_now();
+}
+
+static void profile_leave(int which) {
+  struct combat_profile *prof = &combat_profiles[which];
+
+  if (--prof->depth == 0)
+    prof->secs += profile_now() - prof->started;
+}
+
+int damage(struct char_data *ch, struct char_data *victim, int dam,
+        int w_type, int dam_type, int offhand) {
+  int result;
+
+  profile_enter(COMBAT_PROFILE_DAMAGE);
+  result = damage_profiled(ch, victim, dam, w_type, dam_type, offhand);
+  profile_leave(COMBAT_PROFILE_DAMAGE);
+
+  return result;
+}
+
+int hit(struct char_data *ch, struct char_data *victim, int type, int dam_type,
+        int penalty, int attack_type) {
+  int result;
+
+  profile_enter(COMBAT_PROFILE_HIT);
+  result = hit_profiled(ch, victim, type, dam_type, penalty, attack_type);
+  profile_leave(COMBAT_PROFILE_HIT);
+
+  return result;
+}
+
+void perform_violence(struct char_data *ch, int phase) {
+  profile_enter(COMBAT_PROFILE_VIOLENCE);
+  perform_violence_profiled(ch, phase);
+  profile_leave(COMBAT_PROFILE_VIOLENCE);
+}
+#endif /* COMBAT_PROFILE */
+
+#undef PROFILED
+
 #undef HIT_MISS
 #undef HIT_RESULT_ACTION
 #undef HIT_NEED_RELOAD
@@ -27,6 +27,10 @@
 #define SKILL_MESSAGE_DEATH_BLOW       5
 #define SKILL_MESSAGE_GENERIC_HIT      6
 
+/* A combat round takes this long.  Everyone fighting in a room has their
+ * rounds on the same pulses; see combat_round_update(). */
+#define COMBAT_ROUND_PULSES  (2 RL_SEC)
+
 /* Attacktypes with grammar */
 struct attack_hit_type {
    const char *singular;
@@ -67,6 +71,7 @@ int hit(struct char_data *ch, struct char_data *victim,
 	int type, int dam_type, int penalty, int dualwield);
 void load_messages(void);
 void perform_violence(struct char_data *ch, int phase);
+void combat_round_update(void);
 void raw_kill(struct char_data * ch, struct char_data * killer);
 bool set_fighting(struct char_data *ch, struct char_data *victim);
 int skill_message(int dam, struct char_data *ch, struct char_data *vict,
@@ -78,6 +83,25 @@ int compute_hit_damage(struct char_data *ch, struct char_data *victim,
         int w_type, int diceroll, int mode, bool is_critical, int attack_type);
 
 
+#ifdef COMBAT_PROFILE
+/* Call counts and inclusive times for the combat entry points, kept when
+ * fight.c is built with -DCOMBAT_PROFILE (the combatbench target). */
+#define COMBAT_PROFILE_VIOLENCE  0
+#define COMBAT_PROFILE_HIT       1
+#define COMBAT_PROFILE_DAMAGE    2
+#define NUM_COMBAT_PROFILES      3
+
+struct combat_profile {
+  const char *name;
+  long calls;
+  double secs;     /* time spent inside, outermost calls only */
+  int depth;
+  double started;
+};
+
+extern struct combat_profile combat_profiles[NUM_COMBAT_PROFILES];
+#endif
+
 /* Global variables */
 #ifndef __FIGHT_C__
 extern struct attack_hit_type attack_hit_text[];
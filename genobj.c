@@ -75,6 +75,11 @@ static int update_all_objects(struct obj_data *refobj)
     obj->next_content = swap.next_content;
     obj->next = swap.next;
     obj->sitting_here = swap.sitting_here;
+    obj->script = swap.script;
+
+    /* The feats it grants may have changed. */
+    if (obj->worn_by)
+      gear_feats_changed(obj->worn_by);
   }
 
   return count;
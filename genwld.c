@@ -426,11 +426,13 @@ int copy_room(struct room_data *to, struct room_data *from)
   *to = *from;
   copy_room_strings(to, from);
   to->events = from->events;
+  to->events_by_id = from->events_by_id;
   
   /* Don't put people and objects in two locations. Should this be done here? */
   from->people = NULL;
   from->contents = NULL;
   from->events = NULL;
+  from->events_by_id = NULL;
   
   return TRUE;
 }
@@ -207,6 +207,9 @@ zone_rnum create_new_zone(zone_vnum vzone_num, room_vnum bottom, room_vnum top,
   zone->min_level = -1;
   zone->max_level = -1;
   zone->show_weather = 1;
+  zone->num_players = 0;
+  zone->empty_since = 0;
+  zone->dormant = FALSE;
 
   for (i = 0; i < ZN_ARRAY_MAX; i++) zone->zone_flags[i] = 0;
 
@@ -814,7 +814,11 @@ void update_msdp_affects(struct char_data *ch) {
  * restoring original abilities, and then affecting all again. */
 void affect_total(struct char_data *ch) {
   int at_armor = 100;
- 
+
+  /* worn gear, or an affect, may have been changed in place */
+  gear_feats_changed(ch);
+  affects_changed(ch);
+
   /* cleanup for disguise system */
   cleanup_disguise(ch);
 
@@ -844,6 +848,7 @@ void affect_to_char(struct char_data *ch, struct affected_type *af) {
   *affected_alloc = *af;
   affected_alloc->next = ch->affected;
   ch->affected = affected_alloc;
+  affects_changed(ch);
 
   /*affect_modify_ar(ch, af->location, af->modifier, af->bitvector, TRUE);*/
   affect_modify_ar(ch, af->location, 0, af->bitvector, TRUE);
@@ -901,6 +906,7 @@ void affect_remove(struct char_data *ch, struct affected_type *af) {
   }
   
   REMOVE_FROM_LIST(af, ch->affected, next);
+  affects_changed(ch);
 
   free_affect(af);
 
@@ -933,11 +939,62 @@ void affect_from_char(struct char_data *ch, int spell) {
   }
 }
 
+/* Walks ch->affected once and fills in snap. */
+static void build_affect_snapshot(struct char_data *ch, struct affect_snapshot *snap) {
+  struct affected_type *af;
+
+  memset(snap, 0, sizeof (*snap));
+
+  for (af = ch->affected; af; af = af->next) {
+    if (af->location == APPLY_AC_NEW) {
+      snap->ac_bonuses[af->bonus_type] += af->modifier;
+      snap->ac_applied += af->modifier * 10;
+    }
+    if (af->location == APPLY_AC) {
+      snap->ac_bonuses[af->bonus_type] += af->modifier / 10;
+      snap->ac_applied += af->modifier;
+    }
+    if (af->spell >= 0 && af->spell < AFF_SNAPSHOT_SPELLS)
+      snap->spells[af->spell / 8] |= (1 << (af->spell % 8));
+  }
+
+  snap->valid = TRUE;
+}
+
+/* Call whenever ch->affected gains or loses an entry, or one is changed in
+ * place, so the snapshot is rebuilt. */
+void affects_changed(struct char_data *ch) {
+  ch->aff_snapshot.valid = FALSE;
+}
+
+/* The sums compute_armor_class() and affected_by_spell() need from the
+ * affected list, walked once per change instead of once per call.  Build
+ * with -DCHECK_AFFECT_SNAPSHOT to have each use checked against a fresh walk. */
+const struct affect_snapshot *get_affect_snapshot(struct char_data *ch) {
+#ifdef CHECK_AFFECT_SNAPSHOT
+  struct affect_snapshot fresh;
+
+  if (ch->aff_snapshot.valid) {
+    build_affect_snapshot(ch, &fresh);
+    if (memcmp(&fresh, &ch->aff_snapshot, sizeof (fresh)))
+      log("SYSERR: stale affect snapshot for %s.", GET_NAME(ch));
+  }
+#endif
+
+  if (!ch->aff_snapshot.valid)
+    build_affect_snapshot(ch, &ch->aff_snapshot);
+
+  return (&ch->aff_snapshot);
+}
+
 /* Return TRUE if a char is affected by a spell (SPELL_XXX), FALSE indicates
  * not affected. */
 bool affected_by_spell(struct char_data *ch, int type) {
   struct affected_type *hjp;
 
+  if (type >= 0 && type < AFF_SNAPSHOT_SPELLS)
+    return ((get_affect_snapshot(ch)->spells[type / 8] & (1 << (type % 8))) != 0);
+
   for (hjp = ch->affected; hjp; hjp = hjp->next)
     if (hjp->spell == type)
       return (TRUE);
@@ -1072,6 +1129,7 @@ void char_from_room(struct char_data *ch) {
   check_room_lighting(IN_ROOM(ch), ch, FALSE);
 
   REMOVE_FROM_LIST(ch, world[IN_ROOM(ch)].people, next_in_room);
+  zone_remove_occupant(ch, IN_ROOM(ch));
   IN_ROOM(ch) = NOWHERE;
   ch->next_in_room = NULL;
 }
@@ -1130,10 +1188,7 @@ void char_to_room(struct char_data *ch, room_rnum room) {
 
       if (real_room(world[room].number) != NOWHERE &&  IS_DYNAMIC(room) ) {
         //log("Setting occupied bit to room: %d", room); /* spams syslogs */
-        SET_BIT_AR(ROOM_FLAGS(room), ROOM_OCCUPIED);
-        /* Create the event to clear the flag, if it is not already set. */
-        if(!room_has_mud_event(&world[room], eCHECK_OCCUPIED))
-          NEW_EVENT(eCHECK_OCCUPIED, &world[room].number, NULL, 10 RL_SEC);
+        occupy_wilderness_room(room);
       } else {
       }
     }
@@ -1141,6 +1196,7 @@ void char_to_room(struct char_data *ch, room_rnum room) {
     ch->next_in_room = world[room].people;
     world[room].people = ch;
     IN_ROOM(ch) = room;
+    zone_add_occupant(ch, room);
 
 
     autoquest_trigger_check(ch, 0, 0, AQ_ROOM_FIND);
@@ -1158,7 +1214,7 @@ void char_to_room(struct char_data *ch, room_rnum room) {
     /* falling */
     if (char_should_fall(ch, FALSE) && !char_has_mud_event(ch, eFALLING)) {
       /* the svariable value of 20 is just a rough number for feet */
-      attach_mud_event(new_mud_event(eFALLING, ch, "20"), 5);
+      attach_mud_event(new_mud_event_num(eFALLING, ch, 20), 5);
       send_to_char(ch, "Suddenly your realize you are falling!\r\n");
       act("$n has just realized $e has no visible means of support!",
               FALSE, ch, 0, 0, TO_ROOM);
@@ -1356,6 +1412,7 @@ void equip_char(struct char_data *ch, struct obj_data *obj, int pos) {
   GET_EQ(ch, pos) = obj;
   obj->worn_by = ch;
   obj->worn_on = pos;
+  gear_feats_changed(ch);
 
   /* Object special abilities, process for ACTMTD_WEAR */
   process_item_abilities(obj, ch, NULL, ACTMTD_WEAR, NULL);
@@ -1422,6 +1479,7 @@ struct obj_data *unequip_char(struct char_data *ch, int pos) {
     log("SYSERR: IN_ROOM(ch) = NOWHERE when unequipping char %s.", GET_NAME(ch));
 
   GET_EQ(ch, pos) = NULL;
+  gear_feats_changed(ch);
 
   for (j = 0; j < MAX_OBJ_AFFECT; j++) {
     /* Here is where we need to see if these affects ACTUALLY apply,
@@ -1683,6 +1741,9 @@ void extract_obj(struct obj_data *obj) {
     }
     free_list(obj->events);
     obj->events = NULL;
+    if (obj->events_by_id)
+      free(obj->events_by_id);
+    obj->events_by_id = NULL;
   }
 
   if (GET_OBJ_RNUM(obj) == NOTHING || obj->proto_script != obj_proto[GET_OBJ_RNUM(obj)].proto_script)
@@ -23,6 +23,8 @@ void	affect_remove(struct char_data *ch, struct affected_type *af);
 void	affect_from_char(struct char_data *ch, int type);
 void affect_type_from_char(struct char_data *ch, int type);
 bool	affected_by_spell(struct char_data *ch, int type);
+void affects_changed(struct char_data *ch);
+const struct affect_snapshot *get_affect_snapshot(struct char_data *ch);
 void	affect_join(struct char_data *ch, struct affected_type *af,
         bool add_dur, bool avg_dur, bool add_mod, bool avg_mod);
 void	affect_modify_ar(struct char_data * ch, byte loc, sbyte mod, int bitv[],
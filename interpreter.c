@@ -66,6 +66,9 @@ static int _parse_name(char *arg, char *name);
 static bool perform_new_char_dupe_check(struct descriptor_data *d);
 /* sort_commands utility */
 static int sort_commands_helper(const void *a, const void *b);
+#ifdef CHECK_COMMAND_INDEX
+static void check_command_index(void);
+#endif
 
 /* globals defined here, used here and elsewhere */
 int *cmd_sort_info = NULL;
@@ -748,11 +751,222 @@ void sort_commands(void) {
   qsort(cmd_sort_info + 1, num_of_cmds - 2, sizeof (int), sort_commands_helper);
 }
 
+/* The command abbreviation index.  Every prefix of every command name, the
+ * empty one included, is listed with the commands it could stand for in
+ * complete_cmd_info order, so the first of those the character has the level
+ * for is the command the old scan down complete_cmd_info would have found.
+ * Levels are read from complete_cmd_info at lookup time, so do_cmdlev needs
+ * no rebuild.  Socials get an index of their own because they are only tried
+ * when no real command matches. */
+struct cmd_abbrev {
+  char *abbrev;
+  int *cmds;      /* in complete_cmd_info order */
+  int num_cmds;
+};
+
+struct cmd_index {
+  struct cmd_abbrev *abbrevs; /* sorted by abbrev */
+  int num_abbrevs;
+};
+
+#define CMD_INDEX_COMMANDS  0
+#define CMD_INDEX_SOCIALS   1
+
+static struct cmd_index cmd_index[2];
+/* Index of the "\n" entry ending complete_cmd_info. */
+static int cmd_index_end = 0;
+
+/* One (command, prefix length) pair while the index is being built. */
+struct cmd_prefix {
+  int cmd;
+  int len;
+};
+
+static int cmd_prefix_cmp(const void *a, const void *b) {
+  const struct cmd_prefix *pa = (const struct cmd_prefix *) a;
+  const struct cmd_prefix *pb = (const struct cmd_prefix *) b;
+  const char *na = complete_cmd_info[pa->cmd].command;
+  const char *nb = complete_cmd_info[pb->cmd].command;
+  int i, len = (pa->len < pb->len ? pa->len : pb->len);
+
+  for (i = 0; i < len; i++)
+    if (na[i] != nb[i])
+      return ((unsigned char) na[i] - (unsigned char) nb[i]);
+
+  if (pa->len != pb->len)
+    return (pa->len - pb->len);
+
+  return (pa->cmd - pb->cmd);
+}
+
+static void free_cmd_index(struct cmd_index *idx) {
+  int i;
+
+  for (i = 0; i < idx->num_abbrevs; i++) {
+    free(idx->abbrevs[i].abbrev);
+    free(idx->abbrevs[i].cmds);
+  }
+  if (idx->abbrevs)
+    free(idx->abbrevs);
+  idx->abbrevs = NULL;
+  idx->num_abbrevs = 0;
+}
+
+static void build_cmd_index(struct cmd_index *idx, bool socials) {
+  struct cmd_prefix *prefixes;
+  struct cmd_abbrev *ab;
+  int cmd, len, num = 0, i, j;
+
+  free_cmd_index(idx);
+
+  for (cmd = 0; cmd < cmd_index_end; cmd++)
+    if ((complete_cmd_info[cmd].command_pointer == do_action) == socials)
+      num += strlen(complete_cmd_info[cmd].command) + 1;
+
+  if (!num)
+    return;
+
+  CREATE(prefixes, struct cmd_prefix, num);
+  for (num = 0, cmd = 0; cmd < cmd_index_end; cmd++) {
+    if ((complete_cmd_info[cmd].command_pointer == do_action) != socials)
+      continue;
+    for (len = strlen(complete_cmd_info[cmd].command); len >= 0; len--) {
+      prefixes[num].cmd = cmd;
+      prefixes[num++].len = len;
+    }
+  }
+
+  qsort(prefixes, num, sizeof (struct cmd_prefix), cmd_prefix_cmp);
+
+  /* Equal prefixes are now together, ordered by command number. */
+  CREATE(idx->abbrevs, struct cmd_abbrev, num);
+  for (i = 0; i < num; i = j) {
+    for (j = i + 1; j < num && prefixes[j].len == prefixes[i].len &&
+            !strncmp(complete_cmd_info[prefixes[j].cmd].command,
+            complete_cmd_info[prefixes[i].cmd].command, prefixes[i].len); j++)
+      ;
+
+    ab = &idx->abbrevs[idx->num_abbrevs++];
+    CREATE(ab->abbrev, char, prefixes[i].len + 1);
+    strncpy(ab->abbrev, complete_cmd_info[prefixes[i].cmd].command, prefixes[i].len);
+    ab->abbrev[prefixes[i].len] = '\0';
+    CREATE(ab->cmds, int, j - i);
+    for (ab->num_cmds = 0; ab->num_cmds < j - i; ab->num_cmds++)
+      ab->cmds[ab->num_cmds] = prefixes[i + ab->num_cmds].cmd;
+  }
+  RECREATE(idx->abbrevs, struct cmd_abbrev, idx->num_abbrevs);
+
+  free(prefixes);
+}
+
+/* Called whenever complete_cmd_info is rebuilt. */
+void build_command_index(void) {
+  for (cmd_index_end = 0; *complete_cmd_info[cmd_index_end].command != '\n'; cmd_index_end++)
+    ;
+
+  build_cmd_index(&cmd_index[CMD_INDEX_COMMANDS], FALSE);
+  build_cmd_index(&cmd_index[CMD_INDEX_SOCIALS], TRUE);
+
+#ifdef CHECK_COMMAND_INDEX
+  check_command_index();
+#endif
+}
+
+void free_command_index(void) {
+  free_cmd_index(&cmd_index[CMD_INDEX_COMMANDS]);
+  free_cmd_index(&cmd_index[CMD_INDEX_SOCIALS]);
+  cmd_index_end = 0;
+}
+
+static struct cmd_abbrev *find_cmd_abbrev(struct cmd_index *idx, const char *arg) {
+  int bot = 0, top = idx->num_abbrevs - 1, mid, cmp;
+
+  while (bot <= top) {
+    mid = (bot + top) / 2;
+    if (!(cmp = strcmp(arg, idx->abbrevs[mid].abbrev)))
+      return (&idx->abbrevs[mid]);
+    if (cmp < 0)
+      top = mid - 1;
+    else
+      bot = mid + 1;
+  }
+
+  return (NULL);
+}
+
+/* Returns the first command (or social) that arg abbreviates and that a
+ * character of the given level may use, or the index of the "\n" entry. */
+static int lookup_command(const char *arg, int level, bool socials) {
+  struct cmd_abbrev *ab;
+  int i;
+
+  ab = find_cmd_abbrev(&cmd_index[socials ? CMD_INDEX_SOCIALS : CMD_INDEX_COMMANDS], arg);
+  for (i = 0; ab && i < ab->num_cmds; i++)
+    if (level >= complete_cmd_info[ab->cmds[i]].minimum_level)
+      return (ab->cmds[i]);
+
+  return (cmd_index_end);
+}
+
+/* Build with -DCHECK_COMMAND_INDEX to have every rebuild of the index checked
+ * against the scan command_interpreter() used to do. */
+#ifdef CHECK_COMMAND_INDEX
+/* The scan command_interpreter() did before there was an index. */
+static int linear_lookup_command(const char *arg, int level, bool socials) {
+  int cmd, length = strlen(arg);
+
+  for (cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
+    if ((complete_cmd_info[cmd].command_pointer == do_action) == socials &&
+            !strncmp(complete_cmd_info[cmd].command, arg, length))
+      if (level >= complete_cmd_info[cmd].minimum_level)
+        break;
+
+  return (cmd);
+}
+
+/* Resolves every prefix of every command name, and every prefix with one
+ * letter too many, at every level that makes a difference, both ways. */
+static void check_command_index(void) {
+  char arg[MAX_INPUT_LENGTH];
+  int cmd, len, name_len, level, min_level = 0, max_level = 0, checked = 0, bad = 0;
+  bool socials;
+
+  for (cmd = 0; cmd < cmd_index_end; cmd++) {
+    if (complete_cmd_info[cmd].minimum_level < min_level)
+      min_level = complete_cmd_info[cmd].minimum_level;
+    if (complete_cmd_info[cmd].minimum_level > max_level)
+      max_level = complete_cmd_info[cmd].minimum_level;
+  }
+
+  for (cmd = 0; cmd < cmd_index_end; cmd++) {
+    name_len = strlen(complete_cmd_info[cmd].command);
+    if (name_len >= MAX_INPUT_LENGTH - 1)
+      continue;
+    for (len = 0; len <= name_len + 1; len++) {
+      strncpy(arg, complete_cmd_info[cmd].command, len);
+      arg[len] = '\0';
+      if (len > name_len)
+        arg[name_len] = 'z';
+      for (socials = FALSE; socials <= TRUE; socials++)
+        for (level = min_level - 1; level <= max_level + 1; level++, checked++)
+          if (lookup_command(arg, level, socials) != linear_lookup_command(arg, level, socials)) {
+            if (bad++ < 20)
+              log("SYSERR: command index resolves '%s' at level %d to %d, the list to %d.",
+                      arg, level, lookup_command(arg, level, socials),
+                      linear_lookup_command(arg, level, socials));
+          }
+    }
+  }
+
+  log("Command index checked: %d lookups, %d mismatches.", checked, bad);
+}
+#endif
+
 /* This is the actual command interpreter called from game_loop() in comm.c
  * It makes sure you are the proper level and position to execute the command,
  * then calls the appropriate function. */
 void command_interpreter(struct char_data *ch, char *argument) {
-  int cmd = 0, length = 0;
+  int cmd = 0;
   char *line = NULL;
   char arg[MAX_INPUT_LENGTH] = {'\0'};
 
@@ -811,20 +1025,12 @@ void command_interpreter(struct char_data *ch, char *argument) {
       return;
   }
 
-  for (length = strlen(arg), cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
-    if (complete_cmd_info[cmd].command_pointer != do_action &&
-            !strncmp(complete_cmd_info[cmd].command, arg, length))
-      if (GET_LEVEL(ch) >= complete_cmd_info[cmd].minimum_level)
-        break;
+  cmd = lookup_command(arg, GET_LEVEL(ch), FALSE);
 
   /* it's not a 'real' command, so it's a social */
 
   if (*complete_cmd_info[cmd].command == '\n')
-    for (length = strlen(arg), cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
-      if (complete_cmd_info[cmd].command_pointer == do_action &&
-              !strncmp(complete_cmd_info[cmd].command, arg, length))
-        if (GET_LEVEL(ch) >= complete_cmd_info[cmd].minimum_level)
-          break;
+    cmd = lookup_command(arg, GET_LEVEL(ch), TRUE);
 
   if (*complete_cmd_info[cmd].command == '\n') {
     int found = 0;
@@ -1343,13 +1549,22 @@ void half_chop(char *string, char *arg1, char *arg2) {
 
 /* Used in specprocs, mostly.  (Exactly) matches "command" to cmd number */
 int find_command(const char *command) {
-  int cmd;
+  struct cmd_abbrev *ab;
+  int i, j, cmd = -1;
 
-  for (cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
-    if (!strcmp(complete_cmd_info[cmd].command, command))
-      return (cmd);
+  /* A full name is an abbreviation of itself, so look there for it. */
+  for (i = CMD_INDEX_COMMANDS; i <= CMD_INDEX_SOCIALS; i++) {
+    if (!(ab = find_cmd_abbrev(&cmd_index[i], command)))
+      continue;
+    for (j = 0; j < ab->num_cmds; j++)
+      if (!strcmp(complete_cmd_info[ab->cmds[j]].command, command)) {
+        if (cmd < 0 || ab->cmds[j] < cmd)
+          cmd = ab->cmds[j];
+        break;
+      }
+  }
 
-  return (-1);
+  return (cmd);
 }
 
 int special(struct char_data *ch, int cmd, char *arg) {
@@ -1440,8 +1655,11 @@ static int perform_dupe_check(struct descriptor_data *d) {
         target = k->original;
         mode = UNSWITCH;
       }
-      if (k->character)
+      if (k->character) {
+        /* The switched mobile stops counting as a player in its zone. */
         k->character->desc = NULL;
+        zone_occupant_changed(k->character);
+      }
       k->character = NULL;
       k->original = NULL;
     } else if (k->character && GET_IDNUM(k->character) == id && k->original) {
@@ -1458,6 +1676,7 @@ static int perform_dupe_check(struct descriptor_data *d) {
         mode = USURP;
       }
       k->character->desc = NULL;
+      zone_occupant_changed(k->character);
       k->character = NULL;
       k->original = NULL;
       write_to_output(k, "\r\nMultiple login detected -- disconnecting.\r\n");
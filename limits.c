@@ -217,7 +217,7 @@ void hazard_tick(struct char_data *ch) {
   /* falling */
   if (char_should_fall(ch, TRUE) && !char_has_mud_event(ch, eFALLING)) {
     /* the svariable value of 20 is just a rough number for feet */
-    attach_mud_event(new_mud_event(eFALLING, ch, "20"), 5);
+    attach_mud_event(new_mud_event_num(eFALLING, ch, 20), 5);
     send_to_char(ch, "Suddenly your realize you are falling!\r\n");
     act("$n has just realized $e has no visible means of support!",
             FALSE, ch, 0, 0, TO_ROOM);
@@ -252,10 +252,18 @@ void pulse_luminari() {
   struct char_data *i = NULL;
   struct raff_node *raff = NULL, *next_raff = NULL;
 
+  dormancy_pulse_start(DORMANCY_LUMINARI);
+
   // room-affections, loop through em
   for (raff = raff_list; raff; raff = next_raff) {
     next_raff = raff->next;
 
+    if (ROOM_DORMANT(raff->room)) {
+      DORMANCY_SKIPPED(DORMANCY_LUMINARI);
+      continue;
+    }
+    DORMANCY_PROCESSED(DORMANCY_LUMINARI);
+
     /* will check a room it has room affection to fire */
     room_aff_tick(raff);
   }
@@ -263,6 +271,13 @@ void pulse_luminari() {
   // looping through char list, what needs to be done?
   for (i = character_list; i; i = i->next) {
 
+    /* nothing happens in a dormant zone */
+    if (ROOM_DORMANT(IN_ROOM(i))) {
+      DORMANCY_SKIPPED(DORMANCY_LUMINARI);
+      continue;
+    }
+    DORMANCY_PROCESSED(DORMANCY_LUMINARI);
+
     /* dummy check + added for falling event */
     if (death_check(i))
       continue; // i is dead
@@ -75,13 +75,13 @@ struct iterator_data *create_iterator(void)
 /* end struct inits */
 
 void free_list(struct list_data *pList) {
-  void *pContent = NULL;
-
   simple_list(NULL);
 
+  /* Always take the first item: stepping an iterator on from an item that
+   * remove_from_list() has just freed reads freed memory. */
   if (pList && pList->iSize)
-    while ((pContent = simple_list(pList)))
-      remove_from_list(pContent, pList);
+    while (pList->pFirstItem)
+      remove_from_list(pList->pFirstItem->pContent, pList);
 
   if (pList && pList->iSize > 0)
     mudlog(CMP, LVL_STAFF, TRUE, "List being freed while not empty.");
@@ -390,46 +390,83 @@ void rem_room_aff(struct raff_node *raff) {
   free(raff);
 }
 
+/* How many times affect_update() has run.  A character or room affection
+ * in a dormant zone is skipped, and catches up on the rounds it missed the
+ * next time it is updated. */
+long affect_rounds = 0;
+
+/* Counts down the affects on a character by the given number of rounds,
+ * removing those that wear off. */
+static void update_char_affects(struct char_data *i, long rounds) {
+  struct affected_type *af, *next;
+
+  for (af = i->affected; af; af = next) { /* loop his/her aff list */
+    next = af->next;
+    if (af->duration == -1) /* unlimited duration */
+      ;
+    else if (af->duration >= rounds) /* still going, decrement */
+      af->duration -= rounds;
+    else { /* affect wore off! */
+      /* handle spells/skills (use to just handle spells) */
+      if ((af->spell > 0) && (af->spell <= MAX_SKILLS)) { /*valid spellnum?*/
+        /* this is our check to avoid duplicate wear-off messages */
+        if (!af->next || (af->next->spell != af->spell) ||
+                (af->next->duration > 0)) {
+          /* do we have a built-in spell wear-off message? */
+          if (spell_info[af->spell].wear_off_msg) {
+            send_to_char(i, "%s\r\n", spell_info[af->spell].wear_off_msg);
+          } else { /* check for alternative message! */
+            alt_wear_off_msg(i, af->spell);
+          }
+        }
+      }
+      /* handle special cases (like morph) */
+      spec_wear_off(i, af->spell);
+      /* ok, finally remove affect */
+      affect_remove(i, af);
+    }
+  }
+  update_msdp_affects(i);
+}
+
 /* affect_update: called from comm.c (causes spells to wear off) */
 void affect_update(void) {
-  struct affected_type *af, *next;
   struct char_data *i;
   struct raff_node *raff, *next_raff;
+  long rounds;
+
+  affect_rounds++;
+  dormancy_pulse_start(DORMANCY_AFFECT);
 
   for (i = character_list; i; i = i->next) { /* go through everything */
-    for (af = i->affected; af; af = next) { /* loop his/her aff list */
-      next = af->next;
-      if (af->duration >= 1) /* duration > 0, decrement */
-        af->duration--;
-      else if (af->duration == -1) /* unlimited duration */
-        ;
-      else { /* affect wore off! */
-        /* handle spells/skills (use to just handle spells) */
-        if ((af->spell > 0) && (af->spell <= MAX_SKILLS)) { /*valid spellnum?*/
-          /* this is our check to avoid duplicate wear-off messages */
-          if (!af->next || (af->next->spell != af->spell) ||
-                  (af->next->duration > 0)) {
-            /* do we have a built-in spell wear-off message? */
-            if (spell_info[af->spell].wear_off_msg) {
-              send_to_char(i, "%s\r\n", spell_info[af->spell].wear_off_msg);
-            } else { /* check for alternative message! */
-              alt_wear_off_msg(i, af->spell);
-            }
-          }
-        }
-        /* handle special cases (like morph) */
-        spec_wear_off(i, af->spell);
-        /* ok, finally remove affect */
-        affect_remove(i, af);
-      }
+    if (ROOM_DORMANT(IN_ROOM(i))) {
+      if (!i->affect_round)
+        i->affect_round = affect_rounds - 1;
+      DORMANCY_SKIPPED(DORMANCY_AFFECT);
+      continue;
     }
-    update_msdp_affects(i);
+    DORMANCY_PROCESSED(DORMANCY_AFFECT);
+
+    rounds = (i->affect_round ? affect_rounds - i->affect_round : 1);
+    i->affect_round = affect_rounds;
+    update_char_affects(i, rounds);
   }
 
   /* update the room affections */
   for (raff = raff_list; raff; raff = next_raff) {
     next_raff = raff->next;
-    raff->timer--;
+
+    if (ROOM_DORMANT(raff->room)) {
+      if (!raff->round)
+        raff->round = affect_rounds - 1;
+      DORMANCY_SKIPPED(DORMANCY_AFFECT);
+      continue;
+    }
+    DORMANCY_PROCESSED(DORMANCY_AFFECT);
+
+    rounds = (raff->round ? affect_rounds - raff->round : 1);
+    raff->round = affect_rounds;
+    raff->timer -= rounds;
 
     if (raff->timer <= 0)
       rem_room_aff(raff);
@@ -1119,6 +1119,8 @@ void mobile_activity(void) {
   struct obj_data *obj = NULL, *best_obj = NULL;
   int door = 0, found = FALSE, max = 0, where = -1;
 
+  dormancy_pulse_start(DORMANCY_MOBILE);
+
   for (ch = character_list; ch; ch = next_ch) {
     next_ch = ch->next;
 
@@ -1128,6 +1130,13 @@ void mobile_activity(void) {
     if (!IS_MOB(ch))
       continue;
 
+    /* nobody around to see it */
+    if (ZONE_DORMANT(world[IN_ROOM(ch)].zone)) {
+      DORMANCY_SKIPPED(DORMANCY_MOBILE);
+      continue;
+    }
+    DORMANCY_PROCESSED(DORMANCY_MOBILE);
+
     if (AFF_FLAGGED(ch, AFF_STUN) || AFF_FLAGGED(ch, AFF_PARALYZED) || AFF_FLAGGED(ch, AFF_DAZED) ||
             char_has_mud_event(ch, eSTUNNED) || AFF_FLAGGED(ch, AFF_NAUSEATED)) {
       send_to_char(ch, "You are unable to move!\r\n");
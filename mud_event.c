@@ -78,7 +78,7 @@ struct mud_event_list mud_event_index[] = {
   { "Tracks", event_tracks, EVENT_ROOM}, /* eTRACKS */
   { "Wild Shape", event_daily_use_cooldown, EVENT_CHAR}, /* eWILD_SHAPE */
   { "Shield Recovery", event_countdown, EVENT_CHAR}, /* eSHIELD_RECOVERY */
-  { "Combat Round", event_combat_round, EVENT_CHAR}, /* eCOMBAT_ROUND */
+  { "Combat Round", event_countdown, EVENT_CHAR}, /* eCOMBAT_ROUND, unused: see combat_round_update() */
   { "Standard Action Cooldown", event_action_cooldown, EVENT_CHAR}, /* eSTANDARDACTION */
   { "Move Action Cooldown", event_action_cooldown, EVENT_CHAR}, /* eMOVEACTION */
   { "Wholeness of Body", event_countdown, EVENT_CHAR}, // eWHOLENESSOFBODY
@@ -462,7 +462,6 @@ EVENTFUNC(event_daily_use_cooldown) {
   int uses = 0;
   int nonfeat_daily_uses = 0;
   int featnum = 0;
-  char buf[128];
 
   pMudEvent = (struct mud_event_data *) event_obj;
 
@@ -483,15 +482,12 @@ EVENTFUNC(event_daily_use_cooldown) {
       return 0;
   }
 
-  if (pMudEvent->sVariables == NULL) {
+  /* The number of uses on cooldown is the event's number. */
+  if ((uses = mud_event_num(pMudEvent, -1)) < 0) {
     /* This is odd - This field should always be populated for daily-use abilities,
      * maybe some legacy code or bad id. */
-    log("SYSERR: sVariables field is NULL for daily-use-cooldown-event: %d", pMudEvent->iId);
-  } else {
-    if (sscanf(pMudEvent->sVariables, "uses:%d", &uses) != 1) {
-      log("SYSERR: In event_daily_use_cooldown, bad sVariables for daily-use-cooldown-event: %d", pMudEvent->iId);
-      uses = 0;
-    }
+    log("SYSERR: No uses set for daily-use-cooldown-event: %d", pMudEvent->iId);
+    uses = 0;
   }
 
   switch (pMudEvent->iId) {
@@ -676,11 +672,7 @@ EVENTFUNC(event_daily_use_cooldown) {
 
   uses -= 1;
   if (uses > 0) {
-    if (pMudEvent->sVariables != NULL)
-      free(pMudEvent->sVariables);
-
-    sprintf(buf, "uses:%d", uses);
-    pMudEvent->sVariables = strdup(buf);
+    mud_event_set_num(pMudEvent, uses);
 
     if ((featnum == FEAT_UNDEFINED) && (nonfeat_daily_uses > 0)) {
       /* 
@@ -697,6 +689,43 @@ EVENTFUNC(event_daily_use_cooldown) {
   return cooldown;
 }
 
+/* Every owner with an events list also has an events_by_id table, holding for
+ * each event_id that owner's events with that id, oldest first and chained
+ * through next_same_id.  The table comes and goes with the events list, so
+ * looking up or cancelling a specific event never has to walk the list. */
+static void index_mud_event(struct mud_event_data ***table, struct mud_event_data *pMudEvent) {
+  struct mud_event_data **tail = NULL;
+
+  if (*table == NULL)
+    CREATE(*table, struct mud_event_data *, NUM_MUD_EVENTS);
+
+  for (tail = &(*table)[pMudEvent->iId]; *tail; tail = &(*tail)->next_same_id)
+    ;
+
+  pMudEvent->next_same_id = NULL;
+  *tail = pMudEvent;
+}
+
+static void unindex_mud_event(struct mud_event_data ***table, struct mud_event_data *pMudEvent, struct list_data *events) {
+  struct mud_event_data **prev = NULL;
+
+  if (*table == NULL)
+    return;
+
+  for (prev = &(*table)[pMudEvent->iId]; *prev; prev = &(*prev)->next_same_id) {
+    if (*prev == pMudEvent) {
+      *prev = pMudEvent->next_same_id;
+      break;
+    }
+  }
+
+  /* The list has just been freed, so go with it. */
+  if (events == NULL) {
+    free(*table);
+    *table = NULL;
+  }
+}
+
 /* As of 3.63, there are only global, descriptor, and character events. This
  * is due to the potential scope of the necessary debugging if events were
  * included with rooms, objects, spells or any other structure type. Adding
@@ -737,6 +766,7 @@ void attach_mud_event(struct mud_event_data *pMudEvent, long time) {
         ch->events = create_list();
 
       add_to_list(pEvent, ch->events);
+      index_mud_event(&ch->events_by_id, pMudEvent);
       break;
     case EVENT_OBJECT:
       obj = (struct obj_data *) pMudEvent->pStruct;
@@ -745,6 +775,7 @@ void attach_mud_event(struct mud_event_data *pMudEvent, long time) {
         obj->events = create_list();
 
       add_to_list(pEvent, obj->events);
+      index_mud_event(&obj->events_by_id, pMudEvent);
       break;
     case EVENT_ROOM:
 
@@ -759,6 +790,7 @@ void attach_mud_event(struct mud_event_data *pMudEvent, long time) {
         room->events = create_list();
 
       add_to_list(pEvent, room->events);
+      index_mud_event(&room->events_by_id, pMudEvent);
       break;
     case EVENT_REGION:
       CREATE(regvnum, region_vnum, 1);
@@ -779,6 +811,7 @@ void attach_mud_event(struct mud_event_data *pMudEvent, long time) {
         region->events = create_list();
 
       add_to_list(pEvent, region->events);
+      index_mud_event(&region->events_by_id, pMudEvent);
       break;
   }
 }
@@ -798,6 +831,55 @@ struct mud_event_data *new_mud_event(event_id iId, void *pStruct, char *sVariabl
   return (pMudEvent);
 }
 
+/* Like new_mud_event(), but the event carries a number in iVar instead of a
+ * string in sVariables. */
+struct mud_event_data *new_mud_event_num(event_id iId, void *pStruct, long num) {
+  struct mud_event_data *pMudEvent = new_mud_event(iId, pStruct, NULL);
+
+  pMudEvent->iVarType = MUD_EVENT_VAR_NUM;
+  pMudEvent->iVar = num;
+
+  return (pMudEvent);
+}
+
+bool mud_event_has_num(struct mud_event_data *pMudEvent) {
+  return (pMudEvent->iVarType == MUD_EVENT_VAR_NUM);
+}
+
+/* Returns the number an event carries, or def if it has none.  An event made
+ * with a numeric sVariables string (or the "uses:N" form the daily-use
+ * cooldowns used to have) is still read, so older callers keep working. */
+long mud_event_num(struct mud_event_data *pMudEvent, long def) {
+  const char *p;
+  char *end;
+  long num;
+
+  if (pMudEvent->iVarType == MUD_EVENT_VAR_NUM)
+    return pMudEvent->iVar;
+
+  if (pMudEvent->sVariables == NULL)
+    return def;
+
+  if ((p = strchr(pMudEvent->sVariables, ':')) == NULL)
+    p = pMudEvent->sVariables;
+  else
+    p++;
+
+  num = strtol(p, &end, 10);
+
+  return (end == p ? def : num);
+}
+
+void mud_event_set_num(struct mud_event_data *pMudEvent, long num) {
+  if (pMudEvent->sVariables != NULL) {
+    free(pMudEvent->sVariables);
+    pMudEvent->sVariables = NULL;
+  }
+
+  pMudEvent->iVarType = MUD_EVENT_VAR_NUM;
+  pMudEvent->iVar = num;
+}
+
 void free_mud_event(struct mud_event_data *pMudEvent) {
   struct descriptor_data *d = NULL;
   struct char_data *ch = NULL;
@@ -824,6 +906,7 @@ void free_mud_event(struct mud_event_data *pMudEvent) {
         free_list(ch->events);
         ch->events = NULL;
       }
+      unindex_mud_event(&ch->events_by_id, pMudEvent, ch->events);
       break;
     case EVENT_OBJECT:
       obj = (struct obj_data *) pMudEvent->pStruct;
@@ -833,6 +916,7 @@ void free_mud_event(struct mud_event_data *pMudEvent) {
         free_list(obj->events);
         obj->events = NULL;
       }
+      unindex_mud_event(&obj->events_by_id, pMudEvent, obj->events);
       break;
     case EVENT_ROOM:
       /* Due to OLC changes, if rooms were deleted then the room we have in the event might be
@@ -853,6 +937,7 @@ void free_mud_event(struct mud_event_data *pMudEvent) {
         free_list(room->events);
         room->events = NULL;
       }
+      unindex_mud_event(&room->events_by_id, pMudEvent, room->events);
       break;
     case EVENT_REGION:
       regvnum = (region_vnum *) pMudEvent->pStruct;
@@ -867,6 +952,7 @@ void free_mud_event(struct mud_event_data *pMudEvent) {
         free_list(region->events);
         region->events = NULL;
       }
+      unindex_mud_event(&region->events_by_id, pMudEvent, region->events);
       break;
   }
 
@@ -878,208 +964,45 @@ void free_mud_event(struct mud_event_data *pMudEvent) {
 }
 
 struct mud_event_data * char_has_mud_event(struct char_data * ch, event_id iId) {
-  struct event * pEvent = NULL;
-  struct mud_event_data * pMudEvent = NULL;
-  bool found = FALSE;
-  struct iterator_data it;
-
-  if (ch->events == NULL)
+  if (ch->events == NULL || ch->events_by_id == NULL)
     return NULL;
 
-  if (ch->events->iSize == 0)
-    return NULL;
-
-  /*
-  simple_list(NULL);
-  while ((pEvent = (struct event *) simple_list(ch->events)) != NULL) {
-    if (!pEvent->isMudEvent)
-      continue;
-    pMudEvent = (struct mud_event_data *) pEvent->event_obj;
-    if (pMudEvent->iId == iId) {
-      found = TRUE;
-      break;
-    }
-  }
-  simple_list(NULL);
-   */
-
-  for (pEvent = (struct event *) merge_iterator(&it, ch->events);
-          pEvent != NULL;
-          pEvent = next_in_list(&it)) {
-    if (!pEvent->isMudEvent)
-      continue;
-    pMudEvent = (struct mud_event_data *) pEvent->event_obj;
-    if (pMudEvent->iId == iId) {
-      found = TRUE;
-      break;
-    }
-  }
-  remove_iterator(&it);
-
-  if (found)
-    return (pMudEvent);
-
-  return NULL;
+  return ch->events_by_id[iId];
 }
 
 struct mud_event_data *room_has_mud_event(struct room_data *rm, event_id iId) {
-  struct event * pEvent = NULL;
-  struct mud_event_data * pMudEvent = NULL;
-  bool found = FALSE;
-
-  if (rm->events == NULL)
-    return NULL;
-
-  if (rm->events->iSize == 0)
+  if (rm->events == NULL || rm->events_by_id == NULL)
     return NULL;
 
-  simple_list(NULL);
-  while ((pEvent = (struct event *) simple_list(rm->events)) != NULL) {
-    if (!pEvent->isMudEvent)
-      continue;
-    pMudEvent = (struct mud_event_data *) pEvent->event_obj;
-    if (pMudEvent->iId == iId) {
-      found = TRUE;
-      break;
-    }
-  }
-  simple_list(NULL);
-
-  if (found)
-    return (pMudEvent);
-
-  return NULL;
+  return rm->events_by_id[iId];
 }
 
 struct mud_event_data *obj_has_mud_event(struct obj_data *obj, event_id iId) {
-  struct event * pEvent = NULL;
-  struct mud_event_data * pMudEvent = NULL;
-  bool found = FALSE;
-
-  if (obj->events == NULL)
+  if (obj->events == NULL || obj->events_by_id == NULL)
     return NULL;
 
-  if (obj->events->iSize == 0)
-    return NULL;
-
-  simple_list(NULL);
-  while ((pEvent = (struct event *) simple_list(obj->events)) != NULL) {
-    if (!pEvent->isMudEvent)
-      continue;
-    pMudEvent = (struct mud_event_data *) pEvent->event_obj;
-    if (pMudEvent->iId == iId) {
-      found = TRUE;
-      break;
-    }
-  }
-  simple_list(NULL);
-
-  if (found)
-    return (pMudEvent);
-
-  return NULL;
+  return obj->events_by_id[iId];
 }
 
 struct mud_event_data *region_has_mud_event(struct region_data *reg, event_id iId) {
-  struct event * pEvent = NULL;
-  struct mud_event_data * pMudEvent = NULL;
-  bool found = FALSE;
-
-  if (reg->events == NULL)
+  if (reg->events == NULL || reg->events_by_id == NULL)
     return NULL;
 
-  if (reg->events->iSize == 0)
-    return NULL;
-
-  simple_list(NULL);
-  while ((pEvent = (struct event *) simple_list(reg->events)) != NULL) {
-    if (!pEvent->isMudEvent)
-      continue;
-    pMudEvent = (struct mud_event_data *) pEvent->event_obj;
-    if (pMudEvent->iId == iId) {
-      found = TRUE;
-      break;
-    }
-  }
-  simple_list(NULL);
-
-  if (found)
-    return (pMudEvent);
-
-  return NULL;
+  return reg->events_by_id[iId];
 }
 
 void event_cancel_specific(struct char_data *ch, event_id iId) {
-  struct event * pEvent;
   struct mud_event_data * pMudEvent = NULL;
-  bool found = FALSE;
-  struct iterator_data it;
-
-  if (ch->events == NULL) {
-    //act("ch->events == NULL, for $n.", FALSE, ch, NULL, NULL, TO_ROOM);
-    //send_to_char(ch, "ch->events == NULL.\r\n");
-    return;
-  }
 
-  if (ch->events->iSize == 0) {
-    //act("ch->events->iSize == 0, for $n.", FALSE, ch, NULL, NULL, TO_ROOM);
-    //send_to_char(ch, "ch->events->iSize == 0.\r\n");
+  if ((pMudEvent = char_has_mud_event(ch, iId)) == NULL)
     return;
-  }
-
-  for (pEvent = (struct event *) merge_iterator(&it, ch->events);
-          pEvent != NULL;
-          pEvent = next_in_list(&it)) {
-    if (!pEvent->isMudEvent)
-      continue;
-    pMudEvent = (struct mud_event_data *) pEvent->event_obj;
-    if (pMudEvent->iId == iId) {
-      found = TRUE;
-      break;
-    }
-  }
-  remove_iterator(&it);
 
-  /* need to clear simple lists */
-  /*
-  simple_list(NULL);
-  act("Clearing simple list for $n.", FALSE, ch, NULL, NULL, TO_ROOM);
-  send_to_char(ch, "Clearing simple list.\r\n");
-   */
-  /* fill simple_list with ch's events, use it to try and find event ID */
-  /*
-  while ((pEvent = (struct event *) simple_list(ch->events)) != NULL) {
-    if (!pEvent->isMudEvent)
-      continue;
-    pMudEvent = (struct mud_event_data *) pEvent->event_obj;
-    if (pMudEvent->iId == iId) {
-      found = TRUE;
-      break;
-    }
-  }
-   */
-  /* need to clear simple lists */
-  /*
-  simple_list(NULL);
-  act("Clearing simple list for $n, 2nd time.", FALSE, ch, NULL, NULL, TO_ROOM);
-  send_to_char(ch, "Clearing simple list, 2nd time.\r\n");
-   */
-
-  if (found) {
-    //act("event found for $n, attempting to cancel", FALSE, ch, NULL, NULL, TO_ROOM);
-    //send_to_char(ch, "Event found: %d.\r\n", iId);
-    if (event_is_queued(pEvent))
-      event_cancel(pEvent);
-  } else {
-    //act("event_cancel_specific did not find an event for $n.", FALSE, ch, NULL, NULL, TO_ROOM);
-    //send_to_char(ch, "event_cancel_specific did not find an event.\r\n");
-  }
-
-  return;
+  if (event_is_queued(pMudEvent->pEvent))
+    event_cancel(pMudEvent->pEvent);
 }
 
 void clear_char_event_list(struct char_data * ch) {
-  struct event * pEvent = NULL;
+  struct event * pEvent = NULL, * pNextEvent = NULL;
   struct iterator_data it;
 
 
@@ -1094,17 +1017,23 @@ void clear_char_event_list(struct char_data * ch) {
    * on another list -> It generates unpredictable results.  Iterators are safe. */
   for (pEvent = (struct event *) merge_iterator(&it, ch->events);
           pEvent != NULL;
-          pEvent = next_in_list(&it)) {
+          pEvent = pNextEvent) {
     /* Here we have an issue - If we are currently executing an event, and it results in a char
      * having their events cleared (death) then we must be sure that we don't clear the executing
      * event!  Doing so will crash the event system. */
 
+    /* Step on first: cancelling frees the list item the iterator is on. */
+    pNextEvent = (struct event *) next_in_list(&it);
+
     if (event_is_queued(pEvent))
       event_cancel(pEvent);
     else if (ch->events->iSize == 1)
       break;
   }
-  remove_iterator(&it);
+
+  /* Cancelling the last event frees ch->events, and the iterator with it. */
+  if (ch->events)
+    remove_iterator(&it);
 }
 
 void clear_room_event_list(struct room_data *rm) {
@@ -1148,30 +1077,16 @@ void clear_region_event_list(struct region_data *reg) {
  */
 void change_event_duration(struct char_data * ch, event_id iId, long time) {
   struct event *pEvent = NULL;
-  struct mud_event_data *pMudEvent = NULL;
-  bool found = FALSE;
-
-  if (ch->events->iSize == 0)
-    return;
-
-  simple_list(NULL);
-  while ((pEvent = (struct event *) simple_list(ch->events)) != NULL) {
-
-    if (!pEvent->isMudEvent)
-      continue;
+  struct mud_event_data *pMudEvent = NULL, *pNewEvent = NULL;
 
-    pMudEvent = (struct mud_event_data *) pEvent->event_obj;
+  if ((pMudEvent = char_has_mud_event(ch, iId)) != NULL) {
+    pEvent = pMudEvent->pEvent;
 
-    if (pMudEvent->iId == iId) {
-      found = TRUE;
-      break;
-    }
-  }
-  simple_list(NULL);
-
-  if (found) {
     /* So we found the offending event, now build a new one, with the new time */
-    attach_mud_event(new_mud_event(iId, pMudEvent->pStruct, pMudEvent->sVariables), time);
+    pNewEvent = new_mud_event(iId, pMudEvent->pStruct, pMudEvent->sVariables);
+    pNewEvent->iVarType = pMudEvent->iVarType;
+    pNewEvent->iVar = pMudEvent->iVar;
+    attach_mud_event(pNewEvent, time);
     if (event_is_queued(pEvent))
       event_cancel(pEvent);
   }
@@ -1182,29 +1097,12 @@ void change_event_duration(struct char_data * ch, event_id iId, long time) {
 void change_event_svariables(struct char_data * ch, event_id iId, char *sVariables) {
   struct event *pEvent = NULL;
   struct mud_event_data *pMudEvent = NULL;
-  bool found = FALSE;
   long time = 0;
 
-  if (ch->events->iSize == 0)
-    return;
-
-  simple_list(NULL);
-  while ((pEvent = (struct event *) simple_list(ch->events)) != NULL) {
-
-    if (!pEvent->isMudEvent)
-      continue;
-
-    pMudEvent = (struct mud_event_data *) pEvent->event_obj;
-
-    if (pMudEvent->iId == iId) {
-      time = event_time(pMudEvent->pEvent);
-      found = TRUE;
-      break;
-    }
-  }
-  simple_list(NULL);
+  if ((pMudEvent = char_has_mud_event(ch, iId)) != NULL) {
+    pEvent = pMudEvent->pEvent;
+    time = event_time(pEvent);
 
-  if (found) {
     /* So we found the offending event, now build a new one, with the new time */
     attach_mud_event(new_mud_event(iId, pMudEvent->pStruct, sVariables), time);
     if (event_is_queued(pEvent))
@@ -26,6 +26,13 @@ struct region_data;
 
 #define NEW_EVENT(event_id, struct, var, time) (attach_mud_event(new_mud_event(event_id, struct,  var), time))
 
+/* Types for mud_event_data.iVar.  Events that fire often (combat rounds,
+ * action and daily-use cooldowns, falling) keep their state here rather than
+ * in sVariables so that reading and updating it needs no allocation or
+ * parsing. */
+#define MUD_EVENT_VAR_NONE 0 /* No typed variable, see sVariables */
+#define MUD_EVENT_VAR_NUM  1 /* iVar holds a number */
+
 typedef enum {
   eNULL, /*0*/
   ePROTOCOLS, /* The Protocol Detection Event */
@@ -71,7 +78,7 @@ typedef enum {
   eTRACKS, // Tracks in the room, decay on event processing.
   eWILD_SHAPE, // Wild shape event
   eSHIELD_RECOVERY, // Recovery from shield punch
-  eCOMBAT_ROUND, // Combat round
+  eCOMBAT_ROUND, // Combat round, no longer used (the ids are saved, so it keeps its slot)
   /*45*/eSTANDARDACTION, // Standard action cooldown
   eMOVEACTION, // Move action cooldown
   eWHOLENESSOFBODY, /* Wholeness of Body, Monk Healing Feat */
@@ -136,6 +143,8 @@ typedef enum {
   eMUTAGEN,
   eCURING_TOUCH, // alchemical discovery curing touch
   ePSYCHOKINETIC, // alchemical discovery psychokinetic tincture
+
+  NUM_MUD_EVENTS /* always last */
 } event_id;
 
 /* probably a smart place to mention to not forget to update:
@@ -154,6 +163,9 @@ struct mud_event_data {
   event_id iId; /***< General ID reference */
   void *pStruct; /***< Pointer to NULL, Descriptor, Character .... */
   char *sVariables; /***< String variable */
+  int iVarType; /***< What iVar holds, MUD_EVENT_VAR_xxx */
+  long iVar; /***< Typed variable, used instead of sVariables by frequent events */
+  struct mud_event_data *next_same_id; /***< Next (newer) event with this iId on the same owner */
 };
 
 /* Externals */
@@ -163,6 +175,10 @@ extern struct mud_event_list mud_event_index[];
 /* Local Functions */
 void init_events(void);
 struct mud_event_data *new_mud_event(event_id iId, void *pStruct, char *sVariables);
+struct mud_event_data *new_mud_event_num(event_id iId, void *pStruct, long num);
+bool mud_event_has_num(struct mud_event_data *pMudEvent);
+long mud_event_num(struct mud_event_data *pMudEvent, long def);
+void mud_event_set_num(struct mud_event_data *pMudEvent, long num);
 void attach_mud_event(struct mud_event_data *pMudEvent, long time);
 void free_mud_event(struct mud_event_data *pMudEvent);
 struct mud_event_data *char_has_mud_event(struct char_data *ch, event_id iId);
@@ -195,7 +211,6 @@ EVENTFUNC(event_chain_lightning);
 EVENTFUNC(event_falling);;
 EVENTFUNC(event_check_occupied);
 EVENTFUNC(event_tracks);
-EVENTFUNC(event_combat_round);
 EVENTFUNC(event_action_cooldown);
 EVENTFUNC(event_trap_triggered);
 EVENTFUNC(event_bardic_performance);
@@ -1,3 +1,5 @@
+#include <math.h>
+
 #include "conf.h"
 #include "sysdep.h"
 #include "structs.h"
@@ -6,9 +8,11 @@
 #include "comm.h"
 #include "modify.h"
 #include "mysql.h"
+#include "config.h"
 
 #include "wilderness.h"
 #include "mud_event.h"
+#include "rtree/rTreeIndex.h"
 
 MYSQL *conn = NULL;
 MYSQL *conn2 = NULL;
@@ -193,6 +197,273 @@ char** tokenize(const char* input, const char* delim) {
   return result;
 }
 
+/* In-memory spatial index for regions and paths.
+ *
+ * get_map() needs the enclosing regions and paths of every tile it draws,
+ * and asking MySQL for each of them meant hundreds of ST_Within/ST_Touches
+ * round trips per map.  The polygons and linestrings are already loaded into
+ * region_table and path_table, so we keep an R-tree over their bounding boxes
+ * and answer the point queries from memory.  The R-tree stores rnum + 1 as the
+ * record id since an id of 0 marks an empty branch. */
+static struct Node *region_rtree = NULL;
+static struct Node *path_rtree = NULL;
+
+/* Get the bounding box of a vertex list, as an R-tree rectangle. */
+static void vertex_bounding_rect(struct vertex *vertices, int num_vertices, struct Rect *rect) {
+  int i;
+
+  rect->boundary[0] = rect->boundary[2] = vertices[0].x;
+  rect->boundary[1] = rect->boundary[3] = vertices[0].y;
+
+  for (i = 1; i < num_vertices; i++) {
+    rect->boundary[0] = MIN(rect->boundary[0], vertices[i].x);
+    rect->boundary[1] = MIN(rect->boundary[1], vertices[i].y);
+    rect->boundary[2] = MAX(rect->boundary[2], vertices[i].x);
+    rect->boundary[3] = MAX(rect->boundary[3], vertices[i].y);
+  }
+}
+
+/* Is (x, y) on the segment from a to b? */
+static bool point_on_segment(struct vertex *a, struct vertex *b, int x, int y) {
+  long long cross;
+
+  if (x < MIN(a->x, b->x) || x > MAX(a->x, b->x) ||
+          y < MIN(a->y, b->y) || y > MAX(a->y, b->y))
+    return FALSE;
+
+  cross = (long long) (b->x - a->x) * (y - a->y) - (long long) (b->y - a->y) * (x - a->x);
+
+  return (cross == 0);
+}
+
+/* Distance from (x, y) to the segment from a to b. */
+static double point_segment_distance(struct vertex *a, struct vertex *b, double x, double y) {
+  double dx = b->x - a->x, dy = b->y - a->y;
+  double t = 0.0;
+
+  if (dx != 0.0 || dy != 0.0) {
+    t = ((x - a->x) * dx + (y - a->y) * dy) / (dx * dx + dy * dy);
+    t = (t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t));
+  }
+
+  dx = a->x + t * dx - x;
+  dy = a->y + t * dy - y;
+
+  return sqrt(dx * dx + dy * dy);
+}
+
+/* Is (x, y) on the ring (or linestring, if closed is FALSE)? */
+static bool point_on_vertices(struct vertex *vertices, int num_vertices, bool closed, int x, int y) {
+  int i;
+
+  if (num_vertices == 1)
+    return (vertices[0].x == x && vertices[0].y == y);
+
+  for (i = 0; i < num_vertices - 1; i++)
+    if (point_on_segment(&vertices[i], &vertices[i + 1], x, y))
+      return TRUE;
+
+  if (closed && num_vertices > 2)
+    return point_on_segment(&vertices[num_vertices - 1], &vertices[0], x, y);
+
+  return FALSE;
+}
+
+/* Same test as ST_Touches(POINT(x y), path_linestring): a point only touches
+ * a linestring on its boundary, which is its two end points, and a closed
+ * linestring has none. */
+static bool point_touches_linestring(struct vertex *vertices, int num_vertices, int x, int y) {
+  struct vertex *first = &vertices[0], *last = &vertices[num_vertices - 1];
+
+  if (num_vertices < 2 || (first->x == last->x && first->y == last->y))
+    return FALSE;
+
+  return ((first->x == x && first->y == y) || (last->x == x && last->y == y));
+}
+
+/* Same test as ST_Within(POINT(x y), region_polygon) - the point has to be in
+ * the interior, a point on the boundary is not within the region. */
+static bool point_within_region_polygon(struct region_data *region, int x, int y) {
+  struct vertex *v = region->vertices;
+  int i, j, n = region->num_vertices;
+  bool inside = FALSE;
+
+  if (n < 3 || point_on_vertices(v, n, TRUE, x, y))
+    return FALSE;
+
+  for (i = 0, j = n - 1; i < n; j = i++) {
+    if (((v[i].y > y) != (v[j].y > y)) &&
+            (x < (double) (v[j].x - v[i].x) * (y - v[i].y) / (double) (v[j].y - v[i].y) + v[i].x))
+      inside = !inside;
+  }
+
+  return inside;
+}
+
+/* Work out where in the region the point is, this mirrors the CASE in the
+ * old region_index query: center, well inside, or near the edge. */
+static int region_point_position(struct region_data *region, int x, int y) {
+  double ring_dist = -1.0, dist, dx, dy;
+  int i, n = region->num_vertices;
+
+  if (x == region->centroid_x && y == region->centroid_y)
+    return REGION_POS_CENTER;
+
+  for (i = 0; i < n; i++) {
+    dist = point_segment_distance(&region->vertices[i], &region->vertices[(i + 1) % n], x, y);
+    if (ring_dist < 0.0 || dist < ring_dist)
+      ring_dist = dist;
+  }
+
+  dx = x - region->centroid_x;
+  dy = y - region->centroid_y;
+
+  if (ring_dist > sqrt(dx * dx + dy * dy) / 2)
+    return REGION_POS_INSIDE;
+
+  return REGION_POS_EDGE;
+}
+
+/* Area centroid of the region polygon. */
+static void calculate_region_centroid(struct region_data *region) {
+  struct vertex *v = region->vertices;
+  int i, n = region->num_vertices;
+  double area = 0.0, cx = 0.0, cy = 0.0, cross;
+
+  for (i = 0; i < n; i++) {
+    cross = (double) v[i].x * v[(i + 1) % n].y - (double) v[(i + 1) % n].x * v[i].y;
+    area += cross;
+    cx += (v[i].x + v[(i + 1) % n].x) * cross;
+    cy += (v[i].y + v[(i + 1) % n].y) * cross;
+  }
+
+  if (area == 0.0) {
+    /* Degenerate polygon, just average the vertices. */
+    for (i = 0, cx = cy = 0.0; i < n; i++) {
+      cx += v[i].x;
+      cy += v[i].y;
+    }
+    region->centroid_x = (n ? cx / n : 0.0);
+    region->centroid_y = (n ? cy / n : 0.0);
+    return;
+  }
+
+  region->centroid_x = cx / (3.0 * area);
+  region->centroid_y = cy / (3.0 * area);
+}
+
+static void build_region_index() {
+  struct Rect rect;
+  int i;
+
+  if (region_rtree != NULL)
+    RTreeDeleteIndex(region_rtree);
+
+  region_rtree = RTreeNewIndex();
+
+  for (i = 0; i <= top_of_region_table; i++) {
+    if (region_table[i].num_vertices < 1)
+      continue;
+
+    calculate_region_centroid(&region_table[i]);
+    vertex_bounding_rect(region_table[i].vertices, region_table[i].num_vertices, &rect);
+    RTreeInsertRect(&rect, i + 1, &region_rtree, 0);
+  }
+}
+
+static void build_path_index() {
+  struct Rect rect;
+  int i;
+
+  if (path_rtree != NULL)
+    RTreeDeleteIndex(path_rtree);
+
+  path_rtree = RTreeNewIndex();
+
+  for (i = 0; i <= top_of_path_table; i++) {
+    if (path_table[i].num_vertices < 1)
+      continue;
+
+    vertex_bounding_rect(path_table[i].vertices, path_table[i].num_vertices, &rect);
+    RTreeInsertRect(&rect, i + 1, &path_rtree, 0);
+  }
+}
+
+/* Search state handed to the R-tree callbacks. */
+struct spatial_search {
+  zone_rnum zone;
+  int x;
+  int y;
+  void *list;
+};
+
+static int region_search_hit(int id, void *arg) {
+  struct spatial_search *search = (struct spatial_search *) arg;
+  struct region_data *region = &region_table[id - 1];
+  struct region_list *new_node = NULL, **prev;
+
+  if (region->zone != search->zone || !point_within_region_polygon(region, search->x, search->y))
+    return 1;
+
+  CREATE(new_node, struct region_list, 1);
+  new_node->rnum = region->rnum;
+  new_node->pos = region_point_position(region, search->x, search->y);
+
+  /* Keep the list in rnum order so overlapping regions resolve the same way
+   * every time, regardless of how the tree is laid out. */
+  for (prev = (struct region_list **) &search->list; *prev && (*prev)->rnum < new_node->rnum; prev = &(*prev)->next);
+  new_node->next = *prev;
+  *prev = new_node;
+
+  return 1;
+}
+
+static int path_search_hit(int id, void *arg) {
+  struct spatial_search *search = (struct spatial_search *) arg;
+  struct path_data *path = &path_table[id - 1];
+  struct path_list *new_node = NULL, **prev;
+  int x = search->x, y = search->y;
+
+  if (path->zone != search->zone || !point_touches_linestring(path->vertices, path->num_vertices, x, y))
+    return 1;
+
+  CREATE(new_node, struct path_list, 1);
+  new_node->rnum = path->rnum;
+
+  if (point_touches_linestring(path->vertices, path->num_vertices, x, y - 1) &&
+          point_touches_linestring(path->vertices, path->num_vertices, x, y + 1))
+    new_node->glyph_type = GLYPH_TYPE_PATH_NS;
+  else if (point_touches_linestring(path->vertices, path->num_vertices, x - 1, y) &&
+          point_touches_linestring(path->vertices, path->num_vertices, x + 1, y))
+    new_node->glyph_type = GLYPH_TYPE_PATH_EW;
+  else
+    new_node->glyph_type = GLYPH_TYPE_PATH_INT;
+
+  for (prev = (struct path_list **) &search->list; *prev && (*prev)->rnum < new_node->rnum; prev = &(*prev)->next);
+  new_node->next = *prev;
+  *prev = new_node;
+
+  return 1;
+}
+
+void free_region_list(struct region_list *regions) {
+  struct region_list *next;
+
+  for (; regions; regions = next) {
+    next = regions->next;
+    free(regions);
+  }
+}
+
+void free_path_list(struct path_list *paths) {
+  struct path_list *next;
+
+  for (; paths; paths = next) {
+    next = paths->next;
+    free(paths);
+  }
+}
+
 void load_regions() {
   /* region_data* region_table */
 
@@ -287,10 +558,13 @@ void load_regions() {
   }
 
   mysql_free_result(result);
+
+  build_region_index();
 }
 
-/* Move this out to another file... */
-bool is_point_within_region(region_vnum region, int x, int y) {
+/* The database version of is_point_within_region(), only used to verify the
+ * in-memory index. */
+static bool is_point_within_region_db(region_vnum region, int x, int y) {
   MYSQL_RES *result;
   MYSQL_ROW row;
   bool retval;
@@ -327,7 +601,9 @@ bool is_point_within_region(region_vnum region, int x, int y) {
   return retval;
 }
 
-struct region_list* get_enclosing_regions(zone_rnum zone, int x, int y) {
+/* The database version of get_enclosing_regions(), only used to verify the
+ * in-memory index. */
+static struct region_list* get_enclosing_regions_db(zone_rnum zone, int x, int y) {
   MYSQL_RES *result;
   MYSQL_ROW row;
 
@@ -394,6 +670,75 @@ struct region_list* get_enclosing_regions(zone_rnum zone, int x, int y) {
   return regions;
 }
 
+bool is_point_within_region(region_vnum region, int x, int y) {
+  region_rnum rnum;
+  bool retval = FALSE;
+
+  if (region_table != NULL && (rnum = real_region(region)) != NOWHERE)
+    retval = point_within_region_polygon(&region_table[rnum], x, y);
+
+  if (verify_wilderness_index && retval != is_point_within_region_db(region, x, y))
+    log("SYSERR: Region index mismatch for region %d at (%d, %d): memory says %s.",
+          region, x, y, retval ? "within" : "outside");
+
+  return retval;
+}
+
+/* Compare the in-memory answer to the one from MySQL and log differences. */
+static void verify_enclosing_regions(struct region_list *regions, zone_rnum zone, int x, int y) {
+  struct region_list *db_regions, *curr, *db_curr;
+  int count = 0, db_count = 0;
+  bool match = TRUE;
+
+  db_regions = get_enclosing_regions_db(zone, x, y);
+
+  for (db_curr = db_regions; db_curr; db_curr = db_curr->next)
+    db_count++;
+
+  for (curr = regions; curr; curr = curr->next) {
+    count++;
+    for (db_curr = db_regions; db_curr; db_curr = db_curr->next)
+      if (db_curr->rnum == curr->rnum)
+        break;
+    if (!db_curr) {
+      log("SYSERR: Region index mismatch at (%d, %d): region %d not returned by MySQL.",
+              x, y, region_table[curr->rnum].vnum);
+      match = FALSE;
+    } else if (db_curr->pos != curr->pos) {
+      log("SYSERR: Region index mismatch at (%d, %d): region %d position %d, MySQL says %d.",
+              x, y, region_table[curr->rnum].vnum, curr->pos, db_curr->pos);
+      match = FALSE;
+    }
+  }
+
+  if (match && count != db_count)
+    log("SYSERR: Region index mismatch at (%d, %d): %d regions in memory, %d from MySQL.",
+          x, y, count, db_count);
+
+  free_region_list(db_regions);
+}
+
+struct region_list* get_enclosing_regions(zone_rnum zone, int x, int y) {
+  struct spatial_search search;
+  struct Rect rect;
+
+  search.zone = zone;
+  search.x = x;
+  search.y = y;
+  search.list = NULL;
+
+  if (region_rtree != NULL) {
+    rect.boundary[0] = rect.boundary[2] = x;
+    rect.boundary[1] = rect.boundary[3] = y;
+    RTreeSearch(region_rtree, &rect, region_search_hit, &search);
+  }
+
+  if (verify_wilderness_index)
+    verify_enclosing_regions((struct region_list *) search.list, zone, x, y);
+
+  return (struct region_list *) search.list;
+}
+
 #define ROUND(num) (num < 0 ? num - 0.5 : num + 0.5)
 
 /* Move this out to another file... */
@@ -615,6 +960,8 @@ void load_paths() {
     i++;
   }
   mysql_free_result(result);
+
+  build_path_index();
 }
 
 /* Insert a path into the database. */
@@ -683,7 +1030,9 @@ bool delete_path(region_vnum vnum) {
     return false;
 }
 
-struct path_list* get_enclosing_paths(zone_rnum zone, int x, int y) {
+/* The database version of get_enclosing_paths(), only used to verify the
+ * in-memory index. */
+static struct path_list* get_enclosing_paths_db(zone_rnum zone, int x, int y) {
   MYSQL_RES *result;
   MYSQL_ROW row;
 
@@ -741,6 +1090,61 @@ struct path_list* get_enclosing_paths(zone_rnum zone, int x, int y) {
   return paths;
 }
 
+/* Compare the in-memory answer to the one from MySQL and log differences. */
+static void verify_enclosing_paths(struct path_list *paths, zone_rnum zone, int x, int y) {
+  struct path_list *db_paths, *curr, *db_curr;
+  int count = 0, db_count = 0;
+  bool match = TRUE;
+
+  db_paths = get_enclosing_paths_db(zone, x, y);
+
+  for (db_curr = db_paths; db_curr; db_curr = db_curr->next)
+    db_count++;
+
+  for (curr = paths; curr; curr = curr->next) {
+    count++;
+    for (db_curr = db_paths; db_curr; db_curr = db_curr->next)
+      if (db_curr->rnum == curr->rnum)
+        break;
+    if (!db_curr) {
+      log("SYSERR: Path index mismatch at (%d, %d): path %d not returned by MySQL.",
+              x, y, path_table[curr->rnum].vnum);
+      match = FALSE;
+    } else if (db_curr->glyph_type != curr->glyph_type) {
+      log("SYSERR: Path index mismatch at (%d, %d): path %d glyph %d, MySQL says %d.",
+              x, y, path_table[curr->rnum].vnum, curr->glyph_type, db_curr->glyph_type);
+      match = FALSE;
+    }
+  }
+
+  if (match && count != db_count)
+    log("SYSERR: Path index mismatch at (%d, %d): %d paths in memory, %d from MySQL.",
+          x, y, count, db_count);
+
+  free_path_list(db_paths);
+}
+
+struct path_list* get_enclosing_paths(zone_rnum zone, int x, int y) {
+  struct spatial_search search;
+  struct Rect rect;
+
+  search.zone = zone;
+  search.x = x;
+  search.y = y;
+  search.list = NULL;
+
+  if (path_rtree != NULL) {
+    rect.boundary[0] = rect.boundary[2] = x;
+    rect.boundary[1] = rect.boundary[3] = y;
+    RTreeSearch(path_rtree, &rect, path_search_hit, &search);
+  }
+
+  if (verify_wilderness_index)
+    verify_enclosing_paths((struct path_list *) search.list, zone, x, y);
+
+  return (struct path_list *) search.list;
+}
+
 void save_paths() {
 
 }
@@ -12,6 +12,14 @@ static int     p[MAX_GENERATED_NOISE][B + B + 2];
 static double g3[MAX_GENERATED_NOISE][B + B + 2][3];
 static double g2[MAX_GENERATED_NOISE][B + B + 2][2];
 static double g1[MAX_GENERATED_NOISE][B + B + 2];
+
+/* The gradient tables again, split by component so the batch kernels can
+ * load (or gather) them directly. */
+static double g2x[MAX_GENERATED_NOISE][B + B + 2];
+static double g2y[MAX_GENERATED_NOISE][B + B + 2];
+static double g3x[MAX_GENERATED_NOISE][B + B + 2];
+static double g3y[MAX_GENERATED_NOISE][B + B + 2];
+static double g3z[MAX_GENERATED_NOISE][B + B + 2];
 // static int start = 0;
 
 double noise1(int idx, double arg)
@@ -180,6 +188,14 @@ void init_perlin(int idx, int seed)
          g3[idx][B + i][j] = g3[idx][i][j];
    }
 
+   for (i = 0 ; i < B + B + 2 ; i++) {
+      g2x[idx][i] = g2[idx][i][0];
+      g2y[idx][i] = g2[idx][i][1];
+      g3x[idx][i] = g3[idx][i][0];
+      g3y[idx][i] = g3[idx][i][1];
+      g3z[idx][i] = g3[idx][i][2];
+   }
+
    /* Reset the seed to something random in case we need it for other purposes. */
    srand(time(0));
 }
@@ -249,6 +265,410 @@ double PerlinNoise3D(int idx, double x,double y,double z,double alpha,double bet
    return(sum);
 }
 
+/* --- Batch evaluation ----------------------------------------------------
+ *
+ * The terrain and weather code evaluates whole rows of points at a time, so
+ * these functions take arrays of coordinates and run one octave over all of
+ * them before moving to the next.  The SIMD kernels do exactly the same
+ * double precision operations, in the same order, as noise2() and noise3()
+ * so the results are bit-identical to the scalar functions - keep it that way
+ * if you touch either side (no reassociation, no fused multiply-add).
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PERLIN_SIMD
+#include <immintrin.h>
+#endif
+
+typedef void (*noise2_batch_func)(int idx, const double *x, const double *y, int count, double *out);
+typedef void (*noise3_batch_func)(int idx, const double *x, const double *y, const double *z, int count, double *out);
+
+static void noise2_batch_scalar(int idx, const double *x, const double *y, int count, double *out)
+{
+   double vec[2];
+   int k;
+
+   for (k = 0; k < count; k++) {
+      vec[0] = x[k];
+      vec[1] = y[k];
+      out[k] = noise2(idx, vec);
+   }
+}
+
+static void noise3_batch_scalar(int idx, const double *x, const double *y, const double *z, int count, double *out)
+{
+   double vec[3];
+   int k;
+
+   for (k = 0; k < count; k++) {
+      vec[0] = x[k];
+      vec[1] = y[k];
+      vec[2] = z[k];
+      out[k] = noise3(idx, vec);
+   }
+}
+
+#ifdef PERLIN_SIMD
+
+/* Vector forms of the setup, s_curve, lerp and at2/at3 macros.  W is the
+ * intrinsic prefix, _mm for SSE2 and _mm256 for AVX2.  setup stores the
+ * truncated (unmasked) lattice coordinates to the int array b. */
+#define setup_sse2(in, b, r0, r1) do { \
+        __m128d t_ = _mm_add_pd(in, _mm_set1_pd(N)); \
+        __m128i i_ = _mm_cvttpd_epi32(t_); \
+        r0 = _mm_sub_pd(t_, _mm_cvtepi32_pd(i_)); \
+        r1 = _mm_sub_pd(r0, _mm_set1_pd(1.)); \
+        _mm_storel_epi64((__m128i *) (b), i_); \
+   } while (0)
+#define setup_avx2(in, b, r0, r1) do { \
+        __m256d t_ = _mm256_add_pd(in, _mm256_set1_pd(N)); \
+        __m128i i_ = _mm256_cvttpd_epi32(t_); \
+        r0 = _mm256_sub_pd(t_, _mm256_cvtepi32_pd(i_)); \
+        r1 = _mm256_sub_pd(r0, _mm256_set1_pd(1.)); \
+        _mm_storeu_si128((__m128i *) (b), i_); \
+   } while (0)
+#define s_curve_pd(W, t) W##_mul_pd(W##_mul_pd(t, t), W##_sub_pd(W##_set1_pd(3.), W##_mul_pd(W##_set1_pd(2.), t)))
+#define lerp_pd(W, t, a, b) W##_add_pd(a, W##_mul_pd(t, W##_sub_pd(b, a)))
+#define at2_pd(W, rx, ry, qx, qy) W##_add_pd(W##_mul_pd(rx, qx), W##_mul_pd(ry, qy))
+#define at3_pd(W, rx, ry, rz, qx, qy, qz) W##_add_pd(W##_add_pd(W##_mul_pd(rx, qx), W##_mul_pd(ry, qy)), W##_mul_pd(rz, qz))
+
+/* Two points at a time.  SSE2 has no gather, so the permutation and gradient
+ * lookups are done per lane and packed. */
+__attribute__((target("sse2")))
+static void noise2_batch_sse2(int idx, const double *x, const double *y, int count, double *out)
+{
+   int bx[4], by[4], k, l;
+   int b00[2], b10[2], b01[2], b11[2];
+   __m128d rx0, rx1, ry0, ry1, sx, sy, u, v, a, b;
+   const int *perm = p[idx];
+   const double *gx = g2x[idx], *gy = g2y[idx];
+
+   for (k = 0; k + 2 <= count; k += 2) {
+      setup_sse2(_mm_loadu_pd(x + k), bx, rx0, rx1);
+      setup_sse2(_mm_loadu_pd(y + k), by, ry0, ry1);
+
+      for (l = 0; l < 2; l++) {
+         int bx0 = bx[l] & BM, bx1 = (bx0 + 1) & BM;
+         int by0 = by[l] & BM, by1 = (by0 + 1) & BM;
+         int i = perm[bx0], j = perm[bx1];
+
+         b00[l] = perm[i + by0];
+         b10[l] = perm[j + by0];
+         b01[l] = perm[i + by1];
+         b11[l] = perm[j + by1];
+      }
+
+      sx = s_curve_pd(_mm, rx0);
+      sy = s_curve_pd(_mm, ry0);
+
+      u = at2_pd(_mm, rx0, ry0, _mm_set_pd(gx[b00[1]], gx[b00[0]]), _mm_set_pd(gy[b00[1]], gy[b00[0]]));
+      v = at2_pd(_mm, rx1, ry0, _mm_set_pd(gx[b10[1]], gx[b10[0]]), _mm_set_pd(gy[b10[1]], gy[b10[0]]));
+      a = lerp_pd(_mm, sx, u, v);
+
+      u = at2_pd(_mm, rx0, ry1, _mm_set_pd(gx[b01[1]], gx[b01[0]]), _mm_set_pd(gy[b01[1]], gy[b01[0]]));
+      v = at2_pd(_mm, rx1, ry1, _mm_set_pd(gx[b11[1]], gx[b11[0]]), _mm_set_pd(gy[b11[1]], gy[b11[0]]));
+      b = lerp_pd(_mm, sx, u, v);
+
+      _mm_storeu_pd(out + k, lerp_pd(_mm, sy, a, b));
+   }
+
+   noise2_batch_scalar(idx, x + k, y + k, count - k, out + k);
+}
+
+__attribute__((target("sse2")))
+static void noise3_batch_sse2(int idx, const double *x, const double *y, const double *z, int count, double *out)
+{
+   int bx[4], by[4], bz[4], k, l;
+   int b00[2], b10[2], b01[2], b11[2], bz0[2], bz1[2];
+   __m128d rx0, rx1, ry0, ry1, rz0, rz1, t, sy, sz, a, b, c, d, u, v;
+   const int *perm = p[idx];
+   const double *gx = g3x[idx], *gy = g3y[idx], *gz = g3z[idx];
+
+#define G3_SSE2(tbl, bb, bzz) _mm_set_pd(tbl[bb[1] + bzz[1]], tbl[bb[0] + bzz[0]])
+#define AT3_SSE2(rx, ry, rz, bb, bzz) at3_pd(_mm, rx, ry, rz, G3_SSE2(gx, bb, bzz), G3_SSE2(gy, bb, bzz), G3_SSE2(gz, bb, bzz))
+
+   for (k = 0; k + 2 <= count; k += 2) {
+      setup_sse2(_mm_loadu_pd(x + k), bx, rx0, rx1);
+      setup_sse2(_mm_loadu_pd(y + k), by, ry0, ry1);
+      setup_sse2(_mm_loadu_pd(z + k), bz, rz0, rz1);
+
+      for (l = 0; l < 2; l++) {
+         int bx0 = bx[l] & BM, bx1 = (bx0 + 1) & BM;
+         int by0 = by[l] & BM, by1 = (by0 + 1) & BM;
+         int i = perm[bx0], j = perm[bx1];
+
+         bz0[l] = bz[l] & BM;
+         bz1[l] = (bz0[l] + 1) & BM;
+         b00[l] = perm[i + by0];
+         b10[l] = perm[j + by0];
+         b01[l] = perm[i + by1];
+         b11[l] = perm[j + by1];
+      }
+
+      t = s_curve_pd(_mm, rx0);
+      sy = s_curve_pd(_mm, ry0);
+      sz = s_curve_pd(_mm, rz0);
+
+      u = AT3_SSE2(rx0, ry0, rz0, b00, bz0);
+      v = AT3_SSE2(rx1, ry0, rz0, b10, bz0);
+      a = lerp_pd(_mm, t, u, v);
+
+      u = AT3_SSE2(rx0, ry1, rz0, b01, bz0);
+      v = AT3_SSE2(rx1, ry1, rz0, b11, bz0);
+      b = lerp_pd(_mm, t, u, v);
+
+      c = lerp_pd(_mm, sy, a, b);
+
+      u = AT3_SSE2(rx0, ry0, rz1, b00, bz1);
+      v = AT3_SSE2(rx1, ry0, rz1, b10, bz1);
+      a = lerp_pd(_mm, t, u, v);
+
+      u = AT3_SSE2(rx0, ry1, rz1, b01, bz1);
+      v = AT3_SSE2(rx1, ry1, rz1, b11, bz1);
+      b = lerp_pd(_mm, t, u, v);
+
+      d = lerp_pd(_mm, sy, a, b);
+
+      _mm_storeu_pd(out + k, lerp_pd(_mm, sz, c, d));
+   }
+
+#undef AT3_SSE2
+#undef G3_SSE2
+
+   noise3_batch_scalar(idx, x + k, y + k, z + k, count - k, out + k);
+}
+
+/* Four points at a time, with the permutation and gradient lookups done as
+ * gathers.  Only AVX2 is enabled here, not FMA, so the compiler can't fuse
+ * the multiplies and adds and change the rounding. */
+__attribute__((target("avx2")))
+static void noise2_batch_avx2(int idx, const double *x, const double *y, int count, double *out)
+{
+   int bx[4], by[4], k;
+   __m128i mask = _mm_set1_epi32(BM), inc = _mm_set1_epi32(1);
+   __m128i bx0, bx1, by0, by1, i, j, b00, b10, b01, b11;
+   __m256d rx0, rx1, ry0, ry1, sx, sy, u, v, a, b;
+   const int *perm = p[idx];
+   const double *gx = g2x[idx], *gy = g2y[idx];
+
+   for (k = 0; k + 4 <= count; k += 4) {
+      setup_avx2(_mm256_loadu_pd(x + k), bx, rx0, rx1);
+      setup_avx2(_mm256_loadu_pd(y + k), by, ry0, ry1);
+
+      bx0 = _mm_and_si128(_mm_loadu_si128((__m128i *) bx), mask);
+      bx1 = _mm_and_si128(_mm_add_epi32(bx0, inc), mask);
+      by0 = _mm_and_si128(_mm_loadu_si128((__m128i *) by), mask);
+      by1 = _mm_and_si128(_mm_add_epi32(by0, inc), mask);
+
+      i = _mm_i32gather_epi32(perm, bx0, 4);
+      j = _mm_i32gather_epi32(perm, bx1, 4);
+
+      b00 = _mm_i32gather_epi32(perm, _mm_add_epi32(i, by0), 4);
+      b10 = _mm_i32gather_epi32(perm, _mm_add_epi32(j, by0), 4);
+      b01 = _mm_i32gather_epi32(perm, _mm_add_epi32(i, by1), 4);
+      b11 = _mm_i32gather_epi32(perm, _mm_add_epi32(j, by1), 4);
+
+      sx = s_curve_pd(_mm256, rx0);
+      sy = s_curve_pd(_mm256, ry0);
+
+      u = at2_pd(_mm256, rx0, ry0, _mm256_i32gather_pd(gx, b00, 8), _mm256_i32gather_pd(gy, b00, 8));
+      v = at2_pd(_mm256, rx1, ry0, _mm256_i32gather_pd(gx, b10, 8), _mm256_i32gather_pd(gy, b10, 8));
+      a = lerp_pd(_mm256, sx, u, v);
+
+      u = at2_pd(_mm256, rx0, ry1, _mm256_i32gather_pd(gx, b01, 8), _mm256_i32gather_pd(gy, b01, 8));
+      v = at2_pd(_mm256, rx1, ry1, _mm256_i32gather_pd(gx, b11, 8), _mm256_i32gather_pd(gy, b11, 8));
+      b = lerp_pd(_mm256, sx, u, v);
+
+      _mm256_storeu_pd(out + k, lerp_pd(_mm256, sy, a, b));
+   }
+
+   noise2_batch_scalar(idx, x + k, y + k, count - k, out + k);
+}
+
+__attribute__((target("avx2")))
+static void noise3_batch_avx2(int idx, const double *x, const double *y, const double *z, int count, double *out)
+{
+   int bx[4], by[4], bz[4], k;
+   __m128i mask = _mm_set1_epi32(BM), inc = _mm_set1_epi32(1);
+   __m128i bx0, bx1, by0, by1, bz0, bz1, i, j, b00, b10, b01, b11, o;
+   __m256d rx0, rx1, ry0, ry1, rz0, rz1, t, sy, sz, a, b, c, d, u, v;
+   const int *perm = p[idx];
+   const double *gx = g3x[idx], *gy = g3y[idx], *gz = g3z[idx];
+
+#define AT3_AVX2(rx, ry, rz, bb, bzz) (o = _mm_add_epi32(bb, bzz), \
+        at3_pd(_mm256, rx, ry, rz, _mm256_i32gather_pd(gx, o, 8), _mm256_i32gather_pd(gy, o, 8), _mm256_i32gather_pd(gz, o, 8)))
+
+   for (k = 0; k + 4 <= count; k += 4) {
+      setup_avx2(_mm256_loadu_pd(x + k), bx, rx0, rx1);
+      setup_avx2(_mm256_loadu_pd(y + k), by, ry0, ry1);
+      setup_avx2(_mm256_loadu_pd(z + k), bz, rz0, rz1);
+
+      bx0 = _mm_and_si128(_mm_loadu_si128((__m128i *) bx), mask);
+      bx1 = _mm_and_si128(_mm_add_epi32(bx0, inc), mask);
+      by0 = _mm_and_si128(_mm_loadu_si128((__m128i *) by), mask);
+      by1 = _mm_and_si128(_mm_add_epi32(by0, inc), mask);
+      bz0 = _mm_and_si128(_mm_loadu_si128((__m128i *) bz), mask);
+      bz1 = _mm_and_si128(_mm_add_epi32(bz0, inc), mask);
+
+      i = _mm_i32gather_epi32(perm, bx0, 4);
+      j = _mm_i32gather_epi32(perm, bx1, 4);
+
+      b00 = _mm_i32gather_epi32(perm, _mm_add_epi32(i, by0), 4);
+      b10 = _mm_i32gather_epi32(perm, _mm_add_epi32(j, by0), 4);
+      b01 = _mm_i32gather_epi32(perm, _mm_add_epi32(i, by1), 4);
+      b11 = _mm_i32gather_epi32(perm, _mm_add_epi32(j, by1), 4);
+
+      t = s_curve_pd(_mm256, rx0);
+      sy = s_curve_pd(_mm256, ry0);
+      sz = s_curve_pd(_mm256, rz0);
+
+      u = AT3_AVX2(rx0, ry0, rz0, b00, bz0);
+      v = AT3_AVX2(rx1, ry0, rz0, b10, bz0);
+      a = lerp_pd(_mm256, t, u, v);
+
+      u = AT3_AVX2(rx0, ry1, rz0, b01, bz0);
+      v = AT3_AVX2(rx1, ry1, rz0, b11, bz0);
+      b = lerp_pd(_mm256, t, u, v);
+
+      c = lerp_pd(_mm256, sy, a, b);
+
+      u = AT3_AVX2(rx0, ry0, rz1, b00, bz1);
+      v = AT3_AVX2(rx1, ry0, rz1, b10, bz1);
+      a = lerp_pd(_mm256, t, u, v);
+
+      u = AT3_AVX2(rx0, ry1, rz1, b01, bz1);
+      v = AT3_AVX2(rx1, ry1, rz1, b11, bz1);
+      b = lerp_pd(_mm256, t, u, v);
+
+      d = lerp_pd(_mm256, sy, a, b);
+
+      _mm256_storeu_pd(out + k, lerp_pd(_mm256, sz, c, d));
+   }
+
+#undef AT3_AVX2
+
+   noise3_batch_scalar(idx, x + k, y + k, z + k, count - k, out + k);
+}
+
+#endif /* PERLIN_SIMD */
+
+static int batch_mode = -1;
+static noise2_batch_func noise2_batch = noise2_batch_scalar;
+static noise3_batch_func noise3_batch = noise3_batch_scalar;
+
+/* Pick the kernel used by the batch functions.  PERLIN_BATCH_AUTO takes the
+ * best one the CPU supports; asking for one it doesn't support falls back to
+ * the next best.  Returns the mode actually in use. */
+int perlin_batch_mode(int mode)
+{
+#ifdef PERLIN_SIMD
+   __builtin_cpu_init();
+
+   if ((mode == PERLIN_BATCH_AUTO || mode == PERLIN_BATCH_AVX2) && __builtin_cpu_supports("avx2"))
+      mode = PERLIN_BATCH_AVX2;
+   else if (mode != PERLIN_BATCH_SCALAR && __builtin_cpu_supports("sse2"))
+      mode = PERLIN_BATCH_SSE2;
+   else
+      mode = PERLIN_BATCH_SCALAR;
+#else
+   mode = PERLIN_BATCH_SCALAR;
+#endif
+
+   switch (mode) {
+#ifdef PERLIN_SIMD
+   case PERLIN_BATCH_AVX2:
+      noise2_batch = noise2_batch_avx2;
+      noise3_batch = noise3_batch_avx2;
+      break;
+   case PERLIN_BATCH_SSE2:
+      noise2_batch = noise2_batch_sse2;
+      noise3_batch = noise3_batch_sse2;
+      break;
+#endif
+   default:
+      noise2_batch = noise2_batch_scalar;
+      noise3_batch = noise3_batch_scalar;
+      break;
+   }
+
+   return (batch_mode = mode);
+}
+
+/* Batch form of PerlinNoise2D(): out[k] = PerlinNoise2D(idx, x[k], y[k], ...). */
+void PerlinNoise2DBatch(int idx, const double *x, const double *y, int count,
+                        double alpha, double beta, int n, double *out)
+{
+   double *px, *py, *val, scale = 1;
+   int i, k;
+
+   if (count <= 0)
+      return;
+
+   if (batch_mode < 0)
+      perlin_batch_mode(PERLIN_BATCH_AUTO);
+
+   px = (double *) malloc(sizeof(double) * count * 3);
+   py = px + count;
+   val = py + count;
+
+   for (k = 0; k < count; k++) {
+      px[k] = x[k];
+      py[k] = y[k];
+      out[k] = 0;
+   }
+
+   for (i = 0; i < n; i++) {
+      noise2_batch(idx, px, py, count, val);
+      for (k = 0; k < count; k++) {
+         out[k] += val[k] / scale;
+         px[k] *= beta;
+         py[k] *= beta;
+      }
+      scale *= alpha;
+   }
+
+   free(px);
+}
+
+/* Batch form of PerlinNoise3D(). */
+void PerlinNoise3DBatch(int idx, const double *x, const double *y, const double *z, int count,
+                        double alpha, double beta, int n, double *out)
+{
+   double *px, *py, *pz, *val, scale = 1;
+   int i, k;
+
+   if (count <= 0)
+      return;
+
+   if (batch_mode < 0)
+      perlin_batch_mode(PERLIN_BATCH_AUTO);
+
+   px = (double *) malloc(sizeof(double) * count * 4);
+   py = px + count;
+   pz = py + count;
+   val = pz + count;
+
+   for (k = 0; k < count; k++) {
+      px[k] = x[k];
+      py[k] = y[k];
+      pz[k] = z[k];
+      out[k] = 0;
+   }
+
+   for (i = 0; i < n; i++) {
+      noise3_batch(idx, px, py, pz, count, val);
+      for (k = 0; k < count; k++) {
+         out[k] += val[k] / scale;
+         px[k] *= beta;
+         py[k] *= beta;
+         pz[k] *= beta;
+      }
+      scale *= alpha;
+   }
+
+   free(px);
+}
+
 /* Ridged multifractal terrain model.
  *
  * Copyright 1994 F. Kenton Musgrave 
@@ -30,6 +30,17 @@ void normalize2(double *);
 double PerlinNoise1D(int idx, double,double,double,int);
 double PerlinNoise2D(int idx, double,double,double,double,int);
 double PerlinNoise3D(int idx, double,double,double,double,double,int);
+/* Kernels for the batch functions, see perlin_batch_mode(). */
+#define PERLIN_BATCH_AUTO   0
+#define PERLIN_BATCH_SCALAR 1
+#define PERLIN_BATCH_SSE2   2
+#define PERLIN_BATCH_AVX2   3
+
+int perlin_batch_mode(int mode);
+void PerlinNoise2DBatch(int idx, const double *x, const double *y, int count,
+                        double alpha, double beta, int n, double *out);
+void PerlinNoise3DBatch(int idx, const double *x, const double *y, const double *z, int count,
+                        double alpha, double beta, int n, double *out);
 double RidgedMultifractal2D( int idx, double x, double y, double H, double lacunarity,
                              double octaves, double offset, double gain );
 
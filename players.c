@@ -75,6 +75,7 @@ static void load_praytimes(FILE *fl, struct char_data *ch);
 static void load_quests(FILE *fl, struct char_data *ch);
 static void load_HMVS(struct char_data *ch, const char *line, int mode);
 static void write_aliases_ascii(FILE *file, struct char_data *ch);
+static void write_event_ascii(FILE *file, struct mud_event_data *pMudEvent);
 static void read_aliases_ascii(FILE *file, struct char_data *ch, int count);
 static void load_bombs(FILE *fl, struct char_data *ch);
 static void load_discoveries(FILE *fl, struct char_data *ch);
@@ -304,6 +305,7 @@ int load_char(const char *name, struct char_data *ch) {
 
     /* Character initializations. Necessary to keep some things straight. */
     ch->affected = NULL;
+    affects_changed(ch);
     for (i = 0; i < MAX_CLASSES; i++) {
       CLASS_LEVEL(ch, i) = 0;
       GET_SPEC_ABIL(ch, i) = 0;
@@ -701,7 +703,7 @@ int load_char(const char *name, struct char_data *ch) {
               t = read_trigger(t_rnum);
               if (!SCRIPT(ch))
                 CREATE(SCRIPT(ch), struct script_data, 1);
-              add_trigger(SCRIPT(ch), t, -1);
+              add_trigger(SCRIPT(ch), t, -1, ch, MOB_TRIGGER);
             }
           } else if (!strcmp(tag, "Trns")) GET_TRAINS(ch) = atoi(line);
           else if (!strcmp(tag, "Todo")) {
@@ -1252,100 +1254,100 @@ void save_char(struct char_data * ch, int mode) {
     /* Save events */
     /* Not going to save every event */
     fprintf(fl, "Evnt:\n");
-    /* Order:  Event-ID   Duration */
+    /* Order:  Event-ID   Duration   [Number] */
     /* eSTRUGGLE - don't need to save this */
     if ((pMudEvent = char_has_mud_event(ch, eVANISHED)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eVANISH)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eTAUNT)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eTAUNTED)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eINTIMIDATED)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eINTIMIDATE_COOLDOWN)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eRAGE)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eMUTAGEN)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eCRIPPLING_CRITICAL)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eDEFENSIVE_STANCE)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eCRYSTALFIST)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eCRYSTALBODY)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eSLA_LEVITATE)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eSLA_DARKNESS)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eSLA_FAERIE_FIRE)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eLAYONHANDS)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eEMPTYBODY)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eWHOLENESSOFBODY)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eRENEWEDDEFENSE)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eRENEWEDVIGOR)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eTREATINJURY)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eMUMMYDUST)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eDRAGONKNIGHT)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eGREATERRUIN)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eHELLBALL)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eEPICMAGEARMOR)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eEPICWARDING)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eDEATHARROW)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eQUIVERINGPALM)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eANIMATEDEAD)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eSTUNNINGFIST)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eSUPRISE_ACCURACY)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eCOME_AND_GET_ME)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, ePOWERFUL_BLOW)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eD_ROLL)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eLAST_WORD)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, ePURIFY)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eC_ANIMAL)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eC_FAMILIAR)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eC_MOUNT)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eTURN_UNDEAD)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eSPELLBATTLE)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eQUEST_COMPLETE)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eDRACBREATH)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eDRACCLAWS)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     if ((pMudEvent = char_has_mud_event(ch, eARCANEADEPT)))
-      fprintf(fl, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+      write_event_ascii(fl, pMudEvent);
     fprintf(fl, "-1 -1\n");
   }
 
@@ -1982,15 +1984,26 @@ void load_skill_focus(FILE *fl, struct char_data *ch) {
   } while (skill != -1);
 }
 
+/* An event is saved as its id and time left, followed by its number if it
+ * carries one (the uses on a daily-use cooldown, for instance).  Files
+ * written before events carried numbers simply lack the third field. */
+static void write_event_ascii(FILE *file, struct mud_event_data *pMudEvent) {
+  if (mud_event_has_num(pMudEvent))
+    fprintf(file, "%d %ld %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent), pMudEvent->iVar);
+  else
+    fprintf(file, "%d %ld\n", pMudEvent->iId, event_time(pMudEvent->pEvent));
+}
+
 static void load_events(FILE *fl, struct char_data *ch) {
   int num = 0;
-  long num2 = 0;
+  long num2 = 0, num3 = 0;
   char line[MAX_INPUT_LENGTH + 1];
 
   do {
     get_line(fl, line);
-    sscanf(line, "%d %ld", &num, &num2);
-    if (num != -1)
+    if (sscanf(line, "%d %ld %ld", &num, &num2, &num3) == 3)
+      attach_mud_event(new_mud_event_num(num, ch, num3), num2);
+    else if (num != -1)
       attach_mud_event(new_mud_event(num, ch, NULL), num2);
   } while (num != -1);
 }
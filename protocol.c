@@ -21,6 +21,8 @@
 #include "dg_scripts.h"
 #include "act.h"
 #include "modify.h"
+#include "config.h"
+#include <zlib.h>
 
 /* Globals */
 const char * RGBone = "F022";
@@ -30,7 +32,7 @@ const char * RGBthree = "F555";
 static void Write(descriptor_t *apDescriptor, const char *apData) {
   if (apDescriptor != NULL && apDescriptor->has_prompt) {
     if (apDescriptor->pProtocol->WriteOOB > 0 ||
-            *(apDescriptor->output) == '\0') {
+            apDescriptor->bufptr == 0) {
       apDescriptor->pProtocol->WriteOOB = 2;
     }
   }
@@ -48,24 +50,262 @@ static void InfoMessage(descriptor_t *apDescriptor, const char *apData) {
   apDescriptor->pProtocol->WriteOOB = 0;
 }
 
+/******************************************************************************
+ MCCP.  Version 2 compresses what we send once the client agrees to it, and
+ version 3 lets the client compress what it sends us.  Output is compressed
+ when it is written to the socket (see write_to_client() in comm.c) and
+ input is decompressed in ProtocolInput().
+ ******************************************************************************/
+
+struct mccp_t
+{
+   z_stream          Out;         /* Deflate state, while bOut */
+   z_stream          In;          /* Inflate state, while bIn */
+   bool_t            bOut;
+   bool_t            bIn;
+   bool_t            bWantOut;    /* What negotiation asked for; see CompressUpdate */
+   int               OutError;    /* zlib error that stopped output; see CompressReport */
+   const char       *pOutErrorIn; /* and the call that returned it */
+   char             *pPending;    /* Bytes for the socket ahead of anything else */
+   int               PendingLen;
+   int               PendingSize;
+   compress_stats_t  OutStats;
+   compress_stats_t  InStats;
+};
+
+static double CpuSeconds(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/* bOut and OutStats are written by whatever writes to the socket, which may
+ * be the network thread, and read by the game for "show compression".  Each
+ * field is stored and loaded whole, so the game never sees a torn value. */
+static void AddOutStats(mccp_t *pMCCP, int aIn, int aOut, double aCpuSeconds) {
+  double CpuSeconds = pMCCP->OutStats.CpuSeconds + aCpuSeconds;
+
+  __atomic_store_n(&pMCCP->OutStats.BytesIn, pMCCP->OutStats.BytesIn + aIn, __ATOMIC_RELAXED);
+  __atomic_store_n(&pMCCP->OutStats.BytesOut, pMCCP->OutStats.BytesOut + aOut, __ATOMIC_RELAXED);
+  __atomic_store(&pMCCP->OutStats.CpuSeconds, &CpuSeconds, __ATOMIC_RELAXED);
+}
+
+static void AddPending(mccp_t *pMCCP, const char *apData, int aLength) {
+  if (pMCCP->PendingLen + aLength > pMCCP->PendingSize) {
+    pMCCP->PendingSize = MAX(pMCCP->PendingLen + aLength, pMCCP->PendingSize * 2);
+    RECREATE(pMCCP->pPending, char, pMCCP->PendingSize);
+  }
+  memcpy(pMCCP->pPending + pMCCP->PendingLen, apData, aLength);
+  pMCCP->PendingLen += aLength;
+}
+
+/* Runs the deflate stream over the data with the given flush mode, adding
+ * whatever comes out to the pending data. */
+static bool_t Deflate(mccp_t *pMCCP, const char *apData, int aLength, int aFlush) {
+  char Buffer[MAX_SOCK_BUF];
+  double Start = CpuSeconds();
+  int Result, Length, Total = 0;
+
+  pMCCP->Out.next_in = (Bytef *) apData;
+  pMCCP->Out.avail_in = aLength;
+
+  do {
+    pMCCP->Out.next_out = (Bytef *) Buffer;
+    pMCCP->Out.avail_out = sizeof (Buffer);
+    Result = deflate(&pMCCP->Out, aFlush);
+    if (Result != Z_OK && Result != Z_STREAM_END && Result != Z_BUF_ERROR) {
+      pMCCP->OutError = Result;
+      pMCCP->pOutErrorIn = "deflate()";
+      return false;
+    }
+    Length = sizeof (Buffer) - pMCCP->Out.avail_out;
+    AddPending(pMCCP, Buffer, Length);
+    Total += Length;
+  } while (pMCCP->Out.avail_out == 0);
+
+  AddOutStats(pMCCP, aLength, Total, CpuSeconds() - Start);
+  return true;
+}
+
+/* Output compression is only asked for here; whoever writes to the socket,
+ * which may be the network thread, starts or ends the stream between two
+ * writes (see CompressUpdate). */
 static void CompressStart(descriptor_t *apDescriptor) {
-  /* If your mud uses MCCP (Mud Client Compression Protocol), you need to
-   * call whatever function normally starts compression from here - the
-   * ReportBug() call should then be deleted.
-   *
-   * Otherwise you can just ignore this function.
-   */
-  ReportBug("CompressStart() in protocol.c is being called, but it doesn't do anything!\n");
+  __atomic_store_n(&apDescriptor->pProtocol->pMCCP->bWantOut, true, __ATOMIC_RELAXED);
 }
 
 static void CompressEnd(descriptor_t *apDescriptor) {
-  /* If your mud uses MCCP (Mud Client Compression Protocol), you need to
-   * call whatever function normally starts compression from here - the
-   * ReportBug() call should then be deleted.
-   *
-   * Otherwise you can just ignore this function.
-   */
-  ReportBug("CompressEnd() in protocol.c is being called, but it doesn't do anything!\n");
+  __atomic_store_n(&apDescriptor->pProtocol->pMCCP->bWantOut, false, __ATOMIC_RELAXED);
+}
+
+static void DecompressStart(descriptor_t *apDescriptor) {
+  mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+
+  if (pMCCP->bIn)
+    return;
+
+  memset(&pMCCP->In, 0, sizeof (pMCCP->In));
+  if (inflateInit(&pMCCP->In) != Z_OK) {
+    log("SYSERR: MCCP: inflateInit() failed for %s.", apDescriptor->host);
+    return;
+  }
+  pMCCP->bIn = true;
+}
+
+static void DecompressEnd(descriptor_t *apDescriptor) {
+  mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+
+  if (pMCCP == NULL || !pMCCP->bIn)
+    return;
+
+  inflateEnd(&pMCCP->In);
+  pMCCP->bIn = false;
+}
+
+/* Inflates what the client sent into a buffer of our own and points *apData
+ * at it.  If the client ends its compressed stream part way through, the
+ * rest is passed on as it is.  Returns the new size, or -1 on bad data. */
+static ssize_t Decompress(descriptor_t *apDescriptor, char **apData, int aSize) {
+  static char Inflated[MAX_PROTOCOL_BUFFER + 4];
+  static char Raw[MAX_PROTOCOL_BUFFER];
+  mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+  double Start = CpuSeconds();
+  ssize_t Size;
+  int Result;
+
+  /* A stream restarted after one that ended in this same read. */
+  if (*apData >= Inflated && *apData < Inflated + sizeof (Inflated)) {
+    memcpy(Raw, *apData, aSize);
+    *apData = Raw;
+  }
+
+  pMCCP->In.next_in = (Bytef *) *apData;
+  pMCCP->In.avail_in = aSize;
+  pMCCP->In.next_out = (Bytef *) Inflated;
+  pMCCP->In.avail_out = MAX_PROTOCOL_BUFFER;
+
+  Result = inflate(&pMCCP->In, Z_SYNC_FLUSH);
+  Size = MAX_PROTOCOL_BUFFER - pMCCP->In.avail_out;
+
+  pMCCP->InStats.BytesIn += aSize - pMCCP->In.avail_in;
+  pMCCP->InStats.BytesOut += Size;
+  pMCCP->InStats.CpuSeconds += CpuSeconds() - Start;
+
+  if (Result == Z_STREAM_END) {
+    int Rest = pMCCP->In.avail_in;
+
+    DecompressEnd(apDescriptor);
+    if (Size + Rest > MAX_PROTOCOL_BUFFER) {
+      ReportBug("ProtocolInput: Too much incoming data to store in the buffer.\n");
+      return (-1);
+    }
+    memcpy(Inflated + Size, *apData + aSize - Rest, Rest);
+    Size += Rest;
+  } else if (Result != Z_OK && Result != Z_BUF_ERROR) {
+    log("MCCP: bad compressed data from %s (%d), disconnecting.", apDescriptor->host, Result);
+    DecompressEnd(apDescriptor);
+    return (-1);
+  } else if (pMCCP->In.avail_in > 0) {
+    ReportBug("ProtocolInput: Too much incoming data to store in the buffer.\n");
+    return (-1);
+  }
+
+  memset(Inflated + Size, 0, 4); /* ProtocolInput() looks a few bytes ahead */
+  *apData = Inflated;
+  return (Size);
+}
+
+bool_t CompressUpdate(descriptor_t *apDescriptor) {
+  const char StartMCCP[] = {(char) IAC, (char) SB, TELOPT_MCCP, (char) IAC, (char) SE};
+  mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+  bool_t bWantOut = __atomic_load_n(&pMCCP->bWantOut, __ATOMIC_RELAXED);
+  bool_t bResult = true;
+  int Result;
+
+  if (bWantOut && !pMCCP->bOut) {
+    memset(&pMCCP->Out, 0, sizeof (pMCCP->Out));
+    if ((Result = deflateInit(&pMCCP->Out, MIN(MAX(mccp_compression_level, 1), 9))) != Z_OK) {
+      pMCCP->OutError = Result;
+      pMCCP->pOutErrorIn = "deflateInit()";
+      __atomic_store_n(&pMCCP->bWantOut, false, __ATOMIC_RELAXED);
+      return false;
+    }
+
+    /* The start sequence is the last thing the client gets uncompressed, so
+     * it goes out ahead of anything still waiting to be written; that will
+     * be compressed along with everything after it. */
+    AddPending(pMCCP, StartMCCP, sizeof (StartMCCP));
+    __atomic_store_n(&pMCCP->bOut, true, __ATOMIC_RELAXED);
+  } else if (!bWantOut && pMCCP->bOut) {
+    /* Finishing the stream tells the client that what follows is plain. */
+    bResult = Deflate(pMCCP, "", 0, Z_FINISH);
+    deflateEnd(&pMCCP->Out);
+    __atomic_store_n(&pMCCP->bOut, false, __ATOMIC_RELAXED);
+  }
+
+  return bResult;
+}
+
+void CompressReport(descriptor_t *apDescriptor) {
+  mccp_t *pMCCP = apDescriptor->pProtocol ? apDescriptor->pProtocol->pMCCP : NULL;
+
+  if (pMCCP == NULL || pMCCP->OutError == Z_OK)
+    return;
+
+  log("SYSERR: MCCP: %s failed (%d) for %s.", pMCCP->pOutErrorIn, pMCCP->OutError, apDescriptor->host);
+  pMCCP->OutError = Z_OK;
+}
+
+bool_t CompressOutput(descriptor_t *apDescriptor, const char *apData, int aLength, bool_t abFlush) {
+  mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+
+  if (pMCCP == NULL || !pMCCP->bOut)
+    return false;
+
+  return Deflate(pMCCP, apData, aLength, abFlush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+}
+
+bool_t CompressActive(descriptor_t *apDescriptor) {
+  mccp_t *pMCCP = apDescriptor->pProtocol ? apDescriptor->pProtocol->pMCCP : NULL;
+
+  return (pMCCP != NULL && __atomic_load_n(&pMCCP->bOut, __ATOMIC_RELAXED));
+}
+
+const char *CompressPending(descriptor_t *apDescriptor, int *apLength) {
+  mccp_t *pMCCP = apDescriptor->pProtocol ? apDescriptor->pProtocol->pMCCP : NULL;
+
+  if (pMCCP == NULL || pMCCP->PendingLen == 0)
+    return NULL;
+
+  if (apLength != NULL)
+    *apLength = pMCCP->PendingLen;
+  return pMCCP->pPending;
+}
+
+void CompressSent(descriptor_t *apDescriptor, int aLength) {
+  mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+
+  if (aLength >= pMCCP->PendingLen)
+    pMCCP->PendingLen = 0;
+  else {
+    memmove(pMCCP->pPending, pMCCP->pPending + aLength, pMCCP->PendingLen - aLength);
+    pMCCP->PendingLen -= aLength;
+  }
+}
+
+bool_t CompressStats(descriptor_t *apDescriptor, compress_stats_t *apOut, compress_stats_t *apIn) {
+  mccp_t *pMCCP = apDescriptor->pProtocol ? apDescriptor->pProtocol->pMCCP : NULL;
+
+  if (pMCCP == NULL)
+    return false;
+
+  apOut->BytesIn = __atomic_load_n(&pMCCP->OutStats.BytesIn, __ATOMIC_RELAXED);
+  apOut->BytesOut = __atomic_load_n(&pMCCP->OutStats.BytesOut, __ATOMIC_RELAXED);
+  __atomic_load(&pMCCP->OutStats.CpuSeconds, &apOut->CpuSeconds, __ATOMIC_RELAXED);
+  *apIn = pMCCP->InStats;
+
+  return (CompressActive(apDescriptor) || pMCCP->bIn || apOut->BytesIn > 0 || apIn->BytesIn > 0);
 }
 
 /******************************************************************************
@@ -306,6 +546,10 @@ protocol_t *ProtocolCreate(void) {
   pProtocol->bMSP = false;
   pProtocol->bMXP = false;
   pProtocol->bMCCP = false;
+  pProtocol->bMCCP3 = false;
+  /* Made up front rather than on first use, so that the network thread
+   * never sees it appear. */
+  CREATE(pProtocol->pMCCP, mccp_t, 1);
   pProtocol->b256Support = eUNKNOWN;
   pProtocol->ScreenWidth = 0;
   pProtocol->ScreenHeight = 0;
@@ -348,6 +592,15 @@ void ProtocolDestroy(protocol_t *apProtocol) {
   if (apProtocol->pLastTTYPE) /* Isn't saved over copyover so may still be NULL */
     free(apProtocol->pLastTTYPE);
   free(apProtocol->pMXPVersion);
+  if (apProtocol->pMCCP) {
+    if (apProtocol->pMCCP->bOut)
+      deflateEnd(&apProtocol->pMCCP->Out);
+    if (apProtocol->pMCCP->bIn)
+      inflateEnd(&apProtocol->pMCCP->In);
+    if (apProtocol->pMCCP->pPending)
+      free(apProtocol->pMCCP->pPending);
+    free(apProtocol->pMCCP);
+  }
   free(apProtocol);
 }
 
@@ -357,12 +610,20 @@ ssize_t ProtocolInput(descriptor_t *apDescriptor, char *apData, int aSize, char
   ssize_t CmdIndex = 0;
   ssize_t IacIndex = 0;
   ssize_t Index;
+  /* apOut is the descriptor's raw input buffer, which may not be empty, and
+   * decompressed input can be bigger than what was read. */
+  ssize_t CmdRoom = MAX_PROTOCOL_BUFFER - strlen(apOut) - 1;
 
   protocol_t *pProtocol = apDescriptor ? apDescriptor->pProtocol : NULL;
 
+  /* Everything the client sends after starting MCCP3 comes in compressed. */
+  if (pProtocol->pMCCP && pProtocol->pMCCP->bIn &&
+          (aSize = Decompress(apDescriptor, &apData, aSize)) < 0)
+    return (-1);
+
   for (Index = 0; Index < aSize; ++Index) {
     /* If we'd overflow the buffer, we just ignore the input */
-    if (CmdIndex >= MAX_PROTOCOL_BUFFER || IacIndex >= MAX_PROTOCOL_BUFFER) {
+    if (CmdIndex >= CmdRoom || IacIndex >= MAX_PROTOCOL_BUFFER) {
       ReportBug("ProtocolInput: Too much incoming data to store in the buffer.\n");
       return (-1);
     }
@@ -380,7 +641,20 @@ ssize_t ProtocolInput(descriptor_t *apDescriptor, char *apData, int aSize, char
         Index++;
         pProtocol->bIACMode = false;
         IacBuf[IacIndex] = '\0';
-        if (IacIndex >= 2)
+        if (IacIndex == 1 && IacBuf[0] == (char) TELOPT_MCCP3) {
+          /* IAC SB MCCP3 IAC SE: the client compresses from the next byte on,
+           * which may already be in this buffer. */
+          if (pProtocol->bMCCP3 && !(pProtocol->pMCCP && pProtocol->pMCCP->bIn)) {
+            DecompressStart(apDescriptor);
+            if (pProtocol->pMCCP->bIn) {
+              apData += Index + 1;
+              aSize -= Index + 1;
+              if ((aSize = Decompress(apDescriptor, &apData, aSize)) < 0)
+                return (-1);
+              Index = -1;
+            }
+          }
+        } else if (IacIndex >= 2)
           PerformSubnegotiation(apDescriptor, IacBuf[0], &IacBuf[1], IacIndex - 1);
         IacIndex = 0;
       } else
@@ -1011,6 +1285,15 @@ const char *CopyoverGet(descriptor_t *apDescriptor) {
     if (pProtocol->bMCCP) {
       *pBuffer++ = 'c';
       CompressEnd(apDescriptor);
+      CompressUpdate(apDescriptor);
+    }
+    if (pProtocol->pMCCP->bIn) {
+      /* The inflate state can't be carried over, so ask the client to stop
+       * compressing.  Anything it sends before it does is lost. */
+      const char WontMCCP3[] = {(char) IAC, (char) WONT, TELOPT_MCCP3};
+
+      DecompressEnd(apDescriptor);
+      AddPending(pProtocol->pMCCP, WontMCCP3, sizeof (WontMCCP3));
     }
     if (pProtocol->pVariables[eMSDP_XTERM_256_COLORS]->ValueInt)
       *pBuffer++ = 'C';
@@ -1576,6 +1859,7 @@ static void Negotiate(descriptor_t *apDescriptor) {
     ConfirmNegotiation(apDescriptor, eNEGOTIATED_MSP, true, true);
     ConfirmNegotiation(apDescriptor, eNEGOTIATED_MXP, true, true);
     ConfirmNegotiation(apDescriptor, eNEGOTIATED_MCCP, true, true);
+    ConfirmNegotiation(apDescriptor, eNEGOTIATED_MCCP3, true, true);
   }
 }
 
@@ -1773,6 +2057,22 @@ static void PerformHandshake(descriptor_t *apDescriptor, char aCmd, char aProtoc
       }
       break;
 
+    case (char) TELOPT_MCCP3:
+      /* The client starts compressing with IAC SB MCCP3 IAC SE when it is
+       * ready; see ProtocolInput(). */
+      if (aCmd == (char) DO) {
+        ConfirmNegotiation(apDescriptor, eNEGOTIATED_MCCP3, true, true);
+        pProtocol->bMCCP3 = true;
+      } else if (aCmd == (char) DONT) {
+        ConfirmNegotiation(apDescriptor, eNEGOTIATED_MCCP3, false, pProtocol->bMCCP3);
+        pProtocol->bMCCP3 = false;
+        DecompressEnd(apDescriptor);
+      } else if (aCmd == (char) WILL) {
+        /* Invalid negotiation, send a rejection */
+        SendNegotiationSequence(apDescriptor, (char) DONT, (char) aProtocol);
+      }
+      break;
+
     case (char) TELOPT_MSP:
       if (aCmd == (char) DO) {
         ConfirmNegotiation(apDescriptor, eNEGOTIATED_MSP, true, true);
@@ -2268,6 +2568,11 @@ static bool_t ConfirmNegotiation(descriptor_t *apDescriptor, negotiated_t aProto
           case eNEGOTIATED_MCCP:
 #ifdef USING_MCCP
             SendNegotiationSequence(apDescriptor, abWillDo ? WILL : WONT, TELOPT_MCCP);
+#endif /* USING_MCCP */
+            break;
+          case eNEGOTIATED_MCCP3:
+#ifdef USING_MCCP
+            SendNegotiationSequence(apDescriptor, abWillDo ? WILL : WONT, TELOPT_MCCP3);
 #endif /* USING_MCCP */
             break;
           default:
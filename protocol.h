@@ -39,9 +39,7 @@ typedef struct descriptor_data descriptor_t;
  If your mud supports MCCP (compression), uncomment the next line.
  ******************************************************************************/
 
-/*
 #define USING_MCCP
-*/
 
 /******************************************************************************
  If your offer a Mudlet GUI for autoinstallation, put the path/filename here.
@@ -70,6 +68,7 @@ typedef struct descriptor_data descriptor_t;
 #define TELOPT_MSDP                    69
 #define TELOPT_MSSP                    70
 #define TELOPT_MCCP                    86 /* This is MCCP version 2 */
+#define TELOPT_MCCP3                   87 /* MCCP version 3, client to server */
 #define TELOPT_MSP                     90
 #define TELOPT_MXP                     91
 #define TELOPT_GMCP                    201
@@ -112,6 +111,7 @@ typedef enum
    eNEGOTIATED_MXP,
    eNEGOTIATED_MXP2,
    eNEGOTIATED_MCCP,
+   eNEGOTIATED_MCCP3,
 
    eNEGOTIATED_MAX             /* This must always be last */
 } negotiated_t;
@@ -247,6 +247,16 @@ typedef struct
    const char  *(*pFunction)();/* Optional function to return the value */
 } MSSP_t;
 
+/* Running totals for one direction of MCCP on one connection. */
+typedef struct
+{
+   unsigned long BytesIn;      /* Bytes handed to zlib */
+   unsigned long BytesOut;     /* Bytes zlib handed back */
+   double        CpuSeconds;   /* CPU time spent in zlib */
+} compress_stats_t;
+
+typedef struct mccp_t mccp_t;  /* zlib state, private to protocol.c */
+
 typedef struct
 {
    int       WriteOOB;         /* Used internally to indicate OOB data */
@@ -266,6 +276,8 @@ typedef struct
    bool_t    bMSP;             /* The client supports MSP */
    bool_t    bMXP;             /* The client supports MXP */
    bool_t    bMCCP;            /* The client supports MCCP */
+   bool_t    bMCCP3;           /* The client supports MCCP version 3 */
+   mccp_t   *pMCCP;            /* Compression state, NULL until needed */
    support_t b256Support;      /* The client supports XTerm 256 colors */
    int       ScreenWidth;      /* The client's screen width */
    int       ScreenHeight;     /* The client's screen height */
@@ -398,6 +410,62 @@ ssize_t ProtocolInput( descriptor_t *apDescriptor, char *apData, int aSize, char
  */
 const char *ProtocolOutput( descriptor_t *apDescriptor, const char *apData, int *apLength );
 
+/******************************************************************************
+ MCCP functions.
+ ******************************************************************************/
+
+/* Function: CompressUpdate
+ *
+ * Starts or ends the compressed output stream if negotiation has asked for
+ * that since the last write.  Whatever writes to the descriptor's socket
+ * calls this first, so the switch always falls between two writes.
+ *
+ * Returns false if zlib failed, and the connection should be dropped.
+ */
+bool_t CompressUpdate( descriptor_t *apDescriptor );
+
+/* Function: CompressReport
+ *
+ * Logs the zlib error, if any, that made CompressUpdate or CompressOutput
+ * fail.  Those may run on the network thread, which can't log, so they only
+ * record it; the game calls this when it closes the connection.
+ */
+void CompressReport( descriptor_t *apDescriptor );
+
+/* Function: CompressOutput
+ *
+ * Compresses the data for a descriptor that has MCCP turned on.  If abFlush
+ * is set the stream is flushed so the client can show all of it right away;
+ * several pieces of text can go in unflushed with only the last one flushed.
+ * The result is added to the descriptor's pending data (see CompressPending).
+ * Returns false if compression failed, in which case the connection should
+ * be dropped.
+ */
+bool_t CompressOutput( descriptor_t *apDescriptor, const char *apData, int aLength, bool_t abFlush );
+
+/* Function: CompressActive
+ *
+ * Returns true if output to this descriptor is being compressed.
+ */
+bool_t CompressActive( descriptor_t *apDescriptor );
+
+/* Function: CompressPending
+ *
+ * Returns the data that must go out on the descriptor's socket before
+ * anything else: the MCCP start sequence and compressed output the socket
+ * has not yet taken.  Returns NULL if there is none, otherwise stores its
+ * length in *apLength.  Call CompressSent once some of it has been written.
+ */
+const char *CompressPending( descriptor_t *apDescriptor, int *apLength );
+void CompressSent( descriptor_t *apDescriptor, int aLength );
+
+/* Function: CompressStats
+ *
+ * Fills in the totals for output (MCCP v2) and input (MCCP v3) compression
+ * on the descriptor.  Returns false if it has never used either.
+ */
+bool_t CompressStats( descriptor_t *apDescriptor, compress_stats_t *apOut, compress_stats_t *apIn );
+
 /******************************************************************************
  Copyover save/load functions.
  ******************************************************************************/
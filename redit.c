@@ -193,6 +193,7 @@ void redit_setup_existing(struct descriptor_data *d, int real_num)
 
   /* Nullify the events structure. */
   room->events = NULL;
+  room->events_by_id = NULL;
 
   /* Allocate space for all strings. */
   room->name = str_udup(world[real_num].name);
@@ -315,35 +315,219 @@ const char *skill_name(int num) {
     return ("Non-Spell-Effect");
 }
 
+/* Does name pick out spell_info[skindex]?  Either it abbreviates the whole
+ * name, or each of its words abbreviates the matching word of the name, as
+ * "mag mis" does "magic missile". */
+static bool skill_name_matches(char *name, int skindex) {
+  int ok;
+  char *temp, *temp2;
+  char first[MEDIUM_STRING], first2[MEDIUM_STRING], tempbuf[MEDIUM_STRING];
+
+  if (is_abbrev(name, spell_info[skindex].name))
+    return (TRUE);
+
+  ok = TRUE;
+  strlcpy(tempbuf, spell_info[skindex].name, sizeof (tempbuf)); /* strlcpy: OK */
+  temp = any_one_arg(tempbuf, first);
+  temp2 = any_one_arg(name, first2);
+  while (*first && *first2 && ok) {
+    if (!is_abbrev(first2, first))
+      ok = FALSE;
+    temp = any_one_arg(temp, first);
+    temp2 = any_one_arg(temp2, first2);
+  }
+
+  return (ok && !*first2);
+}
+
+static int scan_skill_num(char *name) {
+  int skindex;
+
+  for (skindex = 1; skindex <= TOP_SPELL_DEFINE; skindex++)
+    if (skill_name_matches(name, skindex))
+      return (skindex);
+
+  return (-1);
+}
+
+/* The skill name index.  Whatever name matches, its first word abbreviates
+ * the first word of the spell's name, so every abbreviation of every first
+ * word is listed with the spells it could start, in spell number order.
+ * find_skill_num() only has to try those, and for a single word the first
+ * one tried is the answer. */
+struct skill_abbrev {
+  char *abbrev;
+  int *skills;    /* in spell number order */
+  int num_skills;
+};
+
+static struct skill_abbrev *skill_index = NULL;
+static int num_skill_abbrevs = 0;
+
+#ifdef CHECK_SKILL_INDEX
+static void check_skill_index(void);
+#endif
+
+/* One (spell, length of first word prefix) pair while building. */
+struct skill_prefix {
+  int skindex;
+  int len;
+  char word[MEDIUM_STRING];
+};
+
+static int skill_prefix_cmp(const void *a, const void *b) {
+  const struct skill_prefix *pa = (const struct skill_prefix *) a;
+  const struct skill_prefix *pb = (const struct skill_prefix *) b;
+  int cmp = strcmp(pa->word, pb->word);
+
+  return (cmp ? cmp : pa->skindex - pb->skindex);
+}
+
+/* Called once spell_info has its names, at the end of mag_assign_spells(). */
+void build_skill_index(void) {
+  struct skill_prefix *prefixes;
+  struct skill_abbrev *ab;
+  char first[MEDIUM_STRING], tempbuf[MEDIUM_STRING];
+  int skindex, len, num = 0, i, j;
+
+  for (i = 0; i < num_skill_abbrevs; i++) {
+    free(skill_index[i].abbrev);
+    free(skill_index[i].skills);
+  }
+  if (skill_index)
+    free(skill_index);
+  skill_index = NULL;
+  num_skill_abbrevs = 0;
+
+  for (skindex = 1; skindex <= TOP_SPELL_DEFINE; skindex++) {
+    strlcpy(tempbuf, spell_info[skindex].name, sizeof (tempbuf));
+    any_one_arg(tempbuf, first);
+    num += strlen(first);
+  }
+
+  CREATE(prefixes, struct skill_prefix, num);
+  for (num = 0, skindex = 1; skindex <= TOP_SPELL_DEFINE; skindex++) {
+    strlcpy(tempbuf, spell_info[skindex].name, sizeof (tempbuf));
+    any_one_arg(tempbuf, first);
+    for (len = strlen(first); len > 0; len--) {
+      prefixes[num].skindex = skindex;
+      prefixes[num].len = len;
+      strlcpy(prefixes[num++].word, first, len + 1);
+    }
+  }
+
+  qsort(prefixes, num, sizeof (struct skill_prefix), skill_prefix_cmp);
+
+  CREATE(skill_index, struct skill_abbrev, num);
+  for (i = 0; i < num; i = j) {
+    for (j = i + 1; j < num && !strcmp(prefixes[j].word, prefixes[i].word); j++)
+      ;
+
+    ab = &skill_index[num_skill_abbrevs++];
+    ab->abbrev = strdup(prefixes[i].word);
+    CREATE(ab->skills, int, j - i);
+    for (ab->num_skills = 0; ab->num_skills < j - i; ab->num_skills++)
+      ab->skills[ab->num_skills] = prefixes[i + ab->num_skills].skindex;
+  }
+  RECREATE(skill_index, struct skill_abbrev, num_skill_abbrevs);
+
+  free(prefixes);
+
+#ifdef CHECK_SKILL_INDEX
+  check_skill_index();
+#endif
+}
+
 /* send a string that is theortically the name of a spell/skill, return
    the spell/skill number
  */
 int find_skill_num(char *name) {
-  int skindex, ok;
-  char *temp, *temp2;
-  char first[MEDIUM_STRING], first2[MEDIUM_STRING], tempbuf[MEDIUM_STRING];
+  char first[MEDIUM_STRING];
+  int bot, top, mid, cmp, i;
+
+  /* A name that starts with a space can still abbreviate one that does too,
+   * and the index knows nothing of those. */
+  if (!skill_index || !*name || isspace(*name))
+    return (scan_skill_num(name));
+
+  for (i = 0; name[i] && !isspace(name[i]); i++) {
+    if (i == sizeof (first) - 1)
+      return (-1); /* longer than any name */
+    first[i] = LOWER(name[i]);
+  }
+  first[i] = '\0';
+
+  bot = 0;
+  top = num_skill_abbrevs - 1;
+  while (bot <= top) {
+    mid = (bot + top) / 2;
+    if (!(cmp = strcmp(first, skill_index[mid].abbrev))) {
+      for (i = 0; i < skill_index[mid].num_skills; i++)
+        if (skill_name_matches(name, skill_index[mid].skills[i]))
+          return (skill_index[mid].skills[i]);
+      break;
+    }
+    if (cmp < 0)
+      top = mid - 1;
+    else
+      bot = mid + 1;
+  }
+
+  return (-1);
+}
+
+/* Build with -DCHECK_SKILL_INDEX to have the index checked against a plain
+ * scan of spell_info when it is built. */
+#ifdef CHECK_SKILL_INDEX
+static void check_skill_index_name(char *name, int *checked, int *bad) {
+  int fast = find_skill_num(name), slow = scan_skill_num(name);
+
+  (*checked)++;
+  if (fast != slow && (*bad)++ < 20)
+    log("SYSERR: skill index resolves '%s' to %d, the scan to %d.", name, fast, slow);
+}
+
+/* Tries every prefix of every name, the same in upper case, every name with
+ * each word cut to its first n letters, and a few odd shapes. */
+static void check_skill_index(void) {
+  char name[MEDIUM_STRING], abbr[MEDIUM_STRING], *p, *q;
+  int skindex, len, cut, checked = 0, bad = 0;
 
   for (skindex = 1; skindex <= TOP_SPELL_DEFINE; skindex++) {
-    if (is_abbrev(name, spell_info[skindex].name))
-      return (skindex);
+    strlcpy(name, spell_info[skindex].name, sizeof (name));
+
+    for (len = strlen(name); len >= 0; len--) {
+      name[len] = '\0';
+      check_skill_index_name(name, &checked, &bad);
+      for (p = name; *p; p++)
+        *p = UPPER(*p);
+      check_skill_index_name(name, &checked, &bad);
+      strlcpy(name, spell_info[skindex].name, sizeof (name));
+    }
 
-    ok = TRUE;
-    strlcpy(tempbuf, spell_info[skindex].name, sizeof (tempbuf)); /* strlcpy: OK */
-    temp = any_one_arg(tempbuf, first);
-    temp2 = any_one_arg(name, first2);
-    while (*first && *first2 && ok) {
-      if (!is_abbrev(first2, first))
-        ok = FALSE;
-      temp = any_one_arg(temp, first);
-      temp2 = any_one_arg(temp2, first2);
+    for (cut = 1; cut < 6; cut++) {
+      for (p = name, q = abbr; *p;) {
+        for (len = 0; *p && !isspace(*p); p++)
+          if (len++ < cut)
+            *q++ = *p;
+        for (; *p && isspace(*p); p++)
+          *q++ = ' ';
+      }
+      *q = '\0';
+      check_skill_index_name(abbr, &checked, &bad);
     }
 
-    if (ok && !*first2)
-      return (skindex);
+    snprintf(abbr, sizeof (abbr), " %s", name);
+    check_skill_index_name(abbr, &checked, &bad);
+    snprintf(abbr, sizeof (abbr), "%s x", name);
+    check_skill_index_name(abbr, &checked, &bad);
+    snprintf(abbr, sizeof (abbr), "%sx", name);
+    check_skill_index_name(abbr, &checked, &bad);
   }
 
-  return (-1);
+  log("Skill index checked: %d lookups, %d mismatches.", checked, bad);
 }
+#endif
 
 /* send a string that is theortically the name of an ability, return
    the ability number
@@ -3176,6 +3360,7 @@ void mag_assign_spells(void) {
 
   /****note weapon specialist and luck of heroes inserted in free slots ***/
 
+  build_skill_index();
 }
 
 /* must be at end of file */
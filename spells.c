@@ -1733,6 +1733,7 @@ ASPELL(spell_wizard_eye) {
   ch->desc->original = ch;
   eye->desc = ch->desc;
   ch->desc = NULL;
+  zone_occupant_changed(eye);
 }
 
 #define ZOCMD zone_table[zrnum].cmd[subcmd]
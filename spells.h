@@ -1097,6 +1097,7 @@ ASPELL(spell_wizard_eye);
 
 /* basic magic calling functions */
 int find_skill_num(char *name);
+void build_skill_index(void);
 int find_ability_num(char *name);
 
 int mag_damage(int level, struct char_data *ch, struct char_data *victim,
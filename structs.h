@@ -2639,7 +2639,7 @@
 #define MAX_SOCK_BUF       (24 * 1024) /**< Size of kernel's sock buf   */
 #define MAX_PROMPT_LENGTH  400         /**< Max length of prompt        */
 #define GARBAGE_SPACE      32          /**< Space for **OVERFLOW** etc  */
-#define SMALL_BUFSIZE      1024        /**< Static output buffer size   */
+#define OUT_BLOCK_SIZE     2048        /**< Size of pooled output blocks */
 /** Max amount of output that can be buffered */
 #define LARGE_BUFSIZE      (MAX_SOCK_BUF - GARBAGE_SPACE - MAX_PROMPT_LENGTH)
 
@@ -2857,6 +2857,7 @@ struct obj_data {
     struct obj_spellbook_spell *sbinfo; /* For spellbook info */
 
     struct list_data *events; /**< Used for object events */
+    struct mud_event_data **events_by_id; /**< events, indexed by event_id */
 
     struct obj_special_ability *special_abilities; /**< List used to store special abilities */
 
@@ -2923,6 +2924,7 @@ struct room_direction_data {
 struct raff_node {
     room_rnum room; /* location in the world[] array of the room */
     int timer; /* how many rounds this affection lasts */
+    long round; /* affect_rounds when timer was last updated */
     long affection; /* which affection does this room have */
     int spell; /* the spell number */
     struct char_data *ch; // caster of this affection
@@ -2954,6 +2956,7 @@ struct room_data {
     struct char_data *people; /**< List of NPCs / PCs in room */
 
     struct list_data *events; // room events
+    struct mud_event_data **events_by_id; /**< events, indexed by event_id */
 
     struct trail_data_list *trail_tracks;
     //struct trail_data_list *trail_scent;
@@ -3105,6 +3108,9 @@ struct char_special_data {
     /* combat related */
     int initiative; /* What is this char's initiative score? */
     struct char_data *fighting; /**< Target of fight; else NULL */
+    unsigned long round_due; /**< Pulse of next combat round; 0 if none */
+    room_vnum round_room; /**< Room whose rounds that one is lined up with */
+    int round_phase; /**< Phase perform_violence() is given next, 1 to 3 */
     struct char_data *hunting; /**< Target of NPC hunt; else NULL */
     int totalDefense; // how many totaldefense attempts left in the round
     struct char_data *guarding; //target for 'guard' ability
@@ -3334,6 +3340,10 @@ struct player_special_data {
   char *new_mail_content;
 
   int sticky_bomb[2];
+
+  /* How many worn items grant each feat, see get_feat_value(). */
+  ubyte gear_feats[FEAT_LAST_FEAT];
+  bool gear_feats_valid; /* FALSE once gear may have changed */
 };
 
 /** Special data used by NPCs, not PCs */
@@ -3380,6 +3390,18 @@ struct affected_type {
     sh_int specific;
 };
 
+/** affected_by_spell() answers from a bitmap for spells below this. */
+#define AFF_SNAPSHOT_SPELLS 1024
+
+/** What a character's affected list adds up to, rebuilt on demand after the
+ * list changes. See get_affect_snapshot(). */
+struct affect_snapshot {
+    bool valid; /**< FALSE once the affected list may have changed */
+    int ac_bonuses[NUM_BONUS_TYPES]; /**< APPLY_AC and APPLY_AC_NEW, by bonus type */
+    int ac_applied; /**< What those added to GET_AC(), in 100-point AC */
+    ubyte spells[AFF_SNAPSHOT_SPELLS / 8]; /**< Spells with an affect on the char */
+};
+
 /* The Maximum number of types that can be required to bypass DR. */
 #define MAX_DR_BYPASS 3
 
@@ -3503,6 +3525,8 @@ struct char_data {
     struct mob_special_data mob_specials; /**< NPC specials		  */
 
     struct affected_type *affected; /**< affected by what spells    */
+    struct affect_snapshot aff_snapshot; /**< what 'affected' adds up to */
+    long affect_round; /**< affect_rounds when affected was last updated */
     struct obj_data * equipment[NUM_WEARS]; /**< Equipment array            */
 
     struct obj_data *carrying; /**< List head for objects in inventory */
@@ -3516,6 +3540,8 @@ struct char_data {
     struct char_data *next_in_room; /**< Next PC in the room */
     struct char_data *next; /**< Next char_data in the room */
     struct char_data *next_fighting; /**< Next in line to fight */
+    struct char_data *next_in_zone; /**< Next in zone_data.players */
+    bool in_zone_list; /**< On its zone's players list */
 
     struct follow_type *followers; /**< List of characters following */
     struct char_data *master; /**< List of character being followed */
@@ -3525,6 +3551,7 @@ struct char_data {
     long pref; /**< unique session id */
 
     struct list_data * events;
+    struct mud_event_data **events_by_id; /**< events, indexed by event_id */
 
 };
 
@@ -3541,6 +3568,33 @@ struct txt_q {
     struct txt_block *tail; /**< ? */
 };
 
+/** A pooled block of output text.  Text is copied into a block once, when it
+ * is written to a descriptor, and goes out from there; a snooper's queue
+ * points into the same blocks as its victim's. */
+struct out_block {
+    int refs; /**< spans pointing into this block */
+    struct out_block *next; /**< next in the pool, while free */
+    char text[OUT_BLOCK_SIZE];
+};
+
+/** Part of one block's text queued for a descriptor. */
+struct out_span {
+    struct out_block *block;
+    int start; /**< first byte still to be sent */
+    int end; /**< one past the last */
+    struct out_span *next;
+};
+
+/* What game_loop() has been told a descriptor's socket is ready for. */
+#define DIO_INPUT     (1 << 0) /**< may have input, until a read would block */
+#define DIO_BLOCKED   (1 << 1) /**< send buffer full, waiting to drain */
+#define DIO_ERROR     (1 << 2) /**< error or urgent data, kick them out */
+/* ...and whether it is being held back for it. */
+#define DIO_THROTTLED (1 << 3) /**< too much output waiting, commands held */
+
+/** A descriptor's connection to the network thread (defined in comm.c). */
+struct net_conn;
+
 /** Master structure players. Holds the real players connection to the mud.
  * An analogy is the char_data is the body of the character, the descriptor_data
  * is the soul. */
@@ -3561,15 +3615,15 @@ struct descriptor_data {
     size_t max_str; /**< maximum size of string in modify-str	*/
     long mail_to; /**< name for mail system			*/
     int has_prompt; /**< is the user at a prompt?             */
+    int io_flags; /**< DIO_x readiness of the socket		*/
     char inbuf[MAX_RAW_INPUT_LENGTH]; /**< buffer for raw input		*/
     char last_input[MAX_INPUT_LENGTH]; /**< the last input			*/
-    char small_outbuf[SMALL_BUFSIZE]; /**< standard output buffer		*/
-    char *output; /**< ptr to the current output buffer	*/
+    struct out_span *out_head; /**< output queued to be sent		*/
+    struct out_span *out_tail; /**< where new output is added		*/
+    struct net_conn *conn; /**< network thread's side, if it has one	*/
     char **history; /**< History of commands, for ! mostly.	*/
     int history_pos; /**< Circular array position.		*/
-    int bufptr; /**< ptr to end of current output		*/
-    int bufspace; /**< space left in the output buffer	*/
-    struct txt_block *large_outbuf; /**< ptr to large buffer, if we need it */
+    int bufptr; /**< bytes of output queued or being sent	*/
     struct txt_q input; /**< q of unprocessed input		*/
     struct char_data *character; /**< linked to char			*/
     struct char_data *original; /**< original char if switched		*/
@@ -184,6 +184,20 @@ struct in_addr {
 #include <sys/select.h>
 #endif
 
+/* game_loop() waits on epoll where there is one, unless configured not to. */
+#if defined(HAVE_SYS_EPOLL_H) && !defined(CIRCLE_USE_SELECT)
+#include <sys/epoll.h>
+#define CIRCLE_EPOLL
+#endif
+
+/* ...and hands socket reads and writes to a thread of their own, which
+ * needs epoll too.  zmalloc is not thread safe, so not with MEMORY_DEBUG. */
+#if defined(CIRCLE_EPOLL) && defined(HAVE_PTHREAD_H) && !defined(MEMORY_DEBUG)
+#include <pthread.h>
+#include <sched.h>
+#define CIRCLE_IO_THREAD
+#endif
+
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
@@ -0,0 +1,321 @@
+/* ************************************************************************
+*  file:  actbench.c                                  Part of LuminariMUD *
+*  Usage: time act() sending to a room full of people                    *
+************************************************************************* */
+
+/*
+ * Linked against the game's own objects like combatbench (see the actbench
+ * target in the top level Makefile) rather than built from util/Makefile.
+ *
+ * Puts an attacker, a victim holding a sword and a crowd of onlookers with
+ * descriptors into one room, then sends combat messages to the room with
+ * TO_NOTVICT, the way fight.c does several times a hit.  The actor is
+ * invisible and only some of the crowd can see invisible, so the $n codes
+ * come out both ways.  Each message goes through act() and through a copy
+ * of the act() that scanned the string over again for every onlooker, and
+ * what every onlooker is sent must come out the same from both.
+ *
+ * Usage: actbench [observers] [rounds]
+ *
+ * By default 50 onlookers watch 20000 rounds of four messages.
+ */
+
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "db.h"
+#include "handler.h"
+#include "dg_scripts.h"
+#include "feats.h"
+#include "protocol.h"
+
+/* The act() in comm.c before it broke its strings up ahead of time. */
+static int old_dg_act_check;
+static char *old_last_act_message = NULL;
+
+#define CHECK_NULL(pointer, expression) \
+  if ((pointer) == NULL) i = "<NULL>"; else i = (expression);
+
+static void old_perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
+        void *vict_obj, struct char_data *to, bool carrier_return)
+{
+  const char *i = NULL;
+  char lbuf[MAX_STRING_LENGTH] = {'\0'}, *buf = NULL, *j = NULL;
+  bool uppercasenext = FALSE;
+  struct char_data *dg_victim = NULL;
+  struct obj_data *dg_target = NULL;
+  char *dg_arg = NULL;
+
+  buf = lbuf;
+
+  for (;;) {
+    if (*orig == '$') {
+      switch (*(++orig)) {
+        case 'n':
+          i = PERS(ch, to);
+          break;
+        case 'N':
+          CHECK_NULL(vict_obj, PERS((struct char_data *) vict_obj, to));
+          dg_victim = (struct char_data *) vict_obj;
+          break;
+        case 'm':
+          i = HMHR(ch);
+          break;
+        case 'M':
+          CHECK_NULL(vict_obj, HMHR((const struct char_data *) vict_obj));
+          dg_victim = (struct char_data *) vict_obj;
+          break;
+        case 's':
+          i = HSHR(ch);
+          break;
+        case 'S':
+          CHECK_NULL(vict_obj, HSHR((const struct char_data *) vict_obj));
+          dg_victim = (struct char_data *) vict_obj;
+          break;
+        case 'e':
+          i = HSSH(ch);
+          break;
+        case 'E':
+          CHECK_NULL(vict_obj, HSSH((const struct char_data *) vict_obj));
+          dg_victim = (struct char_data *) vict_obj;
+          break;
+        case 'o':
+          CHECK_NULL(obj, OBJN(obj, to));
+          break;
+        case 'p':
+          CHECK_NULL(obj, OBJS(obj, to));
+          break;
+        case 'u':
+          for (j = buf; j > lbuf && !isspace((int) *(j - 1)); j--);
+          if (j != buf)
+            *j = UPPER(*j);
+          i = "";
+          break;
+        case 'U':
+          uppercasenext = TRUE;
+          i = "";
+          break;
+        case '$':
+          i = "$";
+          break;
+        default:
+          /* The bench messages use no other codes. */
+          i = "";
+          break;
+      }
+      while ((*buf = *(i++))) {
+        if (uppercasenext && !isspace((int) *buf)) {
+          *buf = UPPER(*buf);
+          uppercasenext = FALSE;
+        }
+        buf++;
+      }
+      orig++;
+    } else if (!(*(buf++) = *(orig++))) {
+      break;
+    } else if (uppercasenext && !isspace((int) *(buf - 1))) {
+      *(buf - 1) = UPPER(*(buf - 1));
+      uppercasenext = FALSE;
+    }
+  }
+
+  if (carrier_return) {
+    *(--buf) = '\r';
+    *(++buf) = '\n';
+    *(++buf) = '\0';
+  } else {
+    *(--buf) = '\0';
+  }
+
+  if (to->desc)
+    write_to_output(to->desc, "%s", CAP(lbuf));
+
+  if ((IS_NPC(to) && old_dg_act_check) && (to != ch))
+    act_mtrigger(to, lbuf, ch, dg_victim, obj, dg_target, dg_arg);
+
+  if (old_last_act_message)
+    free(old_last_act_message);
+  old_last_act_message = strdup(lbuf);
+}
+
+/* Just the TO_NOTVICT part. */
+static char *old_act(const char *str, int hide_invisible, struct char_data *ch,
+        struct obj_data *obj, void *vict_obj)
+{
+  struct char_data *to;
+  int to_sleeping = 0;
+
+  old_dg_act_check = TRUE;
+
+  for (to = world[IN_ROOM(ch)].people; to; to = to->next_in_room) {
+    if (!SENDOK(to) || (to == ch))
+      continue;
+    if (hide_invisible && ch && !CAN_SEE(to, ch))
+      continue;
+    if (to == vict_obj)
+      continue;
+    old_perform_act(str, ch, obj, vict_obj, to, TRUE);
+  }
+  return old_last_act_message;
+}
+
+static const char *messages[] = {
+  "$n swings $s $p at $N, who barely gets out of the way.",
+  "$n slashes $N with $s $o, and $E staggers back under the blow!",
+  "$U$n's attack goes wide, and $N laughs at $m.",
+  "$n parries $N's lunge with the flat of $s $o."
+};
+#define NUM_MESSAGES (sizeof(messages) / sizeof(messages[0]))
+
+static FILE *devnull;
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+static struct char_data *make_char(const char *name, int sex)
+{
+  struct char_data *ch;
+  struct descriptor_data *d;
+
+  CREATE(ch, struct char_data, 1);
+  clear_char(ch);
+  CREATE(ch->player_specials, struct player_special_data, 1);
+  ch->player.name = strdup(name);
+  GET_SEX(ch) = sex;
+  GET_LEVEL(ch) = 10;
+  GET_POS(ch) = POS_STANDING;
+
+  ch->next_in_room = world[0].people;
+  world[0].people = ch;
+  IN_ROOM(ch) = 0;
+
+  CREATE(d, struct descriptor_data, 1);
+  d->descriptor = fileno(devnull);
+  d->has_prompt = 1;
+  STATE(d) = CON_PLAYING;
+  d->pProtocol = ProtocolCreate();
+  d->character = ch;
+  ch->desc = d;
+  d->next = descriptor_list;
+  descriptor_list = d;
+
+  return ch;
+}
+
+/* Folds everything the onlookers were sent into *sum and clears it. */
+static void take_output(unsigned long *sum)
+{
+  struct descriptor_data *d;
+  struct out_span *span;
+  int i;
+
+  for (d = descriptor_list; d; d = d->next) {
+    for (span = d->out_head; span; span = span->next)
+      for (i = span->start; i < span->end; i++)
+        *sum = (*sum ^ (unsigned char) span->block->text[i]) * 1099511628211UL;
+    *sum = (*sum ^ 0xff) * 1099511628211UL;
+    clear_output(d);
+  }
+}
+
+static double run(int old, struct char_data *ch, struct char_data *vict, struct obj_data *sword,
+        long rounds, unsigned long *sum)
+{
+  struct timeval start;
+  double secs = 0.0;
+  long r;
+  int m;
+
+  *sum = 14695981039346656037UL;
+
+  for (r = 0; r < rounds; r++) {
+    gettimeofday(&start, NULL);
+    for (m = 0; m < NUM_MESSAGES; m++) {
+      if (old)
+        old_act(messages[m], FALSE, ch, sword, vict);
+      else
+        act(messages[m], FALSE, ch, sword, vict, TO_NOTVICT);
+    }
+    secs += elapsed(&start);
+    take_output(sum);
+  }
+
+  return secs;
+}
+
+int main(int argc, char **argv)
+{
+  int observers = (argc > 1 ? atoi(argv[1]) : 50);
+  long rounds = (argc > 2 ? atol(argv[2]) : 20000);
+  struct char_data *ch, *vict, *watcher;
+  struct obj_data *sword;
+  unsigned long old_sum, new_sum;
+  double old_secs, new_secs, calls;
+  char name[MAX_NAME_LENGTH + 1];
+  int i;
+
+  observers = MAX(observers, 1);
+  rounds = MAX(rounds, 1);
+
+  if (!(devnull = fopen("/dev/null", "w"))) {
+    perror("actbench: /dev/null");
+    return 1;
+  }
+  logfile = devnull;
+  CONFIG_CONFFILE = strdup(CONFIG_FILE);
+  load_config();
+
+  top_of_zone_table = 0;
+  CREATE(zone_table, struct zone_data, 1);
+  zone_table[0].name = strdup("The Act Bench");
+  top_of_world = 0;
+  CREATE(world, struct room_data, 1);
+  world[0].number = 1;
+  world[0].name = strdup("The Stands");
+  world[0].sector_type = SECT_INSIDE;
+
+  for (i = 0; i < observers; i++) {
+    snprintf(name, sizeof(name), "Onlooker%d", i + 1);
+    watcher = make_char(name, i % 3);
+    if (i % 2)
+      SET_BIT_AR(AFF_FLAGS(watcher), AFF_DETECT_INVIS);
+  }
+  vict = make_char("Defender", SEX_FEMALE);
+  ch = make_char("Attacker", SEX_MALE);
+  SET_BIT_AR(AFF_FLAGS(ch), AFF_INVISIBLE);
+
+  CREATE(sword, struct obj_data, 1);
+  clear_object(sword);
+  sword->name = strdup("sword longsword");
+  sword->short_description = strdup("a gleaming longsword");
+  obj_to_char(sword, ch);
+
+  take_output(&old_sum);
+
+  old_secs = run(TRUE, ch, vict, sword, rounds, &old_sum);
+  new_secs = run(FALSE, ch, vict, sword, rounds, &new_sum);
+
+  calls = (double) rounds * NUM_MESSAGES;
+  printf("%d onlookers, %ld rounds of %d messages\n", observers, rounds, (int) NUM_MESSAGES);
+  printf("                   total  per act() per onlooker\n");
+  printf("old act()     %8.3fs %8.2fus %9.3fus\n", old_secs,
+          old_secs * 1000000.0 / calls, old_secs * 1000000.0 / calls / observers);
+  printf("act()         %8.3fs %8.2fus %9.3fus\n", new_secs,
+          new_secs * 1000000.0 / calls, new_secs * 1000000.0 / calls / observers);
+
+  if (old_sum != new_sum) {
+    printf("MISMATCH: the onlookers were sent different messages.\n");
+    return 1;
+  }
+
+  printf("identical output\n");
+  return 0;
+}
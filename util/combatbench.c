@@ -0,0 +1,534 @@
+/* ************************************************************************
+*  file:  combatbench.c                               Part of LuminariMUD *
+*  Usage: run fights in a synthetic world with no sockets and time them   *
+************************************************************************* */
+
+/*
+ * Linked against the game's own objects (see the combatbench target in the
+ * top level Makefile, which builds comm.c with -DCIRCLE_NO_MAIN and fight.c
+ * with -DCOMBAT_PROFILE) rather than built from util/Makefile.
+ *
+ * Sets up the tables boot_db() fills that do not come from world files,
+ * makes one zone of rooms with no exits, creates player characters the way
+ * a new character is made and levelled and gives each a longsword, and
+ * mobiles from a prototype autorolled the way zedit does it, then puts them into fights with
+ * set_fighting() and runs heartbeat() for the requested number of pulses.
+ * Every player gets a descriptor writing to /dev/null, so the cost of
+ * building and sending their combat messages and prompts is included.
+ *
+ * Player characters are healed before every pulse so they never die.  Mobs
+ * that die are loaded again in the same room up to three seconds later, so
+ * they join the fights at odd moments the way players do, and anybody left
+ * without a fight is put back into one.  The random number generator is seeded with
+ * a fixed value, so two runs with the same arguments fight the same fights.
+ *
+ * Usage: combatbench [-p players] [-c class] [-l level]
+ *                    [-m mobs] [-C class] [-L level]
+ *                    [-r rooms] [-n pulses] [-s seed] [-d libdir] [-v]
+ *
+ * By default 10 level 20 warriors fight 20 level 10 warrior mobs in 10
+ * rooms for 6000 pulses (ten minutes of game time).  Classes may be
+ * abbreviated.  -d runs from a lib directory, for the combat messages and
+ * mail file, and -v sends the game log to stderr.
+ *
+ * The times are inclusive: hit() includes the damage() it calls, and
+ * perform_violence() both.  Allocations are the malloc(), calloc() and
+ * realloc() calls the game makes while the fights run.
+ */
+
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "db.h"
+#include "handler.h"
+#include "interpreter.h"
+#include "lists.h"
+#include "mud_event.h"
+#include "dg_scripts.h"
+#include "spells.h"
+#include "class.h"
+#include "race.h"
+#include "feats.h"
+#include "fight.h"
+#include "oasis.h"
+#include "crafts.h"
+#include "trails.h"
+#include "treasure.h"
+#include "domains_schools.h"
+#include "assign_wpn_armor.h"
+#include "spec_abilities.h"
+
+/* Not in any header; they are only called from boot_db(). */
+void load_class_list(void);
+void init_spell_levels(void);
+void sort_spells(void);
+void create_command_list(void);
+
+#define BENCH_VNUM_BASE  1
+
+/* Allocation counts, from the -Wl,--wrap options on the link line. */
+static long allocs, frees;
+static long long alloc_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size)
+{
+  allocs++;
+  alloc_bytes += size;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+  allocs++;
+  alloc_bytes += nmemb * size;
+  return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  allocs++;
+  alloc_bytes += size;
+  return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+  if (ptr)
+    frees++;
+  __real_free(ptr);
+}
+
+struct bench_side {
+  int count;
+  int chclass;
+  int level;
+  long *ids;      /* uids, so the dead can be told from the living */
+  room_rnum *rooms;
+  unsigned long *back; /* pulse a dead mob is loaded again on, 0 if alive */
+};
+
+/* The longest a dead mob stays away. */
+#define BENCH_RESPAWN_PULSES  (3 RL_SEC)
+
+/* Where the players' output, and the log unless -v is given, goes. */
+static FILE *devnull;
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+static int bench_class(const char *arg)
+{
+  int i;
+
+  for (i = 0; i < NUM_CLASSES; i++)
+    if (CLSLIST_NAME(i) && is_abbrev(arg, CLSLIST_NAME(i)))
+      return i;
+
+  fprintf(stderr, "combatbench: unknown class '%s'\n", arg);
+  exit(1);
+}
+
+/* The parts of boot_db() and boot_world() that do not read world files. */
+static void boot_tables(void)
+{
+  global_lists = create_list();
+  group_list = create_list();
+  global_craft_list = create_list();
+  init_events();
+
+  mag_assign_spells();
+  initialize_special_abilities();
+  assign_domains();
+  load_weapons();
+  load_armor();
+  assign_races();
+  assign_feats();
+  sort_feats();
+  load_class_list();
+
+  /* Without the message file, damage falls back to the generic messages. */
+  if (access(MESS_FILE, R_OK) == 0)
+    load_messages();
+
+  create_command_list();
+  init_spell_levels();
+  sort_commands();
+  sort_spells();
+}
+
+/* One zone that never resets, with rooms that have no exits. */
+static void make_world(int rooms)
+{
+  char buf[MAX_INPUT_LENGTH];
+  int i;
+
+  top_of_zone_table = 0;
+  CREATE(zone_table, struct zone_data, 1);
+  zone_table[0].name = strdup("The Combat Bench");
+  zone_table[0].builders = strdup("None");
+  zone_table[0].number = 0;
+  zone_table[0].bot = BENCH_VNUM_BASE;
+  zone_table[0].top = BENCH_VNUM_BASE + MAX(rooms, 2) - 1;
+  zone_table[0].lifespan = 30;
+  zone_table[0].reset_mode = 0;
+  zone_table[0].max_level = LVL_IMPL;
+  CREATE(zone_table[0].cmd, struct reset_com, 1);
+  zone_table[0].cmd[0].command = 'S';
+
+  top_of_world = rooms - 1;
+  CREATE(world, struct room_data, rooms);
+  for (i = 0; i < rooms; i++) {
+    world[i].number = BENCH_VNUM_BASE + i;
+    world[i].zone = 0;
+    snprintf(buf, sizeof(buf), "Arena %d", i + 1);
+    world[i].name = strdup(buf);
+    world[i].description = strdup("Sand, and blood on the sand.\r\n");
+    world[i].sector_type = SECT_FIELD;
+    SET_BIT_AR(world[i].room_flags, ROOM_NOTRACK);
+    CREATE(world[i].trail_tracks, struct trail_data_list, 1);
+  }
+
+  r_mortal_start_room = r_immort_start_room = r_frozen_start_room = 0;
+}
+
+/* The blank objects treasure.c makes its random drops from, in vnum order,
+ * so dying mobs drop what they would drop in the game. */
+static const obj_vnum blank_objects[] = {
+  ITEM_PROTOTYPE, CRYSTAL_PROTOTYPE, AMMO_PROTO, ARMOR_PROTO, WEAPON_PROTO
+};
+#define NUM_BLANK_OBJECTS (sizeof(blank_objects) / sizeof(blank_objects[0]))
+
+static void make_obj_protos(void)
+{
+  struct obj_data *obj;
+  int i;
+
+  top_of_objt = NUM_BLANK_OBJECTS - 1;
+  CREATE(obj_proto, struct obj_data, NUM_BLANK_OBJECTS);
+  CREATE(obj_index, struct index_data, NUM_BLANK_OBJECTS);
+
+  for (i = 0; i < NUM_BLANK_OBJECTS; i++) {
+    obj = &obj_proto[i];
+    clear_object(obj);
+    obj->item_number = i;
+    obj_index[i].vnum = blank_objects[i];
+
+    obj->name = strdup("blank object");
+    obj->short_description = strdup("a blank object");
+    obj->description = strdup("A blank object lies here.");
+    GET_OBJ_TYPE(obj) = ITEM_OTHER;
+    SET_BIT_AR(GET_OBJ_WEAR(obj), ITEM_WEAR_TAKE);
+    GET_OBJ_WEIGHT(obj) = 1;
+  }
+}
+
+/* A prototype autostatted the way zedit's autostat does it. */
+static mob_rnum make_mob_proto(int chclass, int level)
+{
+  struct char_data *mob;
+  char buf[MAX_INPUT_LENGTH];
+
+  top_of_mobt = 0;
+  CREATE(mob_proto, struct char_data, 1);
+  CREATE(mob_index, struct index_data, 1);
+  mob_index[0].vnum = BENCH_VNUM_BASE;
+
+  mob = &mob_proto[0];
+  clear_char(mob);
+  mob->player_specials = &dummy_mob;
+  SET_BIT_AR(MOB_FLAGS(mob), MOB_ISNPC);
+  mob->nr = 0;
+
+  snprintf(buf, sizeof(buf), "gladiator %s", CLSLIST_NAME(chclass));
+  mob->player.name = strdup(buf);
+  snprintf(buf, sizeof(buf), "a %s gladiator", CLSLIST_NAME(chclass));
+  mob->player.short_descr = strdup(buf);
+  snprintf(buf, sizeof(buf), "A %s gladiator is here, looking for a fight.\r\n", CLSLIST_NAME(chclass));
+  mob->player.long_descr = strdup(buf);
+  mob->player.description = strdup("A gladiator.\r\n");
+
+  GET_CLASS(mob) = chclass;
+  GET_LEVEL(mob) = level;
+  GET_REAL_RACE(mob) = RACE_TYPE_HUMANOID;
+  GET_SEX(mob) = SEX_MALE;
+  GET_POS(mob) = GET_DEFAULT_POS(mob) = POS_STANDING;
+  GET_REAL_SIZE(mob) = SIZE_MEDIUM;
+  GET_MAX_PSP(mob) = GET_MAX_MOVE(mob) = 100;
+  GET_WEIGHT(mob) = GET_HEIGHT(mob) = 200;
+
+  autoroll_mob(mob, FALSE, FALSE);
+  mob->real_abils = mob->aff_abils;
+
+  return 0;
+}
+
+/* A character made the way nanny() makes one, then levelled. */
+static struct char_data *make_player(int n, int chclass, int level, room_rnum room)
+{
+  struct char_data *ch;
+  struct descriptor_data *d;
+  struct obj_data *obj;
+  char name[MAX_NAME_LENGTH + 1];
+
+  CREATE(ch, struct char_data, 1);
+  clear_char(ch);
+  CREATE(ch->player_specials, struct player_special_data, 1);
+
+  snprintf(name, sizeof(name), "Bencher%d", n);
+  ch->player.name = strdup(name);
+  GET_SEX(ch) = SEX_MALE;
+  GET_CLASS(ch) = chclass;
+  GET_REAL_RACE(ch) = RACE_HUMAN;
+  create_entry(name);
+  init_char(ch);
+
+  GET_REAL_STR(ch) = GET_REAL_CON(ch) = GET_REAL_DEX(ch) = 16;
+  GET_REAL_INT(ch) = GET_REAL_WIS(ch) = GET_REAL_CHA(ch) = 14;
+  ch->aff_abils = ch->real_abils;
+
+  do_start(ch);
+  while (GET_LEVEL(ch) < level) {
+    GET_LEVEL(ch)++;
+    CLASS_LEVEL(ch, chclass)++;
+    advance_level(ch, chclass);
+  }
+  reset_char(ch);
+
+  if ((obj = read_object(WEAPON_PROTO, VIRTUAL)) != NULL) {
+    set_weapon_object(obj, WEAPON_TYPE_LONG_SWORD);
+    equip_char(ch, obj, WEAR_WIELD_1);
+  }
+
+  GET_ID(ch) = GET_IDNUM(ch);
+  add_to_lookup_table(GET_ID(ch), (void *) ch);
+  ch->next = character_list;
+  character_list = ch;
+  char_to_room(ch, room);
+  affect_total(ch);
+
+  /* Throw away what levelling said, and start sending from here on. */
+  CREATE(d, struct descriptor_data, 1);
+  d->descriptor = fileno(devnull);
+  d->login_time = time(0);
+  d->has_prompt = 1;
+  STATE(d) = CON_PLAYING;
+  CREATE(d->history, char *, HISTORY_SIZE);
+  d->pProtocol = ProtocolCreate();
+  d->events = create_list();
+  d->character = ch;
+  ch->desc = d;
+  d->next = descriptor_list;
+  descriptor_list = d;
+
+  return ch;
+}
+
+static struct char_data *spawn_mob(mob_rnum proto, room_rnum room)
+{
+  struct char_data *mob = read_mobile(proto, REAL);
+
+  char_to_room(mob, room);
+  return mob;
+}
+
+/* Somebody in the room for ch to fight: the other side if it is there. */
+static struct char_data *pick_opponent(struct char_data *ch)
+{
+  struct char_data *tch, *other = NULL;
+
+  for (tch = world[IN_ROOM(ch)].people; tch; tch = tch->next_in_room) {
+    if (tch == ch || GET_POS(tch) <= POS_DEAD)
+      continue;
+    if (IS_NPC(tch) != IS_NPC(ch))
+      return tch;
+    if (!other)
+      other = tch;
+  }
+
+  return other;
+}
+
+static void engage(struct char_data *ch)
+{
+  struct char_data *vict;
+
+  if (FIGHTING(ch) || IN_COMBAT_ROUND(ch) || GET_POS(ch) <= POS_DEAD)
+    return;
+
+  if ((vict = pick_opponent(ch)) != NULL)
+    set_fighting(ch, vict);
+}
+
+int main(int argc, char **argv)
+{
+  struct bench_side pcs = {10, CLASS_WARRIOR, 20}, mobs = {20, CLASS_WARRIOR, 10};
+  const char *pc_class = NULL, *mob_class = NULL, *dir = NULL;
+  struct char_data *ch;
+  struct timeval start;
+  int rooms = 10, pulses = 6000, verbose = FALSE, i, j;
+  unsigned long seed = 20161017;
+  long kills = 0, output_bytes = 0, output_writes = 0;
+  double secs;
+  mob_rnum proto;
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-v")) {
+      verbose = TRUE;
+      continue;
+    }
+    if (argv[i][0] != '-' || !argv[i][1] || argv[i][2] || i + 1 >= argc) {
+      fprintf(stderr, "Usage: %s [-p players] [-c class] [-l level] [-m mobs] [-C class] [-L level]\n"
+              "       [-r rooms] [-n pulses] [-s seed] [-d libdir] [-v]\n", argv[0]);
+      return 1;
+    }
+    switch (argv[++i - 1][1]) {
+      case 'p': pcs.count = atoi(argv[i]); break;
+      case 'c': pc_class = argv[i]; break;
+      case 'l': pcs.level = atoi(argv[i]); break;
+      case 'm': mobs.count = atoi(argv[i]); break;
+      case 'C': mob_class = argv[i]; break;
+      case 'L': mobs.level = atoi(argv[i]); break;
+      case 'r': rooms = atoi(argv[i]); break;
+      case 'n': pulses = atoi(argv[i]); break;
+      case 's': seed = strtoul(argv[i], NULL, 10); break;
+      case 'd': dir = argv[i]; break;
+      default:
+        fprintf(stderr, "combatbench: unknown option %s\n", argv[i - 1]);
+        return 1;
+    }
+  }
+
+  pcs.count = MAX(pcs.count, 0);
+  mobs.count = MAX(mobs.count, 0);
+  pcs.level = MAX(1, MIN(pcs.level, LVL_IMMORT - 1));
+  mobs.level = MAX(1, MIN(mobs.level, LVL_IMPL));
+  rooms = MAX(rooms, 1);
+  pulses = MAX(pulses, 1);
+
+  if (dir && chdir(dir) < 0) {
+    perror("combatbench: chdir");
+    return 1;
+  }
+
+  if (!(devnull = fopen("/dev/null", "w"))) {
+    perror("combatbench: /dev/null");
+    return 1;
+  }
+  logfile = verbose ? stderr : devnull;
+  CONFIG_CONFFILE = strdup(CONFIG_FILE);
+  load_config();
+  CONFIG_AUTO_SAVE = FALSE;
+
+  circle_srandom(seed);
+  event_init();
+  init_lookup_table();
+  boot_tables();
+
+  if (pc_class)
+    pcs.chclass = bench_class(pc_class);
+  if (mob_class)
+    mobs.chclass = bench_class(mob_class);
+
+  make_world(rooms);
+  make_obj_protos();
+  proto = make_mob_proto(mobs.chclass, mobs.level);
+
+  /* init_char() makes the first player in the table the implementor, so
+   * that place is taken before any of the bench players are made. */
+  top_of_p_table = -1;
+  create_entry("Benchadmin");
+
+  CREATE(pcs.ids, long, MAX(pcs.count, 1));
+  CREATE(mobs.ids, long, MAX(mobs.count, 1));
+  CREATE(mobs.rooms, room_rnum, MAX(mobs.count, 1));
+  CREATE(mobs.back, unsigned long, MAX(mobs.count, 1));
+
+  for (i = 0; i < pcs.count; i++)
+    pcs.ids[i] = GET_ID(make_player(i + 1, pcs.chclass, pcs.level, i % rooms));
+  for (i = 0; i < mobs.count; i++) {
+    mobs.rooms[i] = i % rooms;
+    mobs.ids[i] = GET_ID(spawn_mob(proto, mobs.rooms[i]));
+  }
+  process_all_output();
+
+  printf("%d level %d %s players and %d level %d %s mobs in %d room%s, %d pulses, seed %lu\n",
+          pcs.count, pcs.level, CLSLIST_NAME(pcs.chclass),
+          mobs.count, mobs.level, CLSLIST_NAME(mobs.chclass),
+          rooms, rooms == 1 ? "" : "s", pulses, seed);
+
+  /* has_mail() complains on stderr for every prompt when there is no mail
+   * file, as there is not without -d. */
+  if (!verbose)
+    dup2(fileno(devnull), STDERR_FILENO);
+
+  allocs = frees = 0;
+  alloc_bytes = 0;
+  gettimeofday(&start, NULL);
+
+  for (j = 0; j < pulses; j++) {
+    for (i = 0; i < mobs.count; i++)
+      if (mobs.back[i] && pulse >= mobs.back[i]) {
+        mobs.ids[i] = GET_ID(spawn_mob(proto, mobs.rooms[i]));
+        mobs.back[i] = 0;
+      } else if (!mobs.back[i] && !lookup_table_find(mobs.ids[i])) {
+        kills++;
+        mobs.back[i] = pulse + rand_number(1, BENCH_RESPAWN_PULSES);
+      }
+
+    for (i = 0; i < pcs.count; i++) {
+      if (!(ch = lookup_table_find(pcs.ids[i])))
+        continue;
+      GET_HIT(ch) = GET_MAX_HIT(ch);
+      update_pos(ch);
+      engage(ch);
+    }
+    for (i = 0; i < mobs.count; i++)
+      if ((ch = lookup_table_find(mobs.ids[i])) != NULL)
+        engage(ch);
+
+    heartbeat(++pulse);
+
+    /* Each descriptor with something to send gets one write, and a prompt,
+     * per pass of the game loop. */
+    for (ch = character_list; ch; ch = ch->next)
+      if (ch->desc && ch->desc->bufptr) {
+        output_bytes += ch->desc->bufptr;
+        output_writes++;
+      }
+    process_all_output();
+  }
+
+  secs = elapsed(&start);
+
+  printf("%.3fs for %d pulses (%.1f game seconds), %.0f pulses/second\n",
+          secs, pulses, (double) pulses / PASSES_PER_SEC, pulses / secs);
+  printf("%ld combat rounds, %.0f rounds/second\n",
+          combat_profiles[COMBAT_PROFILE_VIOLENCE].calls,
+          combat_profiles[COMBAT_PROFILE_VIOLENCE].calls / secs);
+  printf("%-18s %10s %12s %10s\n", "", "calls", "total", "per call");
+  for (i = 0; i < NUM_COMBAT_PROFILES; i++)
+    printf("%-18s %10ld %11.3fs %8.2fus\n", combat_profiles[i].name,
+            combat_profiles[i].calls, combat_profiles[i].secs,
+            combat_profiles[i].calls ? combat_profiles[i].secs * 1000000.0 / combat_profiles[i].calls : 0.0);
+  printf("%ld allocations (%.1f per round, %lld bytes), %ld frees\n",
+          allocs, combat_profiles[COMBAT_PROFILE_VIOLENCE].calls ?
+          (double) allocs / combat_profiles[COMBAT_PROFILE_VIOLENCE].calls : 0.0,
+          alloc_bytes, frees);
+  printf("%ld mobs killed and reloaded, %ld bytes of output to players in %ld writes\n",
+          kills, output_bytes, output_writes);
+
+  return 0;
+}
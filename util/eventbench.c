@@ -0,0 +1,264 @@
+/* ************************************************************************
+*  file:  eventbench.c                                Part of LuminariMUD *
+*  Usage: compare the event queue against the old bucket queue            *
+************************************************************************* */
+
+/*
+ * Drives the timing wheel in dg_event.c and a copy of the bucket queue it
+ * replaced with the same stream of events, checks that both hand events out
+ * in the same order, and reports the time each took.
+ *
+ * The mix is modelled on a busy game: mostly combat rounds and action
+ * cooldowns a few seconds out, casting and affect timers up to a few
+ * minutes, eCHECK_OCCUPIED every ten seconds, and a trickle of daily
+ * cooldowns hours away.  About one event in eight is cancelled before it
+ * fires, as happens when a fight ends or a character leaves.
+ *
+ * Usage: eventbench [live events] [pulses]
+ */
+
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "dg_event.h"
+
+struct mud_event_data;
+
+/* dg_event.c needs these from the rest of the game. */
+unsigned long pulse = 0;
+
+void basic_mud_log(const char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+void free_mud_event(struct mud_event_data *pMudEvent)
+{
+}
+
+/* The bucket queue dg_event.c used to have. */
+#define NUM_BUCKETS 10
+
+struct bucket_element {
+  void *data;
+  long key;
+  struct bucket_element *prev, *next;
+};
+
+struct bucket_queue {
+  struct bucket_element *head[NUM_BUCKETS];
+  struct bucket_element *tail[NUM_BUCKETS];
+};
+
+static struct bucket_element *bucket_enq(struct bucket_queue *q, void *data, long key)
+{
+  struct bucket_element *qe = NULL, *i = NULL;
+  int bucket = key % NUM_BUCKETS;
+
+  CREATE(qe, struct bucket_element, 1);
+  qe->data = data;
+  qe->key = key;
+
+  if (!q->head[bucket]) {
+    q->head[bucket] = qe;
+    q->tail[bucket] = qe;
+  } else {
+    for (i = q->tail[bucket]; i; i = i->prev) {
+      if (i->key < key) {
+        if (i == q->tail[bucket])
+          q->tail[bucket] = qe;
+        else {
+          qe->next = i->next;
+          i->next->prev = qe;
+        }
+        qe->prev = i;
+        i->next = qe;
+        break;
+      }
+    }
+    if (i == NULL) {
+      qe->next = q->head[bucket];
+      q->head[bucket] = qe;
+      qe->next->prev = qe;
+    }
+  }
+
+  return qe;
+}
+
+static void bucket_deq(struct bucket_queue *q, struct bucket_element *qe)
+{
+  int i = qe->key % NUM_BUCKETS;
+
+  if (qe->prev == NULL)
+    q->head[i] = qe->next;
+  else
+    qe->prev->next = qe->next;
+
+  if (qe->next == NULL)
+    q->tail[i] = qe->prev;
+  else
+    qe->next->prev = qe->prev;
+
+  free(qe);
+}
+
+static void *bucket_head(struct bucket_queue *q)
+{
+  void *data;
+  int i = pulse % NUM_BUCKETS;
+
+  if (!q->head[i] || q->head[i]->key > (long) pulse)
+    return NULL;
+
+  data = q->head[i]->data;
+  bucket_deq(q, q->head[i]);
+  return data;
+}
+
+/* The event stream: a fixed-seed generator so both runs see the same mix. */
+static unsigned long bench_seed;
+
+static unsigned long bench_rand(void)
+{
+  bench_seed = bench_seed * 6364136223846793005UL + 1442695040888963407UL;
+  return bench_seed >> 33;
+}
+
+static long bench_delay(void)
+{
+  int roll = bench_rand() % 100;
+
+  if (roll < 45)
+    return PASSES_PER_SEC * 6;                           /* Combat round. */
+  if (roll < 70)
+    return 1 + bench_rand() % (PASSES_PER_SEC * 6);      /* Action cooldowns. */
+  if (roll < 85)
+    return 1 + bench_rand() % (PASSES_PER_SEC * 180);    /* Casting, affects. */
+  if (roll < 97)
+    return PASSES_PER_SEC * 10;                          /* eCHECK_OCCUPIED */
+  return 1 + bench_rand() % (PASSES_PER_SEC * 60 * 60 * 24); /* Daily cooldowns. */
+}
+
+struct bench_item {
+  long id;
+  void *handle; /* q_element or bucket_element while queued */
+};
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+/* Runs the stream through one queue, hashing the order items fire in. */
+static double run(int wheel, int live, long pulses, unsigned long *order, long *fired)
+{
+  struct dg_queue *wq = NULL;
+  struct bucket_queue *bq = NULL;
+  struct bench_item *items, *item;
+  struct timeval start;
+  long n = 0;
+  int i;
+
+  bench_seed = 20161017;
+  *order = 14695981039346656037UL;
+  pulse = 0;
+
+  CREATE(items, struct bench_item, live);
+
+  gettimeofday(&start, NULL);
+
+  if (wheel)
+    wq = queue_init();
+  else
+    CREATE(bq, struct bucket_queue, 1);
+
+  for (i = 0; i < live; i++) {
+    items[i].id = i;
+    if (wheel)
+      items[i].handle = queue_enq(wq, &items[i], bench_delay() + pulse);
+    else
+      items[i].handle = bucket_enq(bq, &items[i], bench_delay() + pulse);
+  }
+
+  for (pulse = 1; pulse <= (unsigned long) pulses; pulse++) {
+    while ((item = (wheel ? queue_head(wq) : bucket_head(bq))) != NULL) {
+      *order = (*order ^ item->id) * 1099511628211UL;
+      n++;
+
+      /* Most events go round again, the rest are replaced by a new one. */
+      if (bench_rand() % 4)
+        item->id += live;
+      if (wheel)
+        item->handle = queue_enq(wq, item, bench_delay() + pulse);
+      else
+        item->handle = bucket_enq(bq, item, bench_delay() + pulse);
+    }
+
+    /* Cancel and replace a few. */
+    for (i = bench_rand() % 8; i > 0; i--) {
+      item = &items[bench_rand() % live];
+      if (wheel) {
+        queue_deq(wq, item->handle);
+        item->handle = queue_enq(wq, item, bench_delay() + pulse);
+      } else {
+        bucket_deq(bq, item->handle);
+        item->handle = bucket_enq(bq, item, bench_delay() + pulse);
+      }
+    }
+  }
+
+  if (wheel) {
+    /* queue_free() would free the items as events. */
+    for (i = 0; i < live; i++)
+      queue_deq(wq, items[i].handle);
+    queue_free(wq);
+  } else {
+    for (i = 0; i < live; i++)
+      bucket_deq(bq, items[i].handle);
+    free(bq);
+  }
+
+  free(items);
+  *fired = n;
+  return elapsed(&start);
+}
+
+int main(int argc, char **argv)
+{
+  int live = (argc > 1 ? atoi(argv[1]) : 20000);
+  long pulses = (argc > 2 ? atol(argv[2]) : PASSES_PER_SEC * 60 * 10);
+  unsigned long wheel_order, bucket_order;
+  long wheel_fired, bucket_fired;
+  double wheel_time, bucket_time;
+
+  if (live < 1)
+    live = 1;
+  if (pulses < 1)
+    pulses = 1;
+
+  bucket_time = run(FALSE, live, pulses, &bucket_order, &bucket_fired);
+  wheel_time = run(TRUE, live, pulses, &wheel_order, &wheel_fired);
+
+  printf("%d live events, %ld pulses, %ld fired\n", live, pulses, bucket_fired);
+  printf("bucket queue  %8.3fs\n", bucket_time);
+  printf("timing wheel  %8.3fs\n", wheel_time);
+
+  if (wheel_fired != bucket_fired || wheel_order != bucket_order) {
+    printf("MISMATCH: the queues fired events in a different order.\n");
+    return 1;
+  }
+
+  printf("identical firing order\n");
+  return 0;
+}
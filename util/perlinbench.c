@@ -0,0 +1,109 @@
+/* ************************************************************************
+*  file:  perlinbench.c                               Part of LuminariMUD *
+*  Usage: check and time the batch perlin noise kernels                   *
+************************************************************************* */
+
+/*
+ * Runs PerlinNoise2DBatch() and PerlinNoise3DBatch() with every kernel the
+ * CPU supports over wilderness-sized rows, checks each result is bit-for-bit
+ * the same as PerlinNoise2D()/PerlinNoise3D(), and reports the time taken by
+ * each against the one-point-at-a-time functions.
+ *
+ * Usage: perlinbench [rows]
+ */
+
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "../perlin.h"
+#include "../wilderness.h"
+
+#define ROW_SIZE 2048
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+  static const char *mode_names[] = { "auto", "scalar", "sse2", "avx2" };
+  double x[ROW_SIZE], y[ROW_SIZE], z[ROW_SIZE];
+  double ref2[ROW_SIZE], ref3[ROW_SIZE], out[ROW_SIZE];
+  double t2, t3;
+  struct timeval start;
+  int rows = (argc > 1 ? atoi(argv[1]) : 64);
+  int row, k, mode, used, bad;
+
+  if (rows < 1)
+    rows = 1;
+
+  init_perlin(NOISE_MATERIAL_PLANE_ELEV, NOISE_MATERIAL_PLANE_ELEV_SEED);
+  init_perlin(NOISE_WEATHER, NOISE_WEATHER_SEED);
+
+  /* The one-point-at-a-time baseline. */
+  gettimeofday(&start, NULL);
+  for (row = 0; row < rows; row++)
+    for (k = 0; k < ROW_SIZE; k++)
+      ref2[k] = PerlinNoise2D(NOISE_MATERIAL_PLANE_ELEV, (k - ROW_SIZE / 2) / (double) (WILD_X_SIZE / 2.0),
+                              (row - rows / 2) / (double) (WILD_Y_SIZE / 2.0), 2.0, 2.0, 16);
+  t2 = elapsed(&start);
+
+  gettimeofday(&start, NULL);
+  for (row = 0; row < rows; row++)
+    for (k = 0; k < ROW_SIZE; k++)
+      ref3[k] = PerlinNoise3D(NOISE_WEATHER, (k - ROW_SIZE / 2) / (double) WILD_X_SIZE * 50.0,
+                              (row - rows / 2) / (double) WILD_Y_SIZE * 50.0, 42.0, 2.0, 2.0, 8);
+  t3 = elapsed(&start);
+
+  printf("%-8s 2D %8.3fs            3D %8.3fs\n", "single", t2, t3);
+
+  for (mode = PERLIN_BATCH_SCALAR; mode <= PERLIN_BATCH_AVX2; mode++) {
+    if ((used = perlin_batch_mode(mode)) != mode) {
+      printf("%-8s not supported by this CPU\n", mode_names[mode]);
+      continue;
+    }
+
+    bad = 0;
+
+    gettimeofday(&start, NULL);
+    for (row = 0; row < rows; row++) {
+      for (k = 0; k < ROW_SIZE; k++) {
+        x[k] = (k - ROW_SIZE / 2) / (double) (WILD_X_SIZE / 2.0);
+        y[k] = (row - rows / 2) / (double) (WILD_Y_SIZE / 2.0);
+      }
+      PerlinNoise2DBatch(NOISE_MATERIAL_PLANE_ELEV, x, y, ROW_SIZE, 2.0, 2.0, 16, out);
+    }
+    t2 = elapsed(&start);
+
+    /* The last row is still in ref2, compare it bit for bit. */
+    if (memcmp(out, ref2, sizeof (out)))
+      bad++;
+
+    gettimeofday(&start, NULL);
+    for (row = 0; row < rows; row++) {
+      for (k = 0; k < ROW_SIZE; k++) {
+        x[k] = (k - ROW_SIZE / 2) / (double) WILD_X_SIZE * 50.0;
+        y[k] = (row - rows / 2) / (double) WILD_Y_SIZE * 50.0;
+        z[k] = 42.0;
+      }
+      PerlinNoise3DBatch(NOISE_WEATHER, x, y, z, ROW_SIZE, 2.0, 2.0, 8, out);
+    }
+    t3 = elapsed(&start);
+
+    if (memcmp(out, ref3, sizeof (out)))
+      bad++;
+
+    printf("%-8s 2D %8.3fs            3D %8.3fs   %s\n", mode_names[mode], t2, t3,
+           bad ? "MISMATCH" : "identical");
+
+    if (bad)
+      return 1;
+  }
+
+  return 0;
+}
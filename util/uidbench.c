@@ -0,0 +1,266 @@
+/* ************************************************************************
+*  file:  uidbench.c                                  Part of LuminariMUD *
+*  Usage: compare the uid lookup table against the old chained table      *
+************************************************************************* */
+
+/*
+ * Fills the open addressing table in dg_lookup.c and a copy of the 64 bucket
+ * chained table it replaced with the same world of players, mobs and
+ * objects, then times the lookups find_char() and find_obj() make, with
+ * some misses for uids that have gone away, and a stretch of churn where
+ * entities are extracted and loaded again under new uids, as happens with
+ * zone resets and corpses.  Both tables must hand back the same pointers.
+ *
+ * Usage: uidbench [entities] [lookups]
+ */
+
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "dg_lookup.h"
+
+/* From dg_scripts.h. */
+#define MOB_ID_BASE     1000000
+#define OBJ_ID_BASE     1300000
+
+/* dg_lookup.c needs this from the rest of the game. */
+void basic_mud_log(const char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+/* The chained table dg_scripts.c used to have. */
+#define BUCKET_COUNT 64
+#define UID_OUT_OF_RANGE 1000000000
+
+struct lookup_table_t {
+  long uid;
+  void *c;
+  struct lookup_table_t *next;
+};
+static struct lookup_table_t lookup_table[BUCKET_COUNT];
+
+static void chain_init(void)
+{
+  int i;
+
+  for (i = 0; i < BUCKET_COUNT; i++) {
+    lookup_table[i].uid = UID_OUT_OF_RANGE;
+    lookup_table[i].c = NULL;
+    lookup_table[i].next = NULL;
+  }
+}
+
+static void *chain_find(long uid)
+{
+  struct lookup_table_t *lt = &lookup_table[uid & (BUCKET_COUNT - 1)];
+
+  for (; lt && lt->uid != uid; lt = lt->next);
+
+  return lt ? lt->c : NULL;
+}
+
+static void chain_add(long uid, void *c)
+{
+  struct lookup_table_t *lt = &lookup_table[uid & (BUCKET_COUNT - 1)];
+
+  for (; lt->next; lt = lt->next)
+    if (lt->next->uid == uid)
+      return;
+
+  CREATE(lt->next, struct lookup_table_t, 1);
+  lt->next->uid = uid;
+  lt->next->c = c;
+}
+
+static void chain_remove(long uid)
+{
+  struct lookup_table_t *lt = &lookup_table[uid & (BUCKET_COUNT - 1)], *flt;
+
+  for (; lt->next; lt = lt->next)
+    if (lt->next->uid == uid) {
+      flt = lt->next;
+      lt->next = flt->next;
+      free(flt);
+      return;
+    }
+}
+
+static void chain_free(void)
+{
+  struct lookup_table_t *lt, *next;
+  int i;
+
+  for (i = 0; i < BUCKET_COUNT; i++)
+    for (lt = lookup_table[i].next; lt; lt = next) {
+      next = lt->next;
+      free(lt);
+    }
+}
+
+/* A fixed-seed generator so both runs see the same world. */
+static unsigned long bench_seed;
+
+static unsigned long bench_rand(void)
+{
+  bench_seed = bench_seed * 6364136223846793005UL + 1442695040888963407UL;
+  return bench_seed >> 33;
+}
+
+struct bench_entity {
+  long uid;
+  long old_uid; /* what it was before it was last reloaded, 0 if never */
+};
+
+static long next_mob_uid, next_obj_uid;
+
+/* About one entity in two hundred is a player, two in five are mobs and the
+ * rest are objects. */
+static long new_uid(int i)
+{
+  int roll = i % 200;
+
+  if (roll == 0)
+    return 1 + i / 200;
+  if (roll < 81)
+    return next_mob_uid++;
+  return next_obj_uid++;
+}
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+/* Looks up one random uid: usually a live one, sometimes one that was
+ * extracted. Folds what came back into *sum. */
+static void lookup_one(int open, struct bench_entity *ents, int n, unsigned long *sum)
+{
+  struct bench_entity *e = &ents[bench_rand() % n];
+  long uid = (e->old_uid && !(bench_rand() % 10)) ? e->old_uid : e->uid;
+  void *c = open ? lookup_table_find(uid) : chain_find(uid);
+
+  *sum = (*sum ^ (c ? (unsigned long) ((struct bench_entity *) c - ents) + 1 : 0)) * 1099511628211UL;
+}
+
+static void run(int open, int n, long lookups, double *times, unsigned long *sum)
+{
+  struct bench_entity *ents, *e;
+  struct timeval start;
+  struct lookup_table_stats st;
+  long l;
+  int i;
+
+  bench_seed = 20161017;
+  next_mob_uid = MOB_ID_BASE;
+  next_obj_uid = OBJ_ID_BASE;
+  *sum = 14695981039346656037UL;
+  CREATE(ents, struct bench_entity, n);
+
+  /* Boot: load the world. */
+  gettimeofday(&start, NULL);
+  if (open)
+    init_lookup_table();
+  else
+    chain_init();
+  for (i = 0; i < n; i++) {
+    ents[i].uid = new_uid(i);
+    if (open)
+      add_to_lookup_table(ents[i].uid, &ents[i]);
+    else
+      chain_add(ents[i].uid, &ents[i]);
+  }
+  times[0] = elapsed(&start);
+
+  /* Reload a tenth of the world first so there are stale uids to miss. */
+  for (i = 0; i < n / 10; i++) {
+    e = &ents[bench_rand() % n];
+    if (e->old_uid || e->uid < MOB_ID_BASE)
+      continue;
+    if (open)
+      remove_from_lookup_table(e->uid);
+    else
+      chain_remove(e->uid);
+    e->old_uid = e->uid;
+    e->uid = e->uid < OBJ_ID_BASE ? next_mob_uid++ : next_obj_uid++;
+    if (open)
+      add_to_lookup_table(e->uid, e);
+    else
+      chain_add(e->uid, e);
+  }
+
+  /* Scripts looking things up. */
+  gettimeofday(&start, NULL);
+  for (l = 0; l < lookups; l++)
+    lookup_one(open, ents, n, sum);
+  times[1] = elapsed(&start);
+
+  /* Churn: extract and reload, with a few lookups in between. */
+  gettimeofday(&start, NULL);
+  for (l = 0; l < lookups / 4; l++) {
+    e = &ents[bench_rand() % n];
+    if (e->uid >= MOB_ID_BASE) {
+      if (open)
+        remove_from_lookup_table(e->uid);
+      else
+        chain_remove(e->uid);
+      e->old_uid = e->uid;
+      e->uid = e->uid < OBJ_ID_BASE ? next_mob_uid++ : next_obj_uid++;
+      if (open)
+        add_to_lookup_table(e->uid, e);
+      else
+        chain_add(e->uid, e);
+    }
+    lookup_one(open, ents, n, sum);
+    lookup_one(open, ents, n, sum);
+  }
+  times[2] = elapsed(&start);
+
+  if (open) {
+    get_lookup_table_stats(&st);
+    printf("open table: %d uids in %d slots (%d%% full), probe avg %.2f max %d\n",
+            st.entries, st.slots, st.entries * 100 / st.slots, st.avg_probe, st.max_probe);
+  } else
+    chain_free();
+
+  free(ents);
+}
+
+int main(int argc, char **argv)
+{
+  int n = (argc > 1 ? atoi(argv[1]) : 100000);
+  long lookups = (argc > 2 ? atol(argv[2]) : 200000);
+  double chain_times[3], open_times[3];
+  unsigned long chain_sum, open_sum;
+
+  if (n < 1)
+    n = 1;
+  if (lookups < 1)
+    lookups = 1;
+
+  run(FALSE, n, lookups, chain_times, &chain_sum);
+  run(TRUE, n, lookups, open_times, &open_sum);
+
+  printf("%d entities, %ld lookups, %ld reloads\n", n, lookups, lookups / 4);
+  printf("                  boot   lookups     churn\n");
+  printf("chained table %8.3fs %8.3fs %8.3fs\n", chain_times[0], chain_times[1], chain_times[2]);
+  printf("open table    %8.3fs %8.3fs %8.3fs\n", open_times[0], open_times[1], open_times[2]);
+
+  if (chain_sum != open_sum) {
+    printf("MISMATCH: the tables returned different entities.\n");
+    return 1;
+  }
+
+  printf("identical results\n");
+  return 0;
+}
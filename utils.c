@@ -3337,11 +3337,67 @@ char *get_align_by_num(int align) {
   return "Unknown";
 }
 /* Feats */
-int get_feat_value(struct char_data *ch, int featnum) {
+/* Counts the worn items granting each feat into gear_feats[], one per item
+ * however many times it lists the feat. */
+static void build_gear_feats(struct char_data *ch) {
+  struct obj_data *obj;
+  int i = 0, j = 0, k = 0, featnum = 0;
+
+  memset(ch->player_specials->gear_feats, 0, sizeof (ch->player_specials->gear_feats));
+
+  for (j = 0; j < NUM_WEARS; j++) {
+    if ((obj = GET_EQ(ch, j)) == NULL)
+      continue;
+    for (i = 0; i < MAX_OBJ_AFFECT; i++) {
+      if (obj->affected[i].location != APPLY_FEAT)
+        continue;
+      featnum = obj->affected[i].modifier;
+      if (featnum <= FEAT_UNDEFINED || featnum >= FEAT_LAST_FEAT)
+        continue;
+      for (k = 0; k < i; k++)
+        if (obj->affected[k].location == APPLY_FEAT && obj->affected[k].modifier == featnum)
+          break;
+      if (k == i) /* capped at +1, sorry folks */
+        ch->player_specials->gear_feats[featnum]++;
+    }
+  }
+
+  ch->player_specials->gear_feats_valid = TRUE;
+}
+
+/* Call whenever a character's worn gear, or what it grants, may have changed,
+ * so get_feat_value() counts it again. */
+void gear_feats_changed(struct char_data *ch) {
+  if (!IS_NPC(ch) && ch->player_specials)
+    ch->player_specials->gear_feats_valid = FALSE;
+}
+
+/* Build with -DCHECK_FEAT_CACHE to have every PC lookup checked against a
+ * fresh walk of the gear. */
+#ifdef CHECK_FEAT_CACHE
+static int scan_gear_feat(struct char_data *ch, int featnum) {
   struct obj_data *obj;
   int i = 0, j = 0;
   int featval = 0;
 
+  for (j = 0; j < NUM_WEARS; j++) {
+    if ((obj = GET_EQ(ch, j)) == NULL)
+      continue;
+    for (i = 0; i < MAX_OBJ_AFFECT; i++) {
+      if (obj->affected[i].location == APPLY_FEAT && obj->affected[i].modifier == featnum) {
+        featval++;
+        break;
+      }
+    }
+  }
+
+  return featval;
+}
+#endif
+
+int get_feat_value(struct char_data *ch, int featnum) {
+  int featval = 0;
+
   if ((featnum <= FEAT_UNDEFINED) || (featnum >= FEAT_LAST_FEAT)) {
     log("SYSERR: get_feat_value called with invalid featnum: %d", featnum);
     return 0;
@@ -3354,16 +3410,14 @@ int get_feat_value(struct char_data *ch, int featnum) {
     featval = MOB_HAS_FEAT(ch, featnum);
   else {
     /* check if we got this feat equipped */
-    for (j = 0; j < NUM_WEARS; j++) {
-      if ((obj = GET_EQ(ch, j)) == NULL)
-        continue;
-      for (i = 0; i < MAX_OBJ_AFFECT; i++) {
-        if (obj->affected[i].location == APPLY_FEAT && obj->affected[i].modifier == featnum) {
-          featval++;
-          break; /* capped at +1, sorry folks */
-        }
-      }
-    }
+    if (!ch->player_specials->gear_feats_valid)
+      build_gear_feats(ch);
+    featval = ch->player_specials->gear_feats[featnum];
+#ifdef CHECK_FEAT_CACHE
+    if (featval != scan_gear_feat(ch, featnum))
+      log("SYSERR: gear_feats[%d] for %s is %d, gear gives %d.", featnum,
+              GET_NAME(ch), featval, scan_gear_feat(ch, featnum));
+#endif
     featval += HAS_REAL_FEAT(ch, featnum);
   }
 
@@ -3514,14 +3568,13 @@ int get_daily_uses(struct char_data *ch, int featnum) {
 }
 
 /* Function to create an event, based on the mud_event passed in, that will either:
- * 1.) Create a new event with the proper sVariables
- * 2.) Update an existing event with a new sVariable value
+ * 1.) Create a new event carrying the number of uses
+ * 2.) Update the number of uses on an existing event
  *
  * Returns the current number of uses on cooldown. */
 int start_daily_use_cooldown(struct char_data *ch, int featnum) {
   struct mud_event_data * pMudEvent = NULL;
   int uses = 0, daily_uses = 0;
-  char buf[128];
   event_id iId = 0;
 
   /* Transform the feat number to the event id for that ability. */
@@ -3538,30 +3591,23 @@ int start_daily_use_cooldown(struct char_data *ch, int featnum) {
 
   if ((pMudEvent = char_has_mud_event(ch, iId))) {
     /* Player is on cooldown for this ability - just update the event. */
-    /* The number of uses is stored in the pMudEvent->sVariables field. */
-    if (pMudEvent->sVariables == NULL) {
+    /* The number of uses is the event's number (see mud_event_num()). */
+    if ((uses = mud_event_num(pMudEvent, -1)) < 0) {
       /* This is odd - This field should always be populated for daily-use abilities,
        * maybe some legacy code or bad id. */
-      log("SYSERR: sVariables field is NULL for daily-use-cooldown-event: %d", iId);
-    } else {
-
-      if (sscanf(pMudEvent->sVariables, "uses:%d", &uses) != 1) {
-        log("SYSERR: In start_daily_use_cooldown, bad sVariables for daily-use-cooldown-event: %d", iId);
-        uses = 0;
-      }
-      free(pMudEvent->sVariables);
+      log("SYSERR: No uses set for daily-use-cooldown-event: %d", iId);
+      uses = 0;
     }
     uses++;
 
     if (uses > daily_uses)
       log("SYSERR: Daily uses exceeed maximum for %s, feat %s", GET_NAME(ch), feat_list[featnum].name);
 
-    sprintf(buf, "uses:%d", uses);
-    pMudEvent->sVariables = strdup(buf);
+    mud_event_set_num(pMudEvent, uses);
   } else {
     /* No event - so attach one. */
     uses = 1;
-    attach_mud_event(new_mud_event(iId, ch, "uses:1"), (SECS_PER_MUD_DAY / daily_uses) RL_SEC);
+    attach_mud_event(new_mud_event_num(iId, ch, 1), (SECS_PER_MUD_DAY / daily_uses) RL_SEC);
   }
 
   return uses;
@@ -3579,15 +3625,11 @@ int daily_uses_remaining(struct char_data *ch, int featnum) {
     return -1;
 
   if ((pMudEvent = char_has_mud_event(ch, iId))) {
-    if (pMudEvent->sVariables == NULL) {
+    if ((uses = mud_event_num(pMudEvent, -1)) < 0) {
       /* This is odd - This field should always be populated for daily-use abilities,
        * maybe some legacy code or bad id. */
-      log("SYSERR: sVariables field is NULL for daily-use-cooldown-event: %d", iId);
-    } else {
-      if (sscanf(pMudEvent->sVariables, "uses:%d", &uses) != 1) {
-        log("SYSERR: In daily_uses_remaining, bad sVariables for daily-use-cooldown-event: %d", iId);
-        uses = 0;
-      }
+      log("SYSERR: No uses set for daily-use-cooldown-event: %d", iId);
+      uses = 0;
     }
   }
 
@@ -3597,14 +3639,13 @@ int daily_uses_remaining(struct char_data *ch, int featnum) {
 }
 
 /* Function to create an event, based on the mud_event passed in, that will either:
- * 1.) Create a new event with the proper sVariables
- * 2.) Update an existing event with a new sVariable value
+ * 1.) Create a new event carrying the number of uses
+ * 2.) Update the number of uses on an existing event
  *
  * Returns the current number of uses on cooldown. */
 int start_item_specab_daily_use_cooldown(struct obj_data *obj, int specab) {
   struct mud_event_data * pMudEvent = NULL;
   int uses = 0, daily_uses = 0;
-  char buf[128];
   event_id iId = 0;
 
   /* Transform the feat number to the event id for that ability. */
@@ -3621,30 +3662,23 @@ int start_item_specab_daily_use_cooldown(struct obj_data *obj, int specab) {
 
   if ((pMudEvent = obj_has_mud_event(obj, iId))) {
     /* Player is on cooldown for this ability - just update the event. */
-    /* The number of uses is stored in the pMudEvent->sVariables field. */
-    if (pMudEvent->sVariables == NULL) {
+    /* The number of uses is the event's number (see mud_event_num()). */
+    if ((uses = mud_event_num(pMudEvent, -1)) < 0) {
       /* This is odd - This field should always be populated for daily-use abilities,
        * maybe some legacy code or bad id. */
-      log("SYSERR: sVariables field is NULL for daily-use-cooldown-event: %d", iId);
-    } else {
-
-      if (sscanf(pMudEvent->sVariables, "uses:%d", &uses) != 1) {
-        log("SYSERR: In start_daily_use_cooldown, bad sVariables for daily-use-cooldown-event: %d", iId);
-        uses = 0;
-      }
-      free(pMudEvent->sVariables);
+      log("SYSERR: No uses set for daily-use-cooldown-event: %d", iId);
+      uses = 0;
     }
     uses++;
 
     if (uses > daily_uses)
       log("SYSERR: Daily uses exceeed maximum for %s, specab %s", obj->name, special_ability_info[specab].name);
 
-    sprintf(buf, "uses:%d", uses);
-    pMudEvent->sVariables = strdup(buf);
+    mud_event_set_num(pMudEvent, uses);
   } else {
     /* No event - so attach one. */
     uses = 1;
-    attach_mud_event(new_mud_event(iId, obj, "uses:1"), (SECS_PER_MUD_DAY / daily_uses) RL_SEC);
+    attach_mud_event(new_mud_event_num(iId, obj, 1), (SECS_PER_MUD_DAY / daily_uses) RL_SEC);
   }
 
   return uses;
@@ -3662,15 +3696,11 @@ int daily_item_specab_uses_remaining(struct obj_data *obj, int specab) {
     return -1;
 
   if ((pMudEvent = obj_has_mud_event(obj, iId))) {
-    if (pMudEvent->sVariables == NULL) {
+    if ((uses = mud_event_num(pMudEvent, -1)) < 0) {
       /* This is odd - This field should always be populated for daily-use abilities,
        * maybe some legacy code or bad id. */
-      log("SYSERR: sVariables field is NULL for daily-use-cooldown-event: %d", iId);
-    } else {
-      if (sscanf(pMudEvent->sVariables, "uses:%d", &uses) != 1) {
-        log("SYSERR: In daily_uses_remaining, bad sVariables for daily-use-cooldown-event: %d", iId);
-        uses = 0;
-      }
+      log("SYSERR: No uses set for daily-use-cooldown-event: %d", iId);
+      uses = 0;
     }
   }
 
@@ -177,6 +177,7 @@ int savingthrow(struct char_data *ch, int save, int modifier, int dc);
 
 /* Feats */
 int get_feat_value(struct char_data *ch, int featnum);
+void gear_feats_changed(struct char_data *ch);
 
 /* Public functions made available form weather.c */
 void weather_and_time(int mode);
@@ -871,6 +872,11 @@ do                                                              \
 #define GET_INITIATIVE(ch) ((ch)->char_specials.initiative)
 /** Who or what ch is fighting. */
 #define FIGHTING(ch)	  ((ch)->char_specials.fighting)
+/** Combat round schedule, kept by set_fighting() and stop_fighting(). */
+#define GET_ROUND_DUE(ch)   ((ch)->char_specials.round_due)
+#define GET_ROUND_ROOM(ch)  ((ch)->char_specials.round_room)
+#define GET_ROUND_PHASE(ch) ((ch)->char_specials.round_phase)
+#define IN_COMBAT_ROUND(ch) (GET_ROUND_DUE(ch) != 0)
 /** Who or what the ch is hunting. */
 #define HUNTING(ch)	  ((ch)->char_specials.hunting)
 /** Who is ch guarding? */
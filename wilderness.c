@@ -2,6 +2,9 @@
 
 #include <math.h>
 #include <gd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 
 #include "perlin.h"
 #include "conf.h"
@@ -12,11 +15,13 @@
 #include "db.h"
 #include "constants.h"
 #include "mud_event.h"
+#include "dg_scripts.h"
 #include "wilderness.h"
 #include "kdtree.h"
 
 #include "mysql.h"
 #include "desc_engine.h"
+#include "trails.h"
 
 void insert_path(struct path_data *path);
 
@@ -24,6 +29,9 @@ struct kdtree* kd_wilderness_rooms = NULL;
 
 int wild_waterline = 128;
 
+/* Last vnum of the dynamic room pool, moves up as the pool grows. */
+room_vnum wild_dynamic_room_vnum_end = WILD_DYNAMIC_ROOM_VNUM_END;
+
 /* \t= changes a color to be BACKGROUND. */
 struct wild_map_info_type wild_map_info[] = {
   /* 0 */
@@ -106,6 +114,197 @@ struct wild_map_info_type wild_map_info[] = {
     { NULL}}, /* RESERVED, NUM_ROOM_SECTORS */
 };
 
+/* Dynamic room pool.
+ *
+ * Every dynamic room that is bound to a coordinate (ROOM_OCCUPIED is set) is
+ * in a hash keyed on (x, y); every other dynamic room is on a free stack.
+ * Rooms are bound by occupy_wilderness_room() and go back on the stack when
+ * the eCHECK_OCCUPIED event finds them empty.  Both are rebuilt from the
+ * room flags by initialize_wilderness_lists(), since OLC can renumber rnums. */
+#define WILD_ROOM_HASH_SIZE 4096 /* Must be a power of two. */
+
+struct wild_room_hash_entry {
+  int x;
+  int y;
+  room_rnum room;
+  struct wild_room_hash_entry *next;
+};
+
+static struct wild_room_hash_entry *wild_room_hash[WILD_ROOM_HASH_SIZE];
+static struct wild_room_hash_entry *wild_room_hash_unused = NULL; /* Recycled entries. */
+static room_rnum *wild_free_rooms = NULL;
+static int wild_free_top = 0;
+static int wild_free_size = 0;
+
+static int wild_room_hash_key(int x, int y) {
+  return ((unsigned int) x * 73856093U ^ (unsigned int) y * 19349663U) & (WILD_ROOM_HASH_SIZE - 1);
+}
+
+/* The dynamic room bound to (x, y), or NOWHERE. */
+static room_rnum find_bound_wilderness_room(int x, int y) {
+  struct wild_room_hash_entry *entry;
+
+  for (entry = wild_room_hash[wild_room_hash_key(x, y)]; entry; entry = entry->next)
+    if (entry->x == x && entry->y == y)
+      return entry->room;
+
+  return NOWHERE;
+}
+
+static void bind_wilderness_room(room_rnum room) {
+  struct wild_room_hash_entry *entry;
+  int key = wild_room_hash_key(world[room].coords[X_COORD], world[room].coords[Y_COORD]);
+
+  if (find_bound_wilderness_room(world[room].coords[X_COORD], world[room].coords[Y_COORD]) == room)
+    return;
+
+  if ((entry = wild_room_hash_unused) != NULL)
+    wild_room_hash_unused = entry->next;
+  else
+    CREATE(entry, struct wild_room_hash_entry, 1);
+
+  entry->x = world[room].coords[X_COORD];
+  entry->y = world[room].coords[Y_COORD];
+  entry->room = room;
+  entry->next = wild_room_hash[key];
+  wild_room_hash[key] = entry;
+}
+
+static void unbind_wilderness_room(room_rnum room) {
+  struct wild_room_hash_entry **prev, *entry;
+  int key = wild_room_hash_key(world[room].coords[X_COORD], world[room].coords[Y_COORD]);
+
+  for (prev = &wild_room_hash[key]; (entry = *prev) != NULL; prev = &entry->next) {
+    if (entry->room == room) {
+      *prev = entry->next;
+      entry->next = wild_room_hash_unused;
+      wild_room_hash_unused = entry;
+      return;
+    }
+  }
+}
+
+static void push_free_wilderness_room(room_rnum room) {
+  if (wild_free_top >= wild_free_size) {
+    wild_free_size = MAX(wild_free_size * 2, WILD_DYNAMIC_ROOM_VNUM_END - WILD_DYNAMIC_ROOM_VNUM_START + 1);
+    RECREATE(wild_free_rooms, room_rnum, wild_free_size);
+  }
+  wild_free_rooms[wild_free_top++] = room;
+}
+
+/* Rebuild the coordinate hash and the free stack from the world. */
+static void index_dynamic_rooms() {
+  struct wild_room_hash_entry *entry;
+  room_rnum rnum;
+  int i;
+
+  for (i = 0; i < WILD_ROOM_HASH_SIZE; i++) {
+    while ((entry = wild_room_hash[i]) != NULL) {
+      wild_room_hash[i] = entry->next;
+      entry->next = wild_room_hash_unused;
+      wild_room_hash_unused = entry;
+    }
+  }
+  wild_free_top = 0;
+
+  /* Walk backwards so the lowest vnums are handed out first. */
+  for (rnum = top_of_world; rnum != NOWHERE; rnum--) {
+    if (!IS_DYNAMIC(rnum))
+      continue;
+
+    if (ROOM_FLAGGED(rnum, ROOM_OCCUPIED))
+      bind_wilderness_room(rnum);
+    else
+      push_free_wilderness_room(rnum);
+  }
+}
+
+/* Add up to WILD_DYNAMIC_ROOM_POOL_GROWTH rooms to the end of the pool, copied
+ * from the first pool room.  The new vnums have to sort after every room in
+ * the world and stay inside the wilderness zone, so nothing is renumbered. */
+static bool grow_dynamic_room_pool() {
+  struct room_data *room;
+  room_rnum template_room = real_room(WILD_DYNAMIC_ROOM_VNUM_START);
+  zone_rnum zone = real_zone(WILD_ZONE_VNUM);
+  room_vnum vnum = wild_dynamic_room_vnum_end + 1;
+  room_rnum rnum;
+  int i, count;
+
+  if (template_room == NOWHERE || zone == NOWHERE)
+    return FALSE;
+
+  count = MIN(WILD_DYNAMIC_ROOM_POOL_GROWTH, (int) zone_table[zone].top - (int) wild_dynamic_room_vnum_end);
+
+  if (count <= 0 || world[top_of_world].number >= vnum) {
+    log("SYSERR: Wilderness dynamic room pool is full (%d-%d) and can not grow.",
+            WILD_DYNAMIC_ROOM_VNUM_START, wild_dynamic_room_vnum_end);
+    return FALSE;
+  }
+
+  RECREATE(world, struct room_data, top_of_world + 1 + count);
+  memset(&world[top_of_world + 1], 0, sizeof (struct room_data) * count);
+
+  /* The world may have moved; room triggers waiting on a wait command hold a
+   * pointer to their room, so point them at its new home.  Everything else
+   * refers to rooms by rnum or vnum. */
+  for (rnum = 0; rnum <= top_of_world; rnum++)
+    update_wait_events(&world[rnum], &world[rnum]);
+
+  /* The template may have moved. */
+  template_room = real_room(WILD_DYNAMIC_ROOM_VNUM_START);
+
+  for (i = 0; i < count; i++) {
+    room = &world[top_of_world + 1 + i];
+
+    room->number = vnum + i;
+    room->zone = zone;
+    room->name = world[template_room].name ? strdup(world[template_room].name) : NULL;
+    room->description = world[template_room].description ? strdup(world[template_room].description) : NULL;
+    room->sector_type = world[template_room].sector_type;
+    memcpy(room->room_flags, world[template_room].room_flags, sizeof (room->room_flags));
+    REMOVE_BIT_AR(room->room_flags, ROOM_OCCUPIED);
+
+    CREATE(room->trail_tracks, struct trail_data_list, 1);
+  }
+
+  top_of_world += count;
+  wild_dynamic_room_vnum_end += count;
+
+  for (i = count - 1; i >= 0; i--)
+    push_free_wilderness_room(top_of_world - (count - 1) + i);
+
+  log("Wilderness dynamic room pool grown to %d-%d.", WILD_DYNAMIC_ROOM_VNUM_START, wild_dynamic_room_vnum_end);
+  return TRUE;
+}
+
+/* Mark a dynamic room as in use at its current coordinates, and make sure the
+ * eCHECK_OCCUPIED event is running to release it again once it is empty. */
+void occupy_wilderness_room(room_rnum room) {
+  room_vnum vnum;
+
+  if (room == NOWHERE || !IS_DYNAMIC(room))
+    return;
+
+  SET_BIT_AR(ROOM_FLAGS(room), ROOM_OCCUPIED);
+  bind_wilderness_room(room);
+
+  /* Create the event to clear the flag, if it is not already set. */
+  /* Pass a copy of the vnum, the pool can grow and move world under the event. */
+  vnum = world[room].number;
+  if (!room_has_mud_event(&world[room], eCHECK_OCCUPIED))
+    NEW_EVENT(eCHECK_OCCUPIED, &vnum, NULL, 10 RL_SEC);
+}
+
+/* Return an empty dynamic room to the pool. */
+void release_wilderness_room(room_rnum room) {
+  if (room == NOWHERE || !IS_DYNAMIC(room))
+    return;
+
+  REMOVE_BIT_AR(ROOM_FLAGS(room), ROOM_OCCUPIED);
+  unbind_wilderness_room(room);
+  push_free_wilderness_room(room);
+}
+
 /* Initialize the kd-tree that indexes the static rooms of the wilderness.
  * This procedure can be used to do whatever initialization is needed,
  * but be aware that it is run whenever a room is added or deleted from
@@ -133,6 +332,8 @@ void initialize_wilderness_lists() {
 
     }
   }
+
+  index_dynamic_rooms();
 }
 
 /* Get the value of the radial/box gradient at the specified (x,y) coordinate. */
@@ -199,18 +400,10 @@ double get_radial_gradient(int x, int y) {
   return 0;
 }
 
-int get_elevation(int map, int x, int y) {
-  double trans_x;
-  double trans_y;
-  double result;
-  double dist;
-
-  trans_x = x / (double) (WILD_X_SIZE / 2.0);
-  trans_y = y / (double) (WILD_Y_SIZE / 2.0);
-
-
-  result = PerlinNoise2D(map, trans_x, trans_y, 2.0, 2.0, 16);
-
+/* Turn the raw elevation and distortion noise at (x, y) into an elevation.
+ * Shared by calc_elevation() and the batched terrain generator so the two can
+ * never disagree. */
+static int elevation_from_noise(int x, int y, double result, double dist) {
   /* Compress the data a little, makes better mountains. */
   result = (result > .8 ? .8 : result);
   result = (result < -.8 ? -.8 : result);
@@ -226,13 +419,6 @@ int get_elevation(int map, int x, int y) {
   result *= result;
   result *= result;
 
-  trans_x = x / (double) (WILD_X_SIZE / 8.0);
-  trans_y = y / (double) (WILD_Y_SIZE / 8.0);
-
-
-  /* get the distortion */
-  dist = PerlinNoise2D(NOISE_MATERIAL_PLANE_ELEV_DIST, trans_x, trans_y, 1.5, 2.0, 16);
-
   /* Take a weighted average, normalize over [0..1] */
   result = ((result + dist) + 1) / 3.0;
 
@@ -242,18 +428,47 @@ int get_elevation(int map, int x, int y) {
   return 255 * result;
 }
 
-int get_weather(int x, int y) {
+static int calc_elevation(int map, int x, int y) {
   double trans_x;
   double trans_y;
   double result;
+  double dist;
+
+  trans_x = x / (double) (WILD_X_SIZE / 2.0);
+  trans_y = y / (double) (WILD_Y_SIZE / 2.0);
+
+
+  result = PerlinNoise2D(map, trans_x, trans_y, 2.0, 2.0, 16);
+
+  trans_x = x / (double) (WILD_X_SIZE / 8.0);
+  trans_y = y / (double) (WILD_Y_SIZE / 8.0);
+
+
+  /* get the distortion */
+  dist = PerlinNoise2D(NOISE_MATERIAL_PLANE_ELEV_DIST, trans_x, trans_y, 1.5, 2.0, 16);
+
+  return elevation_from_noise(x, y, result, dist);
+}
+
+/* Weather changes slowly with the wall clock. */
+static double get_weather_time_base(void) {
   double time_base;
   time_t now;
 
-
   now = time(NULL);
   time_base = now % 100000;
 
-  time_base = time_base / (double) (100000.0);
+  return time_base / (double) (100000.0);
+}
+
+int get_weather(int x, int y) {
+  double trans_x;
+  double trans_y;
+  double result;
+  double time_base;
+
+  time_base = get_weather_time_base();
+
   trans_x = x / (double) (WILD_X_SIZE / 1.0);
   trans_y = y / (double) (WILD_Y_SIZE / 1.0);
 
@@ -265,7 +480,45 @@ int get_weather(int x, int y) {
   return 255 * result;
 }
 
-int get_moisture(int map, int x, int y) {
+/* get_weather() for count tiles starting at (x, y) and running east, done in
+ * one batched noise call.  Used when drawing maps. */
+void get_weather_row(int x, int y, int count, int *weather) {
+  double *trans_x, *trans_y, *trans_z, *result;
+  double time_base;
+  int i;
+
+  if (count <= 0)
+    return;
+
+  CREATE(trans_x, double, count * 4);
+  trans_y = trans_x + count;
+  trans_z = trans_y + count;
+  result = trans_z + count;
+
+  time_base = get_weather_time_base();
+
+  for (i = 0; i < count; i++) {
+    trans_x[i] = ((x + i) / (double) (WILD_X_SIZE / 1.0)) * 50.0;
+    trans_y[i] = (y / (double) (WILD_Y_SIZE / 1.0)) * 50.0;
+    trans_z[i] = time_base * 100;
+  }
+
+  PerlinNoise3DBatch(NOISE_WEATHER, trans_x, trans_y, trans_z, count, 2.0, 2.0, 8, result);
+
+  for (i = 0; i < count; i++)
+    weather[i] = 255 * ((result[i] + 1) / 2.0);
+
+  free(trans_x);
+}
+
+static int moisture_from_noise(double result) {
+  /* Normalize over 0..1 */
+  result = (result + 1) / 2.0;
+
+  return 255 * result;
+}
+
+static int calc_moisture(int map, int x, int y) {
   double trans_x;
   double trans_y;
   double result;
@@ -275,14 +528,11 @@ int get_moisture(int map, int x, int y) {
 
   result = PerlinNoise2D(map, trans_x, trans_y, 1.5, 2.0, 8);
 
-  /* Normalize over 0..1 */
-  result = (result + 1) / 2.0;
-
-  return 255 * result;
-
+  return moisture_from_noise(result);
 }
 
-int get_temperature(int map, int x, int y) {
+/* Temperature at row y for a tile of the given elevation. */
+static int temperature_from_elevation(int y, int elevation) {
   /* This is a gradient in the y direction, modified
    * by terrain height. */
 
@@ -301,11 +551,262 @@ int get_temperature(int map, int x, int y) {
   pct = (double) (dist / (double) (WILD_Y_SIZE - equator));
 
   /* Return the temp. */
-  temp = (max_temp - (max_temp - min_temp) * pct) - (MAX(1.5 * get_elevation(map, x, y) - WATERLINE, 0)) / 10;
+  temp = (max_temp - (max_temp - min_temp) * pct) - (MAX(1.5 * elevation - WATERLINE, 0)) / 10;
 
   return temp;
 }
 
+static int calc_temperature(int map, int x, int y) {
+  return temperature_from_elevation(y, calc_elevation(map, x, y));
+}
+
+/* Precomputed terrain.
+ *
+ * Elevation, moisture and temperature come from multi-octave perlin noise and
+ * never change for a given set of seeds, so the whole WILD_X_SIZE x
+ * WILD_Y_SIZE grid is generated once into WILD_TERRAIN_FILE and mmap'd at
+ * boot.  The file header records everything the values depend on; if any of it
+ * differs from the running code the file is rebuilt.  Bump
+ * WILD_TERRAIN_VERSION when the terrain functions themselves change. */
+#define WILD_TERRAIN_MAGIC   "LUMTERR"
+#define WILD_TERRAIN_VERSION 1
+
+struct wild_terrain_header {
+  char magic[8];
+  int version;
+  int x_size;
+  int y_size;
+  int elevation_seed;
+  int moisture_seed;
+  int distortion_seed;
+  int waterline;
+};
+
+struct wild_terrain_cell {
+  sh_int elevation;   /* get_elevation(NOISE_MATERIAL_PLANE_ELEV) */
+  sh_int moisture;    /* get_moisture(NOISE_MATERIAL_PLANE_MOISTURE) */
+  sh_int temperature; /* get_temperature(NOISE_MATERIAL_PLANE_ELEV) */
+  ubyte sector_type;  /* Sector before regions, paths and static rooms. */
+  sbyte variant;      /* Variant glyph index for fields, mountains and water. */
+};
+
+static void *wild_terrain_map = NULL;
+static size_t wild_terrain_map_size = 0;
+static struct wild_terrain_cell *wild_terrain = NULL;
+
+static void fill_terrain_header(struct wild_terrain_header *header) {
+  memset(header, 0, sizeof (struct wild_terrain_header));
+  strcpy(header->magic, WILD_TERRAIN_MAGIC);
+  header->version = WILD_TERRAIN_VERSION;
+  header->x_size = WILD_X_SIZE;
+  header->y_size = WILD_Y_SIZE;
+  header->elevation_seed = NOISE_MATERIAL_PLANE_ELEV_SEED;
+  header->moisture_seed = NOISE_MATERIAL_PLANE_MOISTURE_SEED;
+  header->distortion_seed = NOISE_MATERIAL_PLANE_ELEV_DIST_SEED;
+  header->waterline = wild_waterline;
+}
+
+/* Find the cached terrain for (x, y), NULL if there is none. */
+static struct wild_terrain_cell *get_terrain_cell(int x, int y) {
+  x += WILD_X_SIZE / 2;
+  y += WILD_Y_SIZE / 2;
+
+  if (!wild_terrain || x < 0 || x >= WILD_X_SIZE || y < 0 || y >= WILD_Y_SIZE)
+    return NULL;
+
+  return &wild_terrain[y * WILD_X_SIZE + x];
+}
+
+/* Write the terrain file from scratch, one row at a time.  Each row's noise
+ * is computed with the batched perlin functions, which return exactly what
+ * PerlinNoise2D() would for every point. */
+static bool generate_terrain_file(const char *fn) {
+  struct wild_terrain_header header;
+  struct wild_terrain_cell *row;
+  char tmpname[MAX_STRING_LENGTH];
+  double *elev_x, *elev_y, *dist_x, *dist_y;
+  double *elev_noise, *dist_noise, *moist_noise, *variant_noise;
+  FILE *fl;
+  int x, y, wx, wy;
+
+  snprintf(tmpname, sizeof (tmpname), "%s.tmp", fn);
+
+  if (!(fl = fopen(tmpname, "wb"))) {
+    log("SYSERR: Unable to write wilderness terrain file %s: %s", tmpname, strerror(errno));
+    return FALSE;
+  }
+
+  fill_terrain_header(&header);
+  fwrite(&header, sizeof (header), 1, fl);
+
+  CREATE(row, struct wild_terrain_cell, WILD_X_SIZE);
+
+  /* Coordinates for the two noise scales, and one result row per noise map. */
+  CREATE(elev_x, double, WILD_X_SIZE * 8);
+  elev_y = elev_x + WILD_X_SIZE;
+  dist_x = elev_y + WILD_X_SIZE;
+  dist_y = dist_x + WILD_X_SIZE;
+  elev_noise = dist_y + WILD_X_SIZE;
+  dist_noise = elev_noise + WILD_X_SIZE;
+  moist_noise = dist_noise + WILD_X_SIZE;
+  variant_noise = moist_noise + WILD_X_SIZE;
+
+  for (y = 0; y < WILD_Y_SIZE; y++) {
+    wy = y - WILD_Y_SIZE / 2;
+
+    if (!(y % 256))
+      log("   ...terrain rows %d-%d of %d.", y, MIN(y + 255, WILD_Y_SIZE - 1), WILD_Y_SIZE);
+
+    for (x = 0; x < WILD_X_SIZE; x++) {
+      wx = x - WILD_X_SIZE / 2;
+
+      /* Same transforms as calc_elevation() and calc_moisture(). */
+      elev_x[x] = wx / (double) (WILD_X_SIZE / 2.0);
+      elev_y[x] = wy / (double) (WILD_Y_SIZE / 2.0);
+      dist_x[x] = wx / (double) (WILD_X_SIZE / 8.0);
+      dist_y[x] = wy / (double) (WILD_Y_SIZE / 8.0);
+    }
+
+    PerlinNoise2DBatch(NOISE_MATERIAL_PLANE_ELEV, elev_x, elev_y, WILD_X_SIZE, 2.0, 2.0, 16, elev_noise);
+    PerlinNoise2DBatch(NOISE_MATERIAL_PLANE_ELEV_DIST, dist_x, dist_y, WILD_X_SIZE, 1.5, 2.0, 16, dist_noise);
+    PerlinNoise2DBatch(NOISE_MATERIAL_PLANE_MOISTURE, dist_x, dist_y, WILD_X_SIZE, 1.5, 2.0, 8, moist_noise);
+    PerlinNoise2DBatch(NOISE_MATERIAL_PLANE_MOISTURE, elev_x, elev_y, WILD_X_SIZE, 2.0, 2.0, 16, variant_noise);
+
+    for (x = 0; x < WILD_X_SIZE; x++) {
+      wx = x - WILD_X_SIZE / 2;
+
+      row[x].elevation = elevation_from_noise(wx, wy, elev_noise[x], dist_noise[x]);
+      row[x].moisture = moisture_from_noise(moist_noise[x]);
+      row[x].temperature = temperature_from_elevation(wy, row[x].elevation);
+      row[x].sector_type = get_sector_type(row[x].elevation, row[x].temperature, row[x].moisture);
+      row[x].variant = elevation_from_noise(wx, wy, variant_noise[x], dist_noise[x]) % NUM_VARIANT_GLYPHS;
+    }
+
+    if (fwrite(row, sizeof (struct wild_terrain_cell), WILD_X_SIZE, fl) != WILD_X_SIZE) {
+      log("SYSERR: Short write on wilderness terrain file %s.", tmpname);
+      free(elev_x);
+      free(row);
+      fclose(fl);
+      remove(tmpname);
+      return FALSE;
+    }
+  }
+
+  free(elev_x);
+  free(row);
+
+  if (fclose(fl) || rename(tmpname, fn)) {
+    log("SYSERR: Unable to save wilderness terrain file %s: %s", fn, strerror(errno));
+    remove(tmpname);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Map the terrain file into memory, returns FALSE if it is missing or stale. */
+static bool map_terrain_file(const char *fn) {
+  struct wild_terrain_header header, expected;
+  struct stat st;
+  size_t size = sizeof (struct wild_terrain_header) +
+          sizeof (struct wild_terrain_cell) * WILD_X_SIZE * WILD_Y_SIZE;
+  void *base;
+  int fd;
+
+  if ((fd = open(fn, O_RDONLY)) < 0)
+    return FALSE;
+
+  fill_terrain_header(&expected);
+
+  if (fstat(fd, &st) || st.st_size != size ||
+          read(fd, &header, sizeof (header)) != sizeof (header) ||
+          memcmp(&header, &expected, sizeof (header))) {
+    close(fd);
+    return FALSE;
+  }
+
+  base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (base == MAP_FAILED) {
+    log("SYSERR: Unable to mmap wilderness terrain file %s: %s", fn, strerror(errno));
+    return FALSE;
+  }
+
+  wild_terrain_map = base;
+  wild_terrain_map_size = size;
+  wild_terrain = (struct wild_terrain_cell *) ((char *) base + sizeof (struct wild_terrain_header));
+
+  return TRUE;
+}
+
+/* Load the precomputed terrain, rebuilding it first if the seeds changed.
+ * The perlin generators must already be initialized. */
+void load_wilderness_terrain() {
+  if (wild_terrain_map) {
+    munmap(wild_terrain_map, wild_terrain_map_size);
+    wild_terrain_map = NULL;
+    wild_terrain = NULL;
+  }
+
+  if (map_terrain_file(WILD_TERRAIN_FILE))
+    return;
+
+  log("   Wilderness terrain file missing or out of date, generating %s.", WILD_TERRAIN_FILE);
+
+  if (!generate_terrain_file(WILD_TERRAIN_FILE) || !map_terrain_file(WILD_TERRAIN_FILE))
+    log("SYSERR: Wilderness terrain will be generated on the fly.");
+}
+
+int get_elevation(int map, int x, int y) {
+  struct wild_terrain_cell *cell;
+
+  if (map == NOISE_MATERIAL_PLANE_ELEV && (cell = get_terrain_cell(x, y)))
+    return cell->elevation;
+
+  return calc_elevation(map, x, y);
+}
+
+int get_moisture(int map, int x, int y) {
+  struct wild_terrain_cell *cell;
+
+  if (map == NOISE_MATERIAL_PLANE_MOISTURE && (cell = get_terrain_cell(x, y)))
+    return cell->moisture;
+
+  return calc_moisture(map, x, y);
+}
+
+int get_temperature(int map, int x, int y) {
+  struct wild_terrain_cell *cell;
+
+  if (map == NOISE_MATERIAL_PLANE_ELEV && (cell = get_terrain_cell(x, y)))
+    return cell->temperature;
+
+  return calc_temperature(map, x, y);
+}
+
+/* Sector type from the generated terrain alone, before regions and paths. */
+int get_base_sector_type(int x, int y) {
+  struct wild_terrain_cell *cell;
+
+  if ((cell = get_terrain_cell(x, y)))
+    return cell->sector_type;
+
+  return get_sector_type(get_elevation(NOISE_MATERIAL_PLANE_ELEV, x, y),
+          get_temperature(NOISE_MATERIAL_PLANE_ELEV, x, y),
+          get_moisture(NOISE_MATERIAL_PLANE_MOISTURE, x, y));
+}
+
+/* Index into variant_disp for fields, mountains and water. */
+static int get_variant_glyph(int x, int y) {
+  struct wild_terrain_cell *cell;
+
+  if ((cell = get_terrain_cell(x, y)))
+    return cell->variant;
+
+  return calc_elevation(NOISE_MATERIAL_PLANE_MOISTURE, x, y) % NUM_VARIANT_GLYPHS;
+}
+
 /* 
  * Generate a height map centered on center_x and center_y. 
  */
@@ -314,6 +815,7 @@ void get_map(int xsize, int ysize, int center_x, int center_y, struct wild_map_t
   int x, y;
   int x_offset, y_offset;
   int trans_x, trans_y;
+  int *weather;
 
   /* Below is for looking up static rooms. */
   room_rnum* room;
@@ -323,16 +825,18 @@ void get_map(int xsize, int ysize, int center_x, int center_y, struct wild_map_t
   x_offset = (center_x - ((xsize - 1) / 2));
   y_offset = (center_y - ((ysize - 1) / 2));
 
+  CREATE(weather, int, xsize);
+
   /* map MUST be big enough! */
   for (y = 0; y < ysize; y++) {
+    get_weather_row(x_offset, y + y_offset, xsize, weather);
+
     for (x = 0; x < xsize; x++) {
       map[x][y].vis = 0;
-      map[x][y].sector_type = get_sector_type(get_elevation(NOISE_MATERIAL_PLANE_ELEV, x + x_offset, y + y_offset),
-              get_temperature(NOISE_MATERIAL_PLANE_ELEV, x + x_offset, y + y_offset),
-              get_moisture(NOISE_MATERIAL_PLANE_MOISTURE, x + x_offset, y + y_offset));
+      map[x][y].sector_type = get_base_sector_type(x + x_offset, y + y_offset);
       map[x][y].glyph = NULL;
       map[x][y].num_regions = 0;
-      map[x][y].weather = get_weather(x + x_offset, y + y_offset);
+      map[x][y].weather = weather[x];
 
       /* Map should reflect changes from regions */
       struct region_list *regions = NULL;
@@ -386,6 +890,9 @@ void get_map(int xsize, int ysize, int center_x, int center_y, struct wild_map_t
         }
       }
 
+      free_region_list(regions);
+      free_path_list(paths);
+
       /* Check if the sector type has variant glyphs */
       if (wild_map_info[map[x][y].sector_type].variant_disp[0]) {
         if (map[x][y].sector_type == SECT_FIELD ||
@@ -393,13 +900,15 @@ void get_map(int xsize, int ysize, int center_x, int center_y, struct wild_map_t
                 map[x][y].sector_type == SECT_HIGH_MOUNTAIN ||
                 map[x][y].sector_type == SECT_WATER_NOSWIM ||
                 map[x][y].sector_type == SECT_OCEAN)
-          map[x][y].glyph = wild_map_info[map[x][y].sector_type].variant_disp[get_elevation(NOISE_MATERIAL_PLANE_MOISTURE, x + x_offset, y + y_offset) % NUM_VARIANT_GLYPHS];
+          map[x][y].glyph = wild_map_info[map[x][y].sector_type].variant_disp[get_variant_glyph(x + x_offset, y + y_offset)];
         else
           map[x][y].glyph = wild_map_info[map[x][y].sector_type].variant_disp[get_moisture(NOISE_MATERIAL_PLANE_MOISTURE, x + x_offset, y + y_offset) % NUM_VARIANT_GLYPHS];
       }
     }
   }
 
+  free(weather);
+
   /* use the kd_wilderness_rooms kd-tree index to look up the nearby rooms */
   loc[0] = center_x;
   loc[1] = center_y;
@@ -496,9 +1005,9 @@ int get_modified_sector_type(zone_rnum zone, int x, int y) {
 
   elev = get_elevation(NOISE_MATERIAL_PLANE_ELEV, x, y);
   temp = get_temperature(NOISE_MATERIAL_PLANE_ELEV, x, y);
-  mois = get_moisture(NOISE_MATERIAL_PLANE_ELEV, x, y);
+  mois = get_moisture(NOISE_MATERIAL_PLANE_MOISTURE, x, y);
 
-  sector_type = get_sector_type(elev, temp, mois);
+  sector_type = get_base_sector_type(x, y);
 
   /* Override default values with region-based values. */
   for (curr_region = regions; curr_region != NULL; curr_region = curr_region->next) {
@@ -537,6 +1046,10 @@ int get_modified_sector_type(zone_rnum zone, int x, int y) {
       }
     }
   }
+
+  free_region_list(regions);
+  free_path_list(paths);
+
   return sector_type;
 }
 
@@ -558,49 +1071,34 @@ room_rnum find_static_room_by_coordinates(int x, int y) {
   return NOWHERE;
 }
 
-/* Function to retreive a room based on coordinates.  The coordinates are
- * stored in a wrapper, struct wild_room_data, that contains a coordinate
- * vector and a pointer to struct room_data (the actual room!). */
+/* Function to retreive a room based on coordinates.  Static rooms come from
+ * the kd-tree, dynamic rooms from the coordinate hash. */
 room_rnum find_room_by_coordinates(int x, int y) {
-
-  int i = 0;
   room_rnum room = NOWHERE;
 
   if ((room = find_static_room_by_coordinates(x, y)) != NOWHERE) {
     return room;
   }
-  /* Check the dynamic rooms. */
-  for (i = WILD_DYNAMIC_ROOM_VNUM_START; (i <= WILD_DYNAMIC_ROOM_VNUM_END) && (real_room(i) != NOWHERE); i++) {
-    if ((ROOM_FLAGGED(real_room(i), ROOM_OCCUPIED)) &&
-            (world[real_room(i)].coords[X_COORD] == x) &&
-            (world[real_room(i)].coords[Y_COORD] == y)) {
-      /* Match */
-      return real_room(i);
-    }
-  }
-
-  /* No rooms currently allocated for (x,y), so allocate one. */
-  //  if((room = find_available_wilderness_room()) == NOWHERE)
-  //    return NOWHERE; /* No rooms available. */
-
-  //  assign_wilderness_room(room, x, y);
 
-  return room;
+  /* Check the dynamic rooms. */
+  return find_bound_wilderness_room(x, y);
 }
 
+/* Take an empty room off the dynamic pool, growing the pool if it has run
+ * dry.  The caller is expected to assign_wilderness_room() it right away. */
 room_rnum find_available_wilderness_room() {
-  int i = 0;
+  room_rnum room;
 
-  for (i = WILD_DYNAMIC_ROOM_VNUM_START; i <= WILD_DYNAMIC_ROOM_VNUM_END; i++) {
-    /* Skip gaps. */
-    if (real_room(i) == NOWHERE)
-      continue;
+  do {
+    while (wild_free_top > 0) {
+      room = wild_free_rooms[--wild_free_top];
 
-    if (!ROOM_FLAGGED(real_room(i), ROOM_OCCUPIED)) {
-      /* Here is our room. */
-      return real_room(i);
+      /* Rooms can be occupied behind our back, e.g. by goto <vnum>. */
+      if (room <= top_of_world && IS_DYNAMIC(room) && !ROOM_FLAGGED(room, ROOM_OCCUPIED))
+        return room;
     }
-  }
+  } while (grow_dynamic_room_pool());
+
   /* If we get here, there is a problem. */
   return NOWHERE;
 }
@@ -621,10 +1119,17 @@ void assign_wilderness_room(room_rnum room, int x, int y) {
     return;
   }
 
+  /* Drop any old binding before the coordinates change. */
+  if (IS_DYNAMIC(room))
+    unbind_wilderness_room(room);
+
   /* Here we will set the coordinates, build the descriptions, set the exits, sector type, etc. */
   world[room].coords[0] = x;
   world[room].coords[1] = y;
 
+  /* Claim the room now so it is not handed out twice before anyone enters. */
+  occupy_wilderness_room(room);
+
   /* Get the enclosing regions. */
   regions = get_enclosing_regions(GET_ROOM_ZONE(room), x, y);
   /* Get the enclosing paths. */
@@ -638,9 +1143,7 @@ void assign_wilderness_room(room_rnum room, int x, int y) {
   /* Assign the default values. */
 
   world[room].name = wilderness_name;
-  world[room].sector_type = get_sector_type(get_elevation(NOISE_MATERIAL_PLANE_ELEV, x, y),
-          get_temperature(NOISE_MATERIAL_PLANE_ELEV, x, y),
-          get_moisture(NOISE_MATERIAL_PLANE_MOISTURE, x, y));
+  world[room].sector_type = get_base_sector_type(x, y);
 
   /* Override default values with region-based values. */
   for (curr_region = regions; curr_region != NULL; curr_region = curr_region->next) {
@@ -678,6 +1181,9 @@ void assign_wilderness_room(room_rnum room, int x, int y) {
     }
   }
 
+  free_region_list(regions);
+  free_path_list(paths);
+
   /* Generate the description, now that everything else is set up. */
   world[room].description = wilderness_desc;
 }
@@ -967,7 +1473,7 @@ EVENTFUNC(event_check_occupied) {
           (room->people == NULL) &&
           (room->events && room->events->iSize == 1)) {
 
-    REMOVE_BIT_AR(ROOM_FLAGS(rnum), ROOM_OCCUPIED);
+    release_wilderness_room(rnum);
     return 0; /* No need to continue checking! */
 
   } else {
@@ -1074,9 +1580,7 @@ void save_map_to_file(const char* fn, int xsize, int ysize) {
       /* We need to check for prebuilt rooms at these coordinates, as well
        * as regions that might change the sector type.  */
       /* Start with the default - The value returned for the generated wilderness. */
-      sector_type = get_sector_type(get_elevation(NOISE_MATERIAL_PLANE_ELEV, x, -y),
-              get_temperature(NOISE_MATERIAL_PLANE_ELEV, x, -y),
-              get_moisture(NOISE_MATERIAL_PLANE_MOISTURE, x, -y));
+      sector_type = get_base_sector_type(x, -y);
 
 
       /* Map should reflect changes from regions */
@@ -1122,6 +1626,9 @@ void save_map_to_file(const char* fn, int xsize, int ysize) {
         }
       }
 
+      free_region_list(regions);
+      free_path_list(paths);
+
       /* use the kd_wilderness_rooms kd-tree index to look up the nearby rooms */
       loc[0] = x;
       loc[1] = -y;
@@ -1159,9 +1666,9 @@ void save_noise_to_file(int idx, const char* fn, int xsize, int ysize, int zoom)
   FILE *out; //output file
   int white, black, gray[255];
   int i, x, y;
-  double pixel;
+  double *pixel;
   //  double dist;
-  double trans_x, trans_y;
+  double *trans_x, *trans_y;
 
   //  int canvas_x = (zoom == 0 ? xsize : xsize/(2*zoom));
   //  int canvas_y = (zoom == 0 ? ysize : ysize/(2*zoom));
@@ -1179,16 +1686,21 @@ void save_noise_to_file(int idx, const char* fn, int xsize, int ysize, int zoom)
     gray[i] = gdImageColorAllocate(im, i, i, i);
   }
 
+  CREATE(trans_x, double, (canvas_y + 1) * 3);
+  trans_y = trans_x + (canvas_y + 1);
+  pixel = trans_y + (canvas_y + 1);
+
   for (y = 0; y <= canvas_x; y++) {
     for (x = 0; x <= canvas_y; x++) {
+      trans_x[x] = x / (double) ((xsize / 4.0) * (zoom == 0 ? 1 : 0.5 * zoom));
+      trans_y[x] = y / (double) ((ysize / 4.0) * (zoom == 0 ? 1 : 0.5 * zoom));
+    }
 
-      trans_x = x / (double) ((xsize / 4.0) * (zoom == 0 ? 1 : 0.5 * zoom));
-      trans_y = y / (double) ((ysize / 4.0) * (zoom == 0 ? 1 : 0.5 * zoom));
-
+    PerlinNoise2DBatch(idx, trans_x, trans_y, canvas_y + 1, 2.0, 2.0, 16, pixel);
 
-      pixel = PerlinNoise2D(idx, trans_x, trans_y, 2.0, 2.0, 16);
+    for (x = 0; x <= canvas_y; x++) {
 
-      pixel = (pixel + 1) / 2.0;
+      pixel[x] = (pixel[x] + 1) / 2.0;
       //      pixel =1.0 -  (pixel < 0 ? -pixel : pixel);
       //      pixel *= pixel;
 
@@ -1198,11 +1710,13 @@ void save_noise_to_file(int idx, const char* fn, int xsize, int ysize, int zoom)
 
       //      pixel = (pixel + 1.6)/4.0;
 
-      gdImageSetPixel(im, x, y, gray[(int) (255 * pixel)]);
+      gdImageSetPixel(im, x, y, gray[(int) (255 * pixel[x])]);
 
     }
   }
 
+  free(trans_x);
+
   out = fopen(fn, "wb");
   gdImagePng(im, out);
   fclose(out);
@@ -1324,9 +1838,7 @@ void generate_river(struct char_data* ch, int dir, region_vnum vnum, char *name)
     /* We need to check for prebuilt rooms at these coordinates, as well
      * as regions that might change the sector type.  */
     /* Start with the default - The value returned for the generated wilderness. */
-    sector_type = get_sector_type(get_elevation(NOISE_MATERIAL_PLANE_ELEV, x, y),
-            get_temperature(NOISE_MATERIAL_PLANE_ELEV, x, y),
-            get_moisture(NOISE_MATERIAL_PLANE_MOISTURE, x, y));
+    sector_type = get_base_sector_type(x, y);
 
 
     /* Should reflect changes from regions */
@@ -1372,6 +1884,9 @@ void generate_river(struct char_data* ch, int dir, region_vnum vnum, char *name)
       }
     }
 
+    free_region_list(regions);
+    free_path_list(paths);
+
     /* use the kd_wilderness_rooms kd-tree index to look up the nearby rooms */
     loc[0] = x;
     loc[1] = -y;
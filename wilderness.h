@@ -14,13 +14,16 @@
 #define WILD_ROOM_VNUM_END           1003999 /* The end of the STATIC wilderness rooms. */
 
 #define WILD_DYNAMIC_ROOM_VNUM_START 1004000 /* The start of the vnums for the dynamic room pool. */
-#define WILD_DYNAMIC_ROOM_VNUM_END   1005999 /* The end of the vnums for the dynamic room pool. */
+#define WILD_DYNAMIC_ROOM_VNUM_END   1005999 /* The end of the vnums for the dynamic room pool, as loaded. */
+#define WILD_DYNAMIC_ROOM_POOL_GROWTH 500   /* Rooms added to the pool each time it runs out. */
 
-#define IS_WILDERNESS_VNUM(room_vnum)  ((room_vnum >= WILD_ROOM_VNUM_START && room_vnum <= WILD_ROOM_VNUM_END) || (room_vnum >= WILD_DYNAMIC_ROOM_VNUM_START && room_vnum <= WILD_DYNAMIC_ROOM_VNUM_END))
+extern room_vnum wild_dynamic_room_vnum_end; /* The end of the pool, after any growth. */
+
+#define IS_WILDERNESS_VNUM(room_vnum)  ((room_vnum >= WILD_ROOM_VNUM_START && room_vnum <= WILD_ROOM_VNUM_END) || (room_vnum >= WILD_DYNAMIC_ROOM_VNUM_START && room_vnum <= wild_dynamic_room_vnum_end))
 
 /* Utility macros */
 #define IS_DYNAMIC(rnum) ((world[rnum].number >= WILD_DYNAMIC_ROOM_VNUM_START) && \
-                          (world[rnum].number <= WILD_DYNAMIC_ROOM_VNUM_END))
+                          (world[rnum].number <= wild_dynamic_room_vnum_end))
 
 /* Map Types */
 #define MAP_TYPE_NORMAL  0
@@ -118,7 +121,11 @@ struct region_data {
   struct vertex *vertices; /* Vertex list. */
   int num_vertices;        /* The number of vertices. */
 
+  double centroid_x; /* Centroid of the polygon, used to find REGION_POS_CENTER */
+  double centroid_y;
+
   struct list_data *events;      /* Used for region events */
+  struct mud_event_data **events_by_id; /* events, indexed by event_id */
   
 };
 
@@ -192,7 +199,13 @@ struct wild_map_tile {
 
 void get_map(int xsize, int ysize, int center_x, int center_y, struct wild_map_tile **map);
 int get_sector_type(int elevation, int temperature, int moisture);
+int get_base_sector_type(int x, int y);
+int get_elevation(int map, int x, int y);
+int get_moisture(int map, int x, int y);
+int get_temperature(int map, int x, int y);
+void load_wilderness_terrain();
 int get_weather(int x, int y);
+void get_weather_row(int x, int y, int count, int *weather);
 void show_wilderness_map(struct char_data *ch, int size, int x, int y);
 void save_map_to_file(const char *fn, int xsize, int ysize);
 void save_noise_to_file(int idx, const char* fn, int xsize, int ysize, int zoom);
@@ -207,6 +220,8 @@ room_rnum find_available_wilderness_room(); /* Get the next empty room in the po
 room_rnum find_room_by_coordinates(int x, int y); /* Get the room at coordinates (x,y) */
 room_rnum find_static_room_by_coordinates(int x, int y);
 void assign_wilderness_room(room_rnum room, int x, int y); /* Assign the room to the provided coordinates, adjusting descriptions, etc. */
+void occupy_wilderness_room(room_rnum room); /* Mark a dynamic room in use, the eCHECK_OCCUPIED event releases it. */
+void release_wilderness_room(room_rnum room); /* Return an empty dynamic room to the pool. */
 
 
 /* Regions */